@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# Cold start time and peak memory, several launches of the game, measured from outside the process
+# so any commit can be measured, including the ones before the in-game startup report.
+# The start time is the wall time from launch to the first log line matching MARKER, the world starting play.
+# The game is stopped SETTLE seconds later, after the background loads, and its max RSS is read from /usr/bin/time.
+# Rows are appended to Saved/Benchmark/TP3StartupCold.csv, labelled with the current commit,
+# run it on two commits to compare them.
+#
+#   UE_ROOT=/opt/UnrealEngine Scripts/MeasureStartup.sh
+#   RUNS=10 MAP=/Game/ThirdPerson/Maps/ThirdPersonMap Scripts/MeasureStartup.sh
+#   SETTLE=20 Scripts/MeasureStartup.sh
+set -euo pipefail
+
+: "${UE_ROOT:?set UE_ROOT to the Unreal Engine directory}"
+[ -x /usr/bin/time ] || { echo "GNU time (/usr/bin/time) is required for the peak memory" >&2; exit 1; }
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+LABEL="${LABEL:-$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo local)}"
+MAP="${MAP:-/Game/DMap}"
+MARKER="${MARKER:-Bringing World .* up for play}"
+SETTLE="${SETTLE:-10}"
+TIMEOUT="${TIMEOUT:-300}"
+
+OUT_DIR="$PROJECT_DIR/Saved/Benchmark"
+CSV="$OUT_DIR/TP3StartupCold.csv"
+mkdir -p "$OUT_DIR"
+[ -f "$CSV" ] || echo "label,run,start_s,max_rss_mb" > "$CSV"
+
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+for RUN in $(seq 1 "${RUNS:-5}"); do
+	echo "Startup run $RUN on $MAP"
+	LOG="$WORK_DIR/run$RUN.log"
+	STATS="$WORK_DIR/run$RUN.time"
+
+	START=$(date +%s.%N)
+	/usr/bin/time -v -o "$STATS" "$EDITOR" "$PROJECT_DIR/TP3Shoot.uproject" "$MAP" -game -nullrhi -nosound -unattended -nosplash \
+		-BenchmarkLabel="$LABEL" -log -stdout > "$LOG" 2>&1 &
+	PID=$!
+
+	STARTUP=""
+	while kill -0 "$PID" 2>/dev/null; do
+		if grep -qE "$MARKER" "$LOG"; then
+			STARTUP=$(echo "$(date +%s.%N) - $START" | bc)
+			break
+		fi
+		if [ "$(echo "$(date +%s.%N) - $START > $TIMEOUT" | bc)" -eq 1 ]; then
+			break
+		fi
+		sleep 0.05
+	done
+
+	# The game never quits by itself on older commits, stop it once the background loads had time to finish
+	[ -n "$STARTUP" ] && sleep "$SETTLE"
+	pkill -TERM -P "$PID" 2>/dev/null || true
+	wait "$PID" 2>/dev/null || true
+
+	if [ -z "$STARTUP" ]; then
+		echo "Run $RUN: no line matching '$MARKER' after ${TIMEOUT}s, see $LOG" >&2
+		cp "$LOG" "$OUT_DIR/TP3StartupCold_failed_run$RUN.log"
+		continue
+	fi
+
+	RSS_KB=$(sed -n 's/.*Maximum resident set size (kbytes): *//p' "$STATS")
+	printf "%s,%d,%.3f,%.1f\n" "$LABEL" "$RUN" "$STARTUP" "$(echo "${RSS_KB:-0} / 1024" | bc -l)" >> "$CSV"
+	echo "Run $RUN: started in ${STARTUP}s, max RSS $((${RSS_KB:-0} / 1024)) MB"
+done
+
+echo "Results in $CSV"
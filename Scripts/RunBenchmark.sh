@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+# Headless bot battle benchmark, one run per bot count.
+# Rows are appended to Saved/Benchmark/TP3Benchmark_<columns hash>.csv, labelled with the current commit.
+# Commits with the same columns share a file.
+#
+#   UE_ROOT=/opt/UnrealEngine Scripts/RunBenchmark.sh
+#   BOTS="50 100" SIM_SECONDS=30 Scripts/RunBenchmark.sh
+#   LABEL=walking NAV_WALKING=0 Scripts/RunBenchmark.sh
+#   LABEL=full-rate SIGNIFICANCE=0 Scripts/RunBenchmark.sh   # every bot ticks at full rate, against a default run
+#   LABEL=sync-traces HITSCAN_ASYNC=0 Scripts/RunBenchmark.sh   # shots traced on the game thread, also fills trace_us
+#   LABEL=bullets BULLETS=1 Scripts/RunBenchmark.sh
+#   LABEL=legacy-traces LEGACY_TRACES=1 HITSCAN_ASYNC=0 Scripts/RunBenchmark.sh   # shots on Pawn/Visibility, complex, no hit zones
+set -euo pipefail
+
+: "${UE_ROOT:?set UE_ROOT to the Unreal Engine directory}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+LABEL="${LABEL:-$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo local)}"
+MAP="${MAP:-/Game/DMap}"
+
+for N in ${BOTS:-10 50 100 250}; do
+	echo "Benchmark $MAP with $N bots"
+	"$EDITOR" "$PROJECT_DIR/TP3Shoot.uproject" "$MAP" -game -nullrhi -nosound -unattended -nosplash -nopause \
+		-benchmark -fps=30 -deterministic \
+		-TP3Benchmark="$N" -BenchmarkSeconds="${SIM_SECONDS:-60}" -BenchmarkSeed="${SEED:-1234}" -BenchmarkLabel="$LABEL" \
+		-ExecCmds="tp3.Hitscan.Async ${HITSCAN_ASYNC:-1}, tp3.Significance.Enabled ${SIGNIFICANCE:-1}, tp3.Significance.NavWalking ${NAV_WALKING:-1}, tp3.Projectile.Bullets ${BULLETS:-0}, tp3.Weapon.LegacyTraces ${LEGACY_TRACES:-0}" -log -stdout
+done
+
+echo "Results in $(ls -t "$PROJECT_DIR"/Saved/Benchmark/TP3Benchmark_*.csv 2>/dev/null | head -n 1)"
@@ -0,0 +1,39 @@
+#!/usr/bin/env bash
+# Dedicated server and headless clients on localhost, to test the replicated combat
+# and read the server cost per player ("Server: N players ..." lines of the server log).
+#
+#   UE_ROOT=/opt/UnrealEngine Scripts/RunLocalMultiplayer.sh
+#   CLIENTS=8 DURATION=300 Scripts/RunLocalMultiplayer.sh
+#   SERVER=Binaries/Linux/TP3ShootServer Scripts/RunLocalMultiplayer.sh   # packaged TP3ShootServer target
+set -euo pipefail
+
+: "${UE_ROOT:?set UE_ROOT to the Unreal Engine directory}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+MAP="${MAP:-/Game/DMap}"
+PORT="${PORT:-7777}"
+LOG_DIR="$PROJECT_DIR/Saved/Logs/LocalMultiplayer"
+mkdir -p "$LOG_DIR"
+
+PIDS=()
+trap 'kill "${PIDS[@]}" 2>/dev/null || true' EXIT
+
+if [ -n "${SERVER:-}" ]; then
+	"$PROJECT_DIR/$SERVER" "$MAP" -port="$PORT" -unattended -log -abslog="$LOG_DIR/Server.log" &
+else
+	"$EDITOR" "$PROJECT_DIR/TP3Shoot.uproject" "$MAP" -server -port="$PORT" -unattended -nosound \
+		-log -abslog="$LOG_DIR/Server.log" &
+fi
+PIDS+=($!)
+sleep "${SERVER_STARTUP:-20}"
+
+for I in $(seq 1 "${CLIENTS:-4}"); do
+	"$EDITOR" "$PROJECT_DIR/TP3Shoot.uproject" "127.0.0.1:$PORT" -game -nullrhi -nosound -unattended -nosplash \
+		-log -abslog="$LOG_DIR/Client$I.log" &
+	PIDS+=($!)
+done
+
+sleep "${DURATION:-120}"
+grep "Server:" "$LOG_DIR/Server.log" | tail -n 5 || true
+echo "Logs in $LOG_DIR"
@@ -0,0 +1,95 @@
+#!/usr/bin/env bash
+# Headless bot versus bot soak matches (TP3SoakGameMode), several processes in parallel,
+# one JSON per match in Saved/Soak/<label>/ merged into summary.json.
+#
+#   UE_ROOT=/opt/UnrealEngine Scripts/RunSoak.sh
+#   MATCHES=64 JOBS=16 BOTS=10 KILL_LIMIT=100 Scripts/RunSoak.sh
+#   LABEL=aggressive-bt FIRST_SEED=1 Scripts/RunSoak.sh
+set -euo pipefail
+
+: "${UE_ROOT:?set UE_ROOT to the Unreal Engine directory}"
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+EDITOR="$UE_ROOT/Engine/Binaries/Linux/UnrealEditor-Cmd"
+LABEL="${LABEL:-$(git -C "$PROJECT_DIR" rev-parse --short HEAD 2>/dev/null || echo local)}"
+MAP="${MAP:-/Game/DMap}"
+MATCHES="${MATCHES:-16}"
+FIRST_SEED="${FIRST_SEED:-1000}"
+# Each match also uses the task graph workers, a quarter of the cores per match by default
+JOBS="${JOBS:-$(( $(nproc) / 4 > 0 ? $(nproc) / 4 : 1 ))}"
+OUT_DIR="$PROJECT_DIR/Saved/Soak/$LABEL"
+mkdir -p "$OUT_DIR"
+
+run_match() {
+	local SEED="$1"
+	local ARGS=(-SoakSeed="$SEED" -SoakOutput="$OUT_DIR/match_$SEED.json" -BenchmarkLabel="$LABEL")
+	[ -n "${BOTS:-}" ] && ARGS+=(-SoakBots="$BOTS")
+	[ -n "${KILL_LIMIT:-}" ] && ARGS+=(-SoakKillLimit="$KILL_LIMIT")
+	[ -n "${MAX_SECONDS:-}" ] && ARGS+=(-SoakSeconds="$MAX_SECONDS")
+	[ -n "${FPS:-}" ] && ARGS+=(-SoakFps="$FPS")
+
+	if ! "$EDITOR" "$PROJECT_DIR/TP3Shoot.uproject" "$MAP?game=/Script/TP3Shoot.TP3SoakGameMode" \
+		-game -nullrhi -nosound -unattended -nosplash -nopause "${ARGS[@]}" -stdout > "$OUT_DIR/match_$SEED.log" 2>&1; then
+		echo "Match $SEED failed, see $OUT_DIR/match_$SEED.log"
+	fi
+}
+
+echo "Soak: $MATCHES matches on $MAP, $JOBS at a time"
+RUNNING=0
+for I in $(seq 0 $(( MATCHES - 1 ))); do
+	run_match $(( FIRST_SEED + I )) &
+	RUNNING=$(( RUNNING + 1 ))
+	if [ "$RUNNING" -ge "$JOBS" ]; then
+		wait -n || true
+		RUNNING=$(( RUNNING - 1 ))
+	fi
+done
+wait
+
+python3 - "$OUT_DIR" <<'PY'
+import glob, json, os, statistics, sys
+
+out_dir = sys.argv[1]
+matches = []
+for path in sorted(glob.glob(os.path.join(out_dir, "match_*.json"))):
+    with open(path) as f:
+        matches.append(json.load(f))
+
+if not matches:
+    sys.exit("No match results in " + out_dir)
+
+teams = {}
+for match in matches:
+    for team in match["teams"]:
+        entry = teams.setdefault(str(team["team"]), {"wins": 0, "kills": 0, "deaths": 0})
+        entry["kills"] += team["kills"]
+        entry["deaths"] += team["deaths"]
+    if match["winner"]:
+        teams.setdefault(str(match["winner"]), {"wins": 0, "kills": 0, "deaths": 0})["wins"] += 1
+
+for entry in teams.values():
+    entry["win_rate"] = entry["wins"] / len(matches)
+
+reasons = {}
+for match in matches:
+    reasons[match["end_reason"]] = reasons.get(match["end_reason"], 0) + 1
+
+durations = [match["sim_seconds"] for match in matches]
+summary = {
+    "label": matches[0]["label"],
+    "matches": len(matches),
+    "draws": sum(1 for match in matches if not match["winner"]),
+    "end_reasons": reasons,
+    "sim_seconds_mean": statistics.mean(durations),
+    "sim_seconds_min": min(durations),
+    "sim_seconds_max": max(durations),
+    "speedup_mean": statistics.mean(match["speedup"] for match in matches),
+    "teams": teams,
+}
+
+with open(os.path.join(out_dir, "summary.json"), "w") as f:
+    json.dump(summary, f, indent=2)
+print(json.dumps(summary, indent=2))
+PY
+
+echo "Results in $OUT_DIR/summary.json"
@@ -11,6 +11,7 @@ public class TP3ShootTarget : TargetRules
 		DefaultBuildSettings = BuildSettingsVersion.V2;
 
 		bOverrideBuildEnvironment = true;
+		bWithPushModel = true;
 		ExtraModuleNames.Add("TP3Shoot");
 	}
 }
@@ -11,18 +11,37 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
-#include "DrawDebugHelpers.h"
 #include "Particles/ParticleSystem.h"
 #include "Particles/ParticleSystemComponent.h"
 #include <TP3Shoot/TP3ShootCharacter.h>
 #include "Components/WidgetComponent.h"
 #include "Blueprint/UserWidget.h"
 #include "HealthBarWidget.h"
+#include "TP3HitscanSubsystem.h"
+#include "TP3ProjectileSubsystem.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3EffectPoolSubsystem.h"
+#include "TP3TracerSubsystem.h"
+#include "TP3RespawnSubsystem.h"
+#include "TP3SignificanceSubsystem.h"
+#include "TP3MatchRecorderSubsystem.h"
+#include "TP3AssetPreloadSubsystem.h"
+#include "TP3HitZoneComponent.h"
+#include "TP3BotMovementComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StreamableManager.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+static const FName MuzzleSocketName(TEXT("MuzzleFlash"));
 
 //////////////////////////////////////////////////////////////////////////
 // ATP3ShootCharacter
 
-AAI_Player::AAI_Player()
+AAI_Player::AAI_Player(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer.SetDefaultSubobjectClass<UTP3BotMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
 	// Set size for collision capsule
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -63,6 +82,10 @@ AAI_Player::AAI_Player()
 	SK_Gun->SetupAttachment(GetMesh());
 	// Set parent socket
 	SK_Gun->AttachToComponent(GetMesh(), FAttachmentTransformRules::KeepRelativeTransform, TEXT("GripPoint"));
+	GunMesh = TSoftObjectPtr<USkeletalMesh>(FSoftObjectPath(TEXT("/Game/FPS_Weapon_Bundle/Weapons/Meshes/AR4/SK_AR4.SK_AR4")));
+
+	// Shots hit these instead of the capsule and the physics asset
+	UTP3HitZoneComponent::CreateHitZones(*this, GetMesh());
 
 	Team = 1.0f;
 	Life = 100.0f;
@@ -83,6 +106,28 @@ void AAI_Player::BeginPlay()
 {
 	Super::BeginPlay();
 
+	FireQueryParams = FCollisionQueryParams(FName(TEXT("ProjectileTrace")), true, this);
+	FireQueryParams.bReturnPhysicalMaterial = false;
+
+	CombatantRegistry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (CombatantRegistry)
+	{
+		CombatantId = CombatantRegistry->Register(this, Team, Life, FTP3OnCombatantLifeChanged::CreateUObject(this, &AAI_Player::OnLifeChanged));
+	}
+
+	Tracers = GetWorld()->GetSubsystem<UTP3TracerSubsystem>();
+
+	Recorder = GetWorld()->GetSubsystem<UTP3MatchRecorderSubsystem>();
+
+	if (UTP3SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UTP3SignificanceSubsystem>())
+	{
+		Significance->RegisterBot(this);
+	}
+
+	// Prewarms the effect pool once the effects are loaded
+	EffectPool = GetWorld()->GetSubsystem<UTP3EffectPoolSubsystem>();
+	LoadGameplayAssets();
+
 	if (HealthBarComponent)
 	{
 		// Assurez-vous que le widget est initialis
@@ -96,9 +141,88 @@ void AAI_Player::BeginPlay()
 	}
 }
 
+void AAI_Player::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Push model: the server only compares them after a MARK_PROPERTY_DIRTY
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AAI_Player, Team, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AAI_Player, Life, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AAI_Player, IsAiming, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(AAI_Player, IsFiring, Params);
+}
+
+FGenericTeamId AAI_Player::GetGenericTeamId() const
+{
+	return FGenericTeamId(UTP3CombatantRegistry::ToTeamId(Team));
+}
+
+FPrimaryAssetId AAI_Player::GetPrimaryAssetId() const
+{
+	return UTP3AssetPreloadSubsystem::GetBlueprintPrimaryAssetId(this, AAI_Player::StaticClass()->GetFName());
+}
+
+void AAI_Player::LoadGameplayAssets()
+{
+	TArray<FSoftObjectPath> Paths;
+	for (const FSoftObjectPath& Path : { ParticleStart.ToSoftObjectPath(), ParticleImpact.ToSoftObjectPath(), GunMesh.ToSoftObjectPath() })
+	{
+		if (Path.IsValid() && !Path.ResolveObject())
+		{
+			Paths.Add(Path);
+		}
+	}
+
+	// Already brought in by the asset preload, no need to wait a frame
+	if (Paths.Num() == 0)
+	{
+		OnGameplayAssetsLoaded();
+		return;
+	}
+
+	GameplayAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths), FStreamableDelegate::CreateUObject(this, &AAI_Player::OnGameplayAssetsLoaded));
+}
+
+void AAI_Player::OnGameplayAssetsLoaded()
+{
+	if (EffectPool)
+	{
+		EffectPool->Prewarm(ParticleStart.Get());
+		EffectPool->Prewarm(ParticleImpact.Get());
+	}
+
+	if (USkeletalMesh* Mesh = GunMesh.Get())
+	{
+		if (SK_Gun->GetSkeletalMeshAsset() != Mesh)
+		{
+			SK_Gun->SetSkeletalMeshAsset(Mesh);
+		}
+	}
+}
+
+void AAI_Player::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTP3SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UTP3SignificanceSubsystem>())
+	{
+		Significance->UnregisterBot(this);
+	}
+
+	if (CombatantRegistry)
+	{
+		CombatantRegistry->Unregister(CombatantId);
+		CombatantId = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 
 void AAI_Player::UpdateHealthBar()
 {
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_UpdateHealthBar);
+
 	// Vrifiez que le composant existe et contient un widget
 	if (!HealthBarComponent) return;
 
@@ -108,7 +232,8 @@ void AAI_Player::UpdateHealthBar()
 	if (UHealthBarWidget* HealthWidget = Cast<UHealthBarWidget>(Widget))
 	{
 		// Met  jour la barre de vie
-		HealthWidget->HealthPercent = Life / 100.0f;
+		HealthWidget->HealthPercent = CombatantRegistry ? CombatantRegistry->GetLifeRatio(CombatantId) : Life / 100.0f;
+		TP3_COUNT_COMBAT_EVENT(WidgetUpdates);
 	}
 	else
 	{
@@ -167,17 +292,33 @@ void AAI_Player::TouchStopped(ETouchIndex::Type FingerIndex, FVector Location)
 void AAI_Player::Aim()
 {
 	IsAiming = true;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AAI_Player, IsAiming, this);
 }
 
 void AAI_Player::StopAiming()
 {
 	IsAiming = false;
+	MARK_PROPERTY_DIRTY_FROM_NAME(AAI_Player, IsAiming, this);
 }
 
 void AAI_Player::Fire()
 {
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_Fire);
+
 	FVector Start, LineTraceEnd, ForwardVector;
 
+	// Damage is applied by the server only
+	if (!HasAuthority())
+	{
+		return;
+	}
+
+	// No shooting while waiting to respawn
+	if (CombatantRegistry && (!CombatantRegistry->IsValidCombatant(CombatantId) || !CombatantRegistry->IsAlive(CombatantId)))
+	{
+		return;
+	}
+
 	if (IsAiming)
 	{
 		// Start location is from the camera
@@ -187,84 +328,84 @@ void AAI_Player::Fire()
 	else
 	{
 		// Start location is from the gun muzzle
-		Start = SK_Gun->GetSocketLocation("MuzzleFlash");
+		Start = SK_Gun->GetSocketLocation(MuzzleSocketName);
 		ForwardVector = FollowCamera->GetForwardVector();
 	}
 
 	// Calculate end point of the line trace
 	LineTraceEnd = Start + (ForwardVector * 10000);
 
-	// Perform line trace to detect any hit
-	FHitResult HitResult;
-	FCollisionQueryParams TraceParams(FName(TEXT("ProjectileTrace")), true, this);
-	TraceParams.bReturnPhysicalMaterial = false;
-	TraceParams.AddIgnoredActor(this); // Ignore self
-
-	bool bHit = GetWorld()->LineTraceSingleByChannel(
-		HitResult,
-		Start,
-		LineTraceEnd,
-		ECC_Visibility,
-		TraceParams
-	);
-	if (Team == 1.0f)
+	if (Recorder)
 	{
-		// Draw debug line
-		DrawDebugLine(
-			GetWorld(),
-			Start,
-			LineTraceEnd,
-			FColor::Blue,
-			false,
-			3.0f,
-			5,
-			3.0f
-		);
+		Recorder->RecordFireStart(CombatantId, Start, LineTraceEnd);
 	}
-	else
+
+	// Bullet with travel time, its hit goes through the registry like the line trace below
+	if (UTP3ProjectileSubsystem::ShouldFireBullets())
 	{
-		// Draw debug line
-		DrawDebugLine(
-			GetWorld(),
-			Start,
-			LineTraceEnd,
-			FColor::Red,
-			false,
-			3.0f,
-			5,
-			3.0f
-		);
+		if (UTP3ProjectileSubsystem* Projectiles = GetWorld()->GetSubsystem<UTP3ProjectileSubsystem>())
+		{
+			Projectiles->Launch(CombatantId, Start, ForwardVector, 5.0f);
+			return;
+		}
 	}
-	
 
+	// Hit zones and simple level collision, complex only for the legacy comparison
+	FireQueryParams.bTraceComplex = UTP3HitZoneComponent::UseLegacyTraces();
 
-	// Check if we hit something
-	if (bHit)
+	// The line trace is batched with the other shots of the frame, see OnFireResolved
+	FTP3HitscanShot Shot;
+	Shot.Start = Start;
+	Shot.End = LineTraceEnd;
+	Shot.Channel = UTP3HitZoneComponent::GetWeaponChannel(ECC_Visibility);
+	Shot.Shooter = this;
+	Shot.QueryParams = &FireQueryParams;
+	Shot.OnResolved.BindUObject(this, &AAI_Player::OnFireResolved);
+
+	if (UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>())
 	{
+		Hitscan->QueueShot(MoveTemp(Shot));
+	}
+}
 
-		AActor* HitActor = HitResult.GetActor();
+void AAI_Player::OnFireResolved(const FTP3HitscanShot& Shot, const FHitResult* Hit)
+{
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_FireResolved);
 
-		// Check if the hit actor is an AI_Player
-		if (AAI_Player* HitAIPlayer = Cast<AAI_Player>(HitActor))
-		{
-			// Check if they are on a different team
-			if (HitAIPlayer->Team != this->Team)
-			{
-				HitAIPlayer->DecreaseHealth(5.0f);
-			}
-		}
-		// Check if the hit actor is a TP3ShootCharacter (player character)
-		else if (ATP3ShootCharacter* HitPlayer = Cast<ATP3ShootCharacter>(HitActor))
+	const FVector& Start = Shot.Start;
+	const FVector& LineTraceEnd = Shot.End;
+
+	// Check if we hit something
+	if (Hit)
+	{
+		// Damage the hit actor if it is a combatant of the other team
+		if (CombatantRegistry)
 		{
-			// Check if they are on a different team
-			if (HitPlayer->Team != this->Team)
-			{
-				HitPlayer->DecreaseHealth(5.0f);
-			}
+			CombatantRegistry->TryDamageEnemy(CombatantId, Hit->GetActor(), 5.0f * UTP3HitZoneComponent::GetDamageMultiplier(*Hit));
 		}
+	}
+
+	if (Recorder)
+	{
+		Recorder->RecordFireEnd(CombatantId, Hit && CombatantRegistry ? CombatantRegistry->FindCombatant(Hit->GetActor()) : INDEX_NONE, Hit ? Hit->Location : LineTraceEnd);
+	}
+
+	// Tracer and impact particles on the server and the clients
+	MulticastShotEffects(Start, Hit ? Hit->Location : LineTraceEnd, Hit != nullptr);
+}
 
-		// Optionally, spawn impact particles at the hit location
-		FireParticle(Start, HitResult.Location);
+void AAI_Player::MulticastShotEffects_Implementation(FVector_NetQuantize Start, FVector_NetQuantize End, bool bHit)
+{
+	// Draw the tracer in the team color
+	if (Tracers)
+	{
+		Tracers->AddTracer(Start, End, UTP3CombatantRegistry::ToTeamId(Team));
+	}
+
+	// Optionally, spawn impact particles at the hit location
+	if (bHit)
+	{
+		FireParticle(Start, End);
 	}
 }
 
@@ -272,21 +413,52 @@ void AAI_Player::Fire()
 
 void AAI_Player::DecreaseHealth(float Amount)
 {
-	Life -= Amount;
-	if (Life <= 0)
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_DecreaseHealth);
+
+	if (CombatantRegistry && HasAuthority())
+	{
+		CombatantRegistry->ApplyDamage(CombatantId, Amount);
+	}
+}
+
+void AAI_Player::OnLifeChanged(int32 Id, bool bKilled)
+{
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_LifeChanged);
+
+	if (bKilled)
 	{
-		Life = 0;
-		// Logique de mort (exemple : tlportation, rinitialisation)
-		SetActorLocation(FVector(1300, 1200, 90));
-		Life = 100.0f;
+		// Logique de mort : dsactiv puis rapparat sur un point de spawn
+		if (UTP3RespawnSubsystem* Respawn = GetWorld()->GetSubsystem<UTP3RespawnSubsystem>())
+		{
+			Respawn->QueueRespawn(this, Id);
+		}
+	}
+	else if (UTP3SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UTP3SignificanceSubsystem>())
+	{
+		// Back to full rate as soon as it is in a fight
+		Significance->PromoteToFullRate(this);
 	}
 
+	Life = CombatantRegistry->GetLife(Id);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AAI_Player, Life, this);
+
 	UpdateHealthBar(); // Actualise la barre de vie
 }
 
+void AAI_Player::OnRep_Life()
+{
+	// Before BeginPlay the replicated life is picked up by the registration
+	if (CombatantRegistry)
+	{
+		CombatantRegistry->ApplyReplicatedLife(CombatantId, Life);
+	}
+}
+
 
 void AAI_Player::BoostSpeed()
 {
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_BoostSpeed);
+
 	// Set Max walking speed to 800
 	GetCharacterMovement()->MaxWalkSpeed = 800.f;
 
@@ -310,7 +482,12 @@ void AAI_Player::RemoveSpeedBoost()
 
 void AAI_Player::FireParticle(FVector Start, FVector Impact)
 {
-	if (!ParticleStart || !ParticleImpact) return;
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_FireParticle);
+
+	// Nothing until the Effects bundle is loaded
+	UParticleSystem* StartTemplate = ParticleStart.Get();
+	UParticleSystem* ImpactTemplate = ParticleImpact.Get();
+	if (!StartTemplate || !ImpactTemplate) return;
 
 	FTransform ParticleT;
 
@@ -318,12 +495,14 @@ void AAI_Player::FireParticle(FVector Start, FVector Impact)
 
 	ParticleT.SetScale3D(FVector(0.25, 0.25, 0.25));
 
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ParticleStart, ParticleT, true);
+	if (!EffectPool) return;
+
+	EffectPool->SpawnEffect(StartTemplate, ParticleT);
 
 	// Spawn particle at impact point
 	ParticleT.SetLocation(Impact);
 
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ParticleImpact, ParticleT, true);
+	EffectPool->SpawnEffect(ImpactTemplate, ParticleT);
 
 }
 
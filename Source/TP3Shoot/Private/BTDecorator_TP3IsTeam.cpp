@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTDecorator_TP3IsTeam.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("BT is team"), STAT_TP3BT_IsTeam, STATGROUP_TP3Shoot);
+
+UBTDecorator_TP3IsTeam::UBTDecorator_TP3IsTeam()
+{
+	NodeName = TEXT("TP3 Is Team");
+	Team = 1;
+
+	// The team of a combatant never changes during its life
+	bAllowAbortNone = true;
+	bAllowAbortLowerPri = false;
+	bAllowAbortChildNodes = false;
+}
+
+bool UBTDecorator_TP3IsTeam::CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_IsTeam);
+
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	const UTP3CombatantRegistry* Registry = Pawn ? Pawn->GetWorld()->GetSubsystem<UTP3CombatantRegistry>() : nullptr;
+	if (!Registry)
+	{
+		return false;
+	}
+
+	const int32 CombatantId = Registry->FindCombatant(Pawn);
+	return CombatantId != INDEX_NONE && Registry->GetTeam(CombatantId) == Team;
+}
+
+FString UBTDecorator_TP3IsTeam::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: team %d"), *Super::GetStaticDescription(), Team);
+}
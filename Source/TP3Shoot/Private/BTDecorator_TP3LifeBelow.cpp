@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTDecorator_TP3LifeBelow.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("BT life below"), STAT_TP3BT_LifeBelow, STATGROUP_TP3Shoot);
+
+UBTDecorator_TP3LifeBelow::UBTDecorator_TP3LifeBelow()
+{
+	NodeName = TEXT("TP3 Life Below");
+	LifeRatio = 0.5f;
+
+	bAllowAbortNone = true;
+	bAllowAbortLowerPri = false;
+	bAllowAbortChildNodes = false;
+}
+
+bool UBTDecorator_TP3LifeBelow::CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_LifeBelow);
+
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	const UTP3CombatantRegistry* Registry = Pawn ? Pawn->GetWorld()->GetSubsystem<UTP3CombatantRegistry>() : nullptr;
+	if (!Registry)
+	{
+		return false;
+	}
+
+	const int32 CombatantId = Registry->FindCombatant(Pawn);
+	return CombatantId != INDEX_NONE && Registry->GetLifeRatio(CombatantId) < LifeRatio;
+}
+
+FString UBTDecorator_TP3LifeBelow::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: life < %.0f%%"), *Super::GetStaticDescription(), LifeRatio * 100.f);
+}
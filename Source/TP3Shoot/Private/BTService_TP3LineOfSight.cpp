@@ -0,0 +1,97 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTService_TP3LineOfSight.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Bool.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "TP3CombatantGridSubsystem.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3LineOfSightSubsystem.h"
+#include "TP3SquadCoordinatorSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("BT line of sight"), STAT_TP3BT_LineOfSight, STATGROUP_TP3Shoot);
+
+UBTService_TP3LineOfSight::UBTService_TP3LineOfSight()
+{
+	NodeName = TEXT("TP3 Line Of Sight");
+	Interval = 0.25f;
+	RandomDeviation = 0.05f;
+	MaxRange = 2000.f;
+	bUseAssignedTarget = false;
+
+	bNotifyBecomeRelevant = false;
+	bNotifyCeaseRelevant = false;
+
+	// Keys of BB_IA
+	TargetActorKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_TP3LineOfSight, TargetActorKey), AActor::StaticClass());
+	TargetActorKey.SelectedKeyName = TEXT("TargetActor");
+	CanSeeTargetKey.AddBoolFilter(this, GET_MEMBER_NAME_CHECKED(UBTService_TP3LineOfSight, CanSeeTargetKey));
+	CanSeeTargetKey.SelectedKeyName = TEXT("CanSeeTarget");
+}
+
+void UBTService_TP3LineOfSight::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	if (const UBlackboardData* BBAsset = GetBlackboardAsset())
+	{
+		TargetActorKey.ResolveSelectedKey(*BBAsset);
+		CanSeeTargetKey.ResolveSelectedKey(*BBAsset);
+	}
+}
+
+void UBTService_TP3LineOfSight::TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	Super::TickNode(OwnerComp, NodeMemory, DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_LineOfSight);
+
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	const APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	if (!Blackboard || !Pawn)
+	{
+		return;
+	}
+
+	UWorld* World = Pawn->GetWorld();
+	const UTP3CombatantRegistry* Registry = World->GetSubsystem<UTP3CombatantRegistry>();
+	const UTP3CombatantGridSubsystem* Grid = World->GetSubsystem<UTP3CombatantGridSubsystem>();
+	UTP3LineOfSightSubsystem* LineOfSight = World->GetSubsystem<UTP3LineOfSightSubsystem>();
+	if (!Registry || !Grid || !LineOfSight)
+	{
+		return;
+	}
+
+	const int32 ObserverId = Registry->FindCombatant(Pawn);
+	AActor* Target = nullptr;
+	if (bUseAssignedTarget || UTP3SquadCoordinatorSubsystem::IsEnabled())
+	{
+		Target = Cast<AActor>(Blackboard->GetValue<UBlackboardKeyType_Object>(TargetActorKey.GetSelectedKeyID()));
+	}
+	else if (ObserverId != INDEX_NONE)
+	{
+		Target = Grid->FindNearestEnemy(Pawn->GetActorLocation(), Registry->GetTeam(ObserverId), MaxRange);
+		Blackboard->SetValue<UBlackboardKeyType_Object>(TargetActorKey.GetSelectedKeyID(), Target);
+	}
+	const int32 TargetId = Registry->FindCombatant(Target);
+
+	const bool bCanSee = TargetId != INDEX_NONE && LineOfSight->GetVisibility(ObserverId, TargetId) == ETP3Visibility::Visible;
+	Blackboard->SetValue<UBlackboardKeyType_Bool>(CanSeeTargetKey.GetSelectedKeyID(), bCanSee);
+}
+
+FString UBTService_TP3LineOfSight::GetStaticDescription() const
+{
+	if (bUseAssignedTarget)
+	{
+		return FString::Printf(TEXT("%s: %s visible to %s"), *Super::GetStaticDescription(),
+			*TargetActorKey.SelectedKeyName.ToString(), *CanSeeTargetKey.SelectedKeyName.ToString());
+	}
+	return FString::Printf(TEXT("%s: nearest enemy within %.0f to %s, visible to %s"), *Super::GetStaticDescription(),
+		MaxRange, *TargetActorKey.SelectedKeyName.ToString(), *CanSeeTargetKey.SelectedKeyName.ToString());
+}
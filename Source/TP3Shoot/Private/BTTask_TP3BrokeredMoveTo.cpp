@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_TP3BrokeredMoveTo.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "TP3PathBrokerSubsystem.h"
+
+UBTTask_TP3BrokeredMoveTo::UBTTask_TP3BrokeredMoveTo()
+{
+	NodeName = TEXT("TP3 Brokered Move To");
+	bNotifyTick = true;
+	AcceptableRadius = 100.f;
+
+	BlackboardKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3BrokeredMoveTo, BlackboardKey));
+	BlackboardKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3BrokeredMoveTo, BlackboardKey), AActor::StaticClass());
+}
+
+uint16 UBTTask_TP3BrokeredMoveTo::GetInstanceMemorySize() const
+{
+	return sizeof(FBTTP3BrokeredMoveToMemory);
+}
+
+void UBTTask_TP3BrokeredMoveTo::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	InitializeNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory, InitType);
+}
+
+void UBTTask_TP3BrokeredMoveTo::CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const
+{
+	CleanupNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory, CleanupType);
+}
+
+bool UBTTask_TP3BrokeredMoveTo::GetGoal(const UBehaviorTreeComponent& OwnerComp, FVector& OutGoal) const
+{
+	const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (!Blackboard)
+	{
+		return false;
+	}
+
+	if (BlackboardKey.SelectedKeyType == UBlackboardKeyType_Object::StaticClass())
+	{
+		const AActor* Goal = Cast<AActor>(Blackboard->GetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID()));
+		OutGoal = Goal ? Goal->GetActorLocation() : FAISystem::InvalidLocation;
+	}
+	else
+	{
+		OutGoal = Blackboard->GetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID());
+	}
+	return FAISystem::IsValidLocation(OutGoal);
+}
+
+EBTNodeResult::Type UBTTask_TP3BrokeredMoveTo::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	UTP3PathBrokerSubsystem* Broker = Pawn ? Pawn->GetWorld()->GetSubsystem<UTP3PathBrokerSubsystem>() : nullptr;
+
+	FVector Goal;
+	if (!Broker || !GetGoal(OwnerComp, Goal))
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	if (FVector::Dist2D(Pawn->GetActorLocation(), Goal) <= AcceptableRadius)
+	{
+		return EBTNodeResult::Succeeded;
+	}
+
+	FBTTP3BrokeredMoveToMemory* Memory = CastInstanceNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory);
+	Memory->bMoving = false;
+	Memory->PathRequestId = Broker->RequestPath(*Pawn, Goal,
+		FTP3OnPathReady::CreateUObject(this, &UBTTask_TP3BrokeredMoveTo::OnPathReady, TWeakObjectPtr<UBehaviorTreeComponent>(&OwnerComp)));
+
+	return Memory->PathRequestId != INDEX_NONE ? EBTNodeResult::InProgress : EBTNodeResult::Failed;
+}
+
+void UBTTask_TP3BrokeredMoveTo::OnPathReady(FNavPathSharedPtr Path, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp)
+{
+	UBehaviorTreeComponent* OwnerComp = WeakOwnerComp.Get();
+	uint8* NodeMemory = OwnerComp ? OwnerComp->GetNodeMemory(this, OwnerComp->FindInstanceContainingNode(this)) : nullptr;
+	AAIController* Controller = OwnerComp ? OwnerComp->GetAIOwner() : nullptr;
+	if (!NodeMemory || !Controller)
+	{
+		return;
+	}
+
+	FBTTP3BrokeredMoveToMemory* Memory = CastInstanceNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory);
+	Memory->PathRequestId = INDEX_NONE;
+
+	FVector Goal;
+	if (!Path.IsValid() || !GetGoal(*OwnerComp, Goal))
+	{
+		FinishLatentTask(*OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	FAIMoveRequest MoveRequest(Goal);
+	MoveRequest.SetAcceptanceRadius(AcceptableRadius);
+	Memory->MoveRequestId = Controller->RequestMove(MoveRequest, Path);
+	Memory->bMoving = Memory->MoveRequestId.IsValid();
+	if (!Memory->bMoving)
+	{
+		FinishLatentTask(*OwnerComp, EBTNodeResult::Failed);
+	}
+}
+
+void UBTTask_TP3BrokeredMoveTo::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	FBTTP3BrokeredMoveToMemory* Memory = CastInstanceNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory);
+	if (!Memory->bMoving)
+	{
+		return;
+	}
+
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	if (!Controller || Controller->GetMoveStatus() == EPathFollowingStatus::Idle)
+	{
+		Memory->bMoving = false;
+		const UPathFollowingComponent* PathFollowing = Controller ? Controller->GetPathFollowingComponent() : nullptr;
+		const bool bReached = PathFollowing && PathFollowing->DidMoveReachGoal();
+		FinishLatentTask(OwnerComp, bReached ? EBTNodeResult::Succeeded : EBTNodeResult::Failed);
+	}
+}
+
+EBTNodeResult::Type UBTTask_TP3BrokeredMoveTo::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTTP3BrokeredMoveToMemory* Memory = CastInstanceNodeMemory<FBTTP3BrokeredMoveToMemory>(NodeMemory);
+	AAIController* Controller = OwnerComp.GetAIOwner();
+
+	if (UTP3PathBrokerSubsystem* Broker = Controller ? Controller->GetWorld()->GetSubsystem<UTP3PathBrokerSubsystem>() : nullptr)
+	{
+		Broker->CancelRequest(Memory->PathRequestId);
+	}
+	if (Controller && Memory->bMoving)
+	{
+		Controller->StopMovement();
+	}
+
+	Memory->PathRequestId = INDEX_NONE;
+	Memory->bMoving = false;
+	return EBTNodeResult::Aborted;
+}
+
+FString UBTTask_TP3BrokeredMoveTo::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: within %.0f"), *Super::GetStaticDescription(), AcceptableRadius);
+}
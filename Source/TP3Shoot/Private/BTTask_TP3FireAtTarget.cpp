@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_TP3FireAtTarget.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3LineOfSightSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("BT fire at target"), STAT_TP3BT_FireAtTarget, STATGROUP_TP3Shoot);
+
+UBTTask_TP3FireAtTarget::UBTTask_TP3FireAtTarget()
+{
+	NodeName = TEXT("TP3 Fire At Target");
+	bNotifyTick = true;
+
+	MinShots = 1;
+	MaxShots = 3;
+	MinShotInterval = 0.1f;
+	MaxShotInterval = 0.3f;
+	bRequireLineOfSight = false;
+}
+
+uint16 UBTTask_TP3FireAtTarget::GetInstanceMemorySize() const
+{
+	return sizeof(FBTTP3FireAtTargetMemory);
+}
+
+void UBTTask_TP3FireAtTarget::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	InitializeNodeMemory<FBTTP3FireAtTargetMemory>(NodeMemory, InitType);
+}
+
+void UBTTask_TP3FireAtTarget::CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const
+{
+	CleanupNodeMemory<FBTTP3FireAtTargetMemory>(NodeMemory, CleanupType);
+}
+
+EBTNodeResult::Type UBTTask_TP3FireAtTarget::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_FireAtTarget);
+
+	AAI_Player* Pawn = nullptr;
+	AActor* Target = FindTarget(OwnerComp, Pawn);
+	if (!Target)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	if (bRequireLineOfSight)
+	{
+		UTP3LineOfSightSubsystem* LineOfSight = Pawn->GetWorld()->GetSubsystem<UTP3LineOfSightSubsystem>();
+		const UTP3CombatantRegistry* Registry = Pawn->GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+		if (LineOfSight && Registry && LineOfSight->GetVisibility(Pawn->GetCombatantId(), Registry->FindCombatant(Target)) != ETP3Visibility::Visible)
+		{
+			return EBTNodeResult::Failed;
+		}
+	}
+
+	FaceTarget(OwnerComp, *Pawn, *Target);
+	Pawn->Fire();
+
+	FBTTP3FireAtTargetMemory* Memory = CastInstanceNodeMemory<FBTTP3FireAtTargetMemory>(NodeMemory);
+	Memory->Target = Target;
+	Memory->ShotsLeft = FMath::RandRange(MinShots, FMath::Max(MinShots, MaxShots)) - 1;
+	Memory->TimeToNextShot = FMath::FRandRange(MinShotInterval, FMath::Max(MinShotInterval, MaxShotInterval));
+
+	return Memory->ShotsLeft > 0 ? EBTNodeResult::InProgress : EBTNodeResult::Succeeded;
+}
+
+void UBTTask_TP3FireAtTarget::TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_FireAtTarget);
+
+	FBTTP3FireAtTargetMemory* Memory = CastInstanceNodeMemory<FBTTP3FireAtTargetMemory>(NodeMemory);
+	Memory->TimeToNextShot -= DeltaSeconds;
+	if (Memory->TimeToNextShot > 0.f)
+	{
+		return;
+	}
+
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	AAI_Player* Pawn = Controller ? Cast<AAI_Player>(Controller->GetPawn()) : nullptr;
+	const AActor* Target = Memory->Target.Get();
+	if (!Pawn || !Target)
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Failed);
+		return;
+	}
+
+	// Keep tracking the target during the burst
+	FaceTarget(OwnerComp, *Pawn, *Target);
+	Pawn->Fire();
+
+	if (--Memory->ShotsLeft <= 0)
+	{
+		FinishLatentTask(OwnerComp, EBTNodeResult::Succeeded);
+		return;
+	}
+
+	Memory->TimeToNextShot = FMath::FRandRange(MinShotInterval, FMath::Max(MinShotInterval, MaxShotInterval));
+}
+
+FString UBTTask_TP3FireAtTarget::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %d-%d shots within %.0f%s"), *Super::GetStaticDescription(), MinShots, MaxShots, MaxRange,
+		bRequireLineOfSight ? TEXT(", in sight") : TEXT(""));
+}
@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_TP3RotateToTarget.h"
+#include "AI_Player.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("BT rotate to target"), STAT_TP3BT_RotateToTarget, STATGROUP_TP3Shoot);
+
+UBTTask_TP3RotateToTarget::UBTTask_TP3RotateToTarget()
+{
+	NodeName = TEXT("TP3 Rotate To Target");
+
+	// Same range as the Blueprint task
+	MaxRange = 3000.f;
+}
+
+EBTNodeResult::Type UBTTask_TP3RotateToTarget::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3BT_RotateToTarget);
+
+	AAI_Player* Pawn = nullptr;
+	AActor* Target = FindTarget(OwnerComp, Pawn);
+	if (!Target)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FaceTarget(OwnerComp, *Pawn, *Target);
+	return EBTNodeResult::Succeeded;
+}
+
+FString UBTTask_TP3RotateToTarget::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: within %.0f"), *Super::GetStaticDescription(), MaxRange);
+}
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_TP3SharedEQSQuery.h"
+#include "AIController.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "TP3EQSSchedulerSubsystem.h"
+
+UBTTask_TP3SharedEQSQuery::UBTTask_TP3SharedEQSQuery()
+{
+	NodeName = TEXT("TP3 Shared EQS Query");
+	RunMode = EEnvQueryRunMode::AllMatching;
+
+	BlackboardKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3SharedEQSQuery, BlackboardKey));
+	BlackboardKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3SharedEQSQuery, BlackboardKey), AActor::StaticClass());
+}
+
+uint16 UBTTask_TP3SharedEQSQuery::GetInstanceMemorySize() const
+{
+	return sizeof(FBTTP3SharedEQSQueryMemory);
+}
+
+void UBTTask_TP3SharedEQSQuery::InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const
+{
+	InitializeNodeMemory<FBTTP3SharedEQSQueryMemory>(NodeMemory, InitType);
+}
+
+void UBTTask_TP3SharedEQSQuery::CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const
+{
+	CleanupNodeMemory<FBTTP3SharedEQSQueryMemory>(NodeMemory, CleanupType);
+}
+
+EBTNodeResult::Type UBTTask_TP3SharedEQSQuery::ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	APawn* Pawn = Controller ? Controller->GetPawn() : nullptr;
+	UTP3EQSSchedulerSubsystem* Scheduler = Pawn ? Pawn->GetWorld()->GetSubsystem<UTP3EQSSchedulerSubsystem>() : nullptr;
+	if (!Scheduler || !QueryTemplate)
+	{
+		return EBTNodeResult::Failed;
+	}
+
+	FBTTP3SharedEQSQueryMemory* Memory = CastInstanceNodeMemory<FBTTP3SharedEQSQueryMemory>(NodeMemory);
+	const TSharedPtr<FEnvQueryResult> Cached = Scheduler->RequestQuery(QueryTemplate, RunMode, *Pawn,
+		FTP3OnSharedQueryFinished::CreateUObject(this, &UBTTask_TP3SharedEQSQuery::OnQueryFinished, TWeakObjectPtr<UBehaviorTreeComponent>(&OwnerComp)),
+		Memory->RequestId);
+
+	if (Cached.IsValid())
+	{
+		return WriteResult(OwnerComp, *Cached) ? EBTNodeResult::Succeeded : EBTNodeResult::Failed;
+	}
+
+	return Memory->RequestId != INDEX_NONE ? EBTNodeResult::InProgress : EBTNodeResult::Failed;
+}
+
+EBTNodeResult::Type UBTTask_TP3SharedEQSQuery::AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory)
+{
+	FBTTP3SharedEQSQueryMemory* Memory = CastInstanceNodeMemory<FBTTP3SharedEQSQueryMemory>(NodeMemory);
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	if (UTP3EQSSchedulerSubsystem* Scheduler = Controller ? Controller->GetWorld()->GetSubsystem<UTP3EQSSchedulerSubsystem>() : nullptr)
+	{
+		Scheduler->CancelRequest(Memory->RequestId);
+	}
+	Memory->RequestId = INDEX_NONE;
+
+	return EBTNodeResult::Aborted;
+}
+
+void UBTTask_TP3SharedEQSQuery::OnQueryFinished(TSharedPtr<FEnvQueryResult> Result, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp)
+{
+	UBehaviorTreeComponent* OwnerComp = WeakOwnerComp.Get();
+	if (!OwnerComp)
+	{
+		return;
+	}
+
+	if (uint8* NodeMemory = OwnerComp->GetNodeMemory(this, OwnerComp->FindInstanceContainingNode(this)))
+	{
+		CastInstanceNodeMemory<FBTTP3SharedEQSQueryMemory>(NodeMemory)->RequestId = INDEX_NONE;
+	}
+
+	const bool bSucceeded = Result.IsValid() && WriteResult(*OwnerComp, *Result);
+	FinishLatentTask(*OwnerComp, bSucceeded ? EBTNodeResult::Succeeded : EBTNodeResult::Failed);
+}
+
+bool UBTTask_TP3SharedEQSQuery::WriteResult(UBehaviorTreeComponent& OwnerComp, const FEnvQueryResult& Result) const
+{
+	UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	const int32 NumItems = Result.Items.Num();
+	if (!Blackboard || NumItems == 0)
+	{
+		return false;
+	}
+
+	// AllMatching results are sorted by score
+	const int32 ItemIndex = FMath::RandHelper(FMath::Max(1, NumItems / 4));
+
+	if (BlackboardKey.SelectedKeyType == UBlackboardKeyType_Object::StaticClass())
+	{
+		return Blackboard->SetValue<UBlackboardKeyType_Object>(BlackboardKey.GetSelectedKeyID(), Result.GetItemAsActor(ItemIndex));
+	}
+	return Blackboard->SetValue<UBlackboardKeyType_Vector>(BlackboardKey.GetSelectedKeyID(), Result.GetItemAsLocation(ItemIndex));
+}
+
+FString UBTTask_TP3SharedEQSQuery::GetStaticDescription() const
+{
+	return FString::Printf(TEXT("%s: %s shared per team and cell"), *Super::GetStaticDescription(), *GetNameSafe(QueryTemplate));
+}
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BTTask_TP3TargetBase.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Vector.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "TP3CombatantGridSubsystem.h"
+
+UBTTask_TP3TargetBase::UBTTask_TP3TargetBase()
+{
+	MaxRange = 2000.f;
+	bNotifyTaskFinished = true;
+
+	TargetActorKey.AddObjectFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3TargetBase, TargetActorKey), AActor::StaticClass());
+	TargetActorKey.AllowNoneAsValue(true);
+	TargetActorKey.SelectedKeyName = NAME_None;
+
+	// Key of BB_IA
+	TargetLocationKey.AddVectorFilter(this, GET_MEMBER_NAME_CHECKED(UBTTask_TP3TargetBase, TargetLocationKey));
+	TargetLocationKey.SelectedKeyName = TEXT("TargetLocation");
+}
+
+void UBTTask_TP3TargetBase::InitializeFromAsset(UBehaviorTree& Asset)
+{
+	Super::InitializeFromAsset(Asset);
+
+	// Resolve the key ids once against the tree's blackboard, ticks only use the cached ids
+	if (const UBlackboardData* BBAsset = GetBlackboardAsset())
+	{
+		TargetActorKey.ResolveSelectedKey(*BBAsset);
+		TargetLocationKey.ResolveSelectedKey(*BBAsset);
+	}
+}
+
+void UBTTask_TP3TargetBase::OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult)
+{
+	// Otherwise the bot keeps turning to a dead or out of range target and fights its movement rotation
+	if (AAIController* Controller = OwnerComp.GetAIOwner())
+	{
+		Controller->ClearFocus(EAIFocusPriority::Gameplay);
+	}
+
+	Super::OnTaskFinished(OwnerComp, NodeMemory, TaskResult);
+}
+
+AActor* UBTTask_TP3TargetBase::FindTarget(UBehaviorTreeComponent& OwnerComp, AAI_Player*& OutPawn) const
+{
+	const AAIController* Controller = OwnerComp.GetAIOwner();
+	OutPawn = Controller ? Cast<AAI_Player>(Controller->GetPawn()) : nullptr;
+	if (!OutPawn)
+	{
+		return nullptr;
+	}
+
+	const FVector Origin = OutPawn->GetActorLocation();
+	AActor* Target = nullptr;
+
+	const UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent();
+	if (Blackboard && TargetActorKey.IsSet())
+	{
+		Target = Cast<AActor>(Blackboard->GetValue<UBlackboardKeyType_Object>(TargetActorKey.GetSelectedKeyID()));
+	}
+
+	if (!Target)
+	{
+		if (const UTP3CombatantGridSubsystem* Grid = OutPawn->GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+		{
+			Target = Grid->FindNearestEnemy(Origin, Grid->GetTeam(OutPawn), MaxRange);
+		}
+	}
+
+	if (Target && FVector::DistSquared(Target->GetActorLocation(), Origin) > FMath::Square(MaxRange))
+	{
+		Target = nullptr;
+	}
+
+	return Target;
+}
+
+void UBTTask_TP3TargetBase::FaceTarget(UBehaviorTreeComponent& OwnerComp, AAI_Player& Pawn, const AActor& Target) const
+{
+	const FVector TargetLocation = Target.GetActorLocation();
+	const FRotator LookAt = UKismetMathLibrary::FindLookAtRotation(Pawn.GetActorLocation(), TargetLocation);
+
+	Pawn.SetActorRotation(FRotator(0.f, LookAt.Yaw, 0.f));
+
+	if (AAIController* Controller = OwnerComp.GetAIOwner())
+	{
+		Controller->SetControlRotation(LookAt);
+		Controller->SetFocus(const_cast<AActor*>(&Target), EAIFocusPriority::Gameplay);
+	}
+
+	if (UBlackboardComponent* Blackboard = OwnerComp.GetBlackboardComponent())
+	{
+		Blackboard->SetValue<UBlackboardKeyType_Vector>(TargetLocationKey.GetSelectedKeyID(), TargetLocation);
+	}
+}
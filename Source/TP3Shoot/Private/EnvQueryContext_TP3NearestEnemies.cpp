@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvQueryContext_TP3NearestEnemies.h"
+#include "Engine/World.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Actor.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "TP3CombatantGridSubsystem.h"
+
+void UEnvQueryContext_TP3NearestEnemies::ProvideContext(FEnvQueryInstance& QueryInstance, FEnvQueryContextData& ContextData) const
+{
+	const AActor* Querier = Cast<AActor>(QueryInstance.Owner.Get());
+	if (const AController* Controller = Cast<AController>(Querier))
+	{
+		Querier = Controller->GetPawn();
+	}
+
+	const UTP3CombatantGridSubsystem* Grid = Querier ? Querier->GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>() : nullptr;
+	if (!Grid)
+	{
+		return;
+	}
+
+	TArray<AActor*> Enemies;
+	Grid->FindNearestEnemies(Querier->GetActorLocation(), Grid->GetTeam(Querier), MaxEnemies, SearchRadius, Enemies);
+	UEnvQueryItemType_Actor::SetContextHelper(ContextData, Enemies);
+}
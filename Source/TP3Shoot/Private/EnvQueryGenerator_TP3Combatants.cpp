@@ -0,0 +1,120 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvQueryGenerator_TP3Combatants.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Actor.h"
+#include "GameFramework/Controller.h"
+#include "GameFramework/Pawn.h"
+#include "TP3CombatantGridSubsystem.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryGenerator"
+
+UEnvQueryGenerator_TP3Combatants::UEnvQueryGenerator_TP3Combatants()
+{
+	ItemType = UEnvQueryItemType_Actor::StaticClass();
+	SearchCenter = UEnvQueryContext_Querier::StaticClass();
+	SearchRadius.DefaultValue = 10000.f;
+	MaxResults.DefaultValue = 0;
+	bEnemies = true;
+}
+
+void UEnvQueryGenerator_TP3Combatants::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+	if (QueryOwner == nullptr)
+	{
+		return;
+	}
+
+	const UWorld* World = GEngine->GetWorldFromContextObject(QueryOwner, EGetWorldErrorMode::LogAndReturnNull);
+	const UTP3CombatantGridSubsystem* Grid = World ? World->GetSubsystem<UTP3CombatantGridSubsystem>() : nullptr;
+	if (Grid == nullptr)
+	{
+		return;
+	}
+
+	const AActor* Querier = Cast<AActor>(QueryOwner);
+	if (const AController* Controller = Cast<AController>(QueryOwner))
+	{
+		Querier = Controller->GetPawn();
+	}
+
+	const int32 Team = Grid->GetTeam(Querier);
+	if (Team == INDEX_NONE)
+	{
+		return;
+	}
+
+	SearchRadius.BindData(QueryOwner, QueryInstance.QueryID);
+	MaxResults.BindData(QueryOwner, QueryInstance.QueryID);
+	const float Radius = SearchRadius.GetValue();
+	const int32 Count = MaxResults.GetValue();
+
+	TArray<FVector> ContextLocations;
+	QueryInstance.PrepareContext(SearchCenter, ContextLocations);
+
+	TArray<AActor*> Combatants;
+	TArray<AActor*> Found;
+	for (const FVector& Location : ContextLocations)
+	{
+		Found.Reset();
+		if (bEnemies && Count > 0)
+		{
+			Grid->FindNearestEnemies(Location, Team, Count, Radius, Found);
+		}
+		else if (bEnemies)
+		{
+			Grid->FindEnemiesInRadius(Location, Radius, Team, Found);
+		}
+		else
+		{
+			Grid->FindAlliesInRadius(Location, Radius, Team, Found);
+			Found.Remove(const_cast<AActor*>(Querier));
+
+			if (Count > 0 && Found.Num() > Count)
+			{
+				Found.Sort([&Location](const AActor& A, const AActor& B)
+					{
+						return FVector::DistSquared(A.GetActorLocation(), Location) < FVector::DistSquared(B.GetActorLocation(), Location);
+					});
+				Found.SetNum(Count, EAllowShrinking::No);
+			}
+		}
+
+		if (ContextLocations.Num() == 1)
+		{
+			Combatants = MoveTemp(Found);
+		}
+		else
+		{
+			for (AActor* Actor : Found)
+			{
+				Combatants.AddUnique(Actor);
+			}
+		}
+	}
+
+	QueryInstance.AddItemData<UEnvQueryItemType_Actor>(Combatants);
+}
+
+FText UEnvQueryGenerator_TP3Combatants::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("TP3CombatantsDescriptionGenerateAroundContext", "{0}: generate {1} around {2}"),
+		Super::GetDescriptionTitle(),
+		bEnemies ? LOCTEXT("TP3CombatantsEnemies", "enemies") : LOCTEXT("TP3CombatantsAllies", "allies"),
+		UEnvQueryTypes::DescribeContext(SearchCenter));
+}
+
+FText UEnvQueryGenerator_TP3Combatants::GetDescriptionDetails() const
+{
+	FFormatNamedArguments Args;
+	Args.Add(TEXT("Radius"), FText::FromString(SearchRadius.ToString()));
+	Args.Add(TEXT("Count"), FText::FromString(MaxResults.ToString()));
+
+	return FText::Format(LOCTEXT("TP3CombatantsDescription", "radius: {Radius}, max results: {Count}"), Args);
+}
+
+#undef LOCTEXT_NAMESPACE
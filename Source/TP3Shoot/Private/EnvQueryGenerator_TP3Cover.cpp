@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvQueryGenerator_TP3Cover.h"
+#include "Algo/Unique.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EnvironmentQuery/Contexts/EnvQueryContext_Querier.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_Point.h"
+#include "TP3CoverSubsystem.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryGenerator"
+
+UEnvQueryGenerator_TP3Cover::UEnvQueryGenerator_TP3Cover()
+{
+	ItemType = UEnvQueryItemType_Point::StaticClass();
+	SearchCenter = UEnvQueryContext_Querier::StaticClass();
+	SearchRadius.DefaultValue = 1500.f;
+}
+
+void UEnvQueryGenerator_TP3Cover::GenerateItems(FEnvQueryInstance& QueryInstance) const
+{
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+	if (QueryOwner == nullptr)
+	{
+		return;
+	}
+
+	const UWorld* World = GEngine->GetWorldFromContextObject(QueryOwner, EGetWorldErrorMode::LogAndReturnNull);
+	const UTP3CoverSubsystem* Cover = World ? World->GetSubsystem<UTP3CoverSubsystem>() : nullptr;
+	if (Cover == nullptr || !Cover->HasCoverData())
+	{
+		return;
+	}
+
+	SearchRadius.BindData(QueryOwner, QueryInstance.QueryID);
+	const float Radius = SearchRadius.GetValue();
+
+	TArray<FVector> ContextLocations;
+	QueryInstance.PrepareContext(SearchCenter, ContextLocations);
+
+	TArray<int32> Indices;
+	for (const FVector& Location : ContextLocations)
+	{
+		Cover->GatherCoverPoints(Location, Radius, Indices);
+	}
+
+	if (ContextLocations.Num() > 1)
+	{
+		Indices.Sort();
+		Indices.SetNum(Algo::Unique(Indices), EAllowShrinking::No);
+	}
+
+	TArray<FNavLocation> Points;
+	Points.Reserve(Indices.Num());
+	for (const int32 Index : Indices)
+	{
+		Points.Add(FNavLocation(Cover->GetCoverLocation(Index)));
+	}
+
+	QueryInstance.AddItemData<UEnvQueryItemType_Point>(Points);
+}
+
+FText UEnvQueryGenerator_TP3Cover::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("TP3CoverDescriptionGenerateAroundContext", "{0}: generate around {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(SearchCenter));
+}
+
+FText UEnvQueryGenerator_TP3Cover::GetDescriptionDetails() const
+{
+	return FText::Format(LOCTEXT("TP3CoverDescription", "radius: {0}"), FText::FromString(SearchRadius.ToString()));
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnvQueryTest_TP3CoverExposure.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EnvQueryContext_TP3NearestEnemies.h"
+#include "EnvironmentQuery/Items/EnvQueryItemType_VectorBase.h"
+#include "TP3CoverSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+#define LOCTEXT_NAMESPACE "EnvQueryGenerator"
+
+DECLARE_CYCLE_STAT(TEXT("EQS cover exposure test"), STAT_TP3Cover_ExposureTest, STATGROUP_TP3Shoot);
+
+UEnvQueryTest_TP3CoverExposure::UEnvQueryTest_TP3CoverExposure()
+{
+	Cost = EEnvTestCost::Low;
+	ValidItemType = UEnvQueryItemType_VectorBase::StaticClass();
+	SetWorkOnFloatValues(true);
+
+	// Covered points are better
+	ScoringEquation = EEnvTestScoreEquation::InverseLinear;
+	Threat = UEnvQueryContext_TP3NearestEnemies::StaticClass();
+}
+
+void UEnvQueryTest_TP3CoverExposure::RunTest(FEnvQueryInstance& QueryInstance) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Cover_ExposureTest);
+
+	UObject* QueryOwner = QueryInstance.Owner.Get();
+	if (QueryOwner == nullptr)
+	{
+		return;
+	}
+
+	FloatValueMin.BindData(QueryOwner, QueryInstance.QueryID);
+	FloatValueMax.BindData(QueryOwner, QueryInstance.QueryID);
+	const float MinThresholdValue = FloatValueMin.GetValue();
+	const float MaxThresholdValue = FloatValueMax.GetValue();
+
+	const UWorld* World = GEngine->GetWorldFromContextObject(QueryOwner, EGetWorldErrorMode::LogAndReturnNull);
+	const UTP3CoverSubsystem* Cover = World ? World->GetSubsystem<UTP3CoverSubsystem>() : nullptr;
+
+	TArray<FVector> ThreatLocations;
+	if (Cover == nullptr || !QueryInstance.PrepareContext(Threat, ThreatLocations))
+	{
+		return;
+	}
+
+	for (FEnvQueryInstance::ItemIterator It(this, QueryInstance); It; ++It)
+	{
+		const int32 PointIndex = Cover->FindCoverPointAt(GetItemLocation(QueryInstance, It.GetIndex()));
+
+		float Exposure = PointIndex == INDEX_NONE && ThreatLocations.Num() > 0 ? 1.f : 0.f;
+		if (PointIndex != INDEX_NONE)
+		{
+			for (const FVector& ThreatLocation : ThreatLocations)
+			{
+				Exposure = FMath::Max(Exposure, Cover->GetExposure(PointIndex, ThreatLocation));
+			}
+		}
+
+		It.SetScore(TestPurpose, FilterType, Exposure, MinThresholdValue, MaxThresholdValue);
+	}
+}
+
+FText UEnvQueryTest_TP3CoverExposure::GetDescriptionTitle() const
+{
+	return FText::Format(LOCTEXT("TP3CoverExposureTitle", "{0}: exposure to {1}"),
+		Super::GetDescriptionTitle(), UEnvQueryTypes::DescribeContext(Threat));
+}
+
+FText UEnvQueryTest_TP3CoverExposure::GetDescriptionDetails() const
+{
+	return DescribeFloatTestParams();
+}
+
+#undef LOCTEXT_NAMESPACE
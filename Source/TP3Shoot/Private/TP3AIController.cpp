@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3AIController.h"
+#include "BehaviorTree/BehaviorTree.h"
+#include "TP3BehaviorTreeComponent.h"
+
+ATP3AIController::ATP3AIController()
+{
+	bWantsPlayerState = false;
+
+	BrainComponent = CreateDefaultSubobject<UTP3BehaviorTreeComponent>(TEXT("BTComponent"));
+}
+
+void ATP3AIController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	// Also registers the new team with the perception system
+	SetGenericTeamId(FGenericTeamId::GetTeamIdentifier(InPawn));
+
+	if (BehaviorTree)
+	{
+		RunBehaviorTree(BehaviorTree);
+	}
+}
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3AssetPreloadSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/Package.h"
+
+void UTP3AssetPreloadSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!UAssetManager::IsInitialized())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Asset preload: no asset manager, nothing preloaded"));
+		PreloadDoneSeconds = FPlatformTime::Seconds() - GStartTime;
+		return;
+	}
+
+	TArray<int32> Order;
+	for (int32 EntryIndex = 0; EntryIndex < PreloadList.Num(); ++EntryIndex)
+	{
+		if (PreloadList[EntryIndex].AssetId.IsValid())
+		{
+			Order.Add(EntryIndex);
+		}
+	}
+	Order.StableSort([this](int32 A, int32 B) { return PreloadList[A].Priority > PreloadList[B].Priority; });
+
+	NumPending = Order.Num();
+	if (NumPending == 0)
+	{
+		PreloadDoneSeconds = FPlatformTime::Seconds() - GStartTime;
+		return;
+	}
+
+	// The classes are light now that their heavy references are soft, their bundles are requested once they are in
+	UAssetManager& AssetManager = UAssetManager::Get();
+	for (const int32 EntryIndex : Order)
+	{
+		const FTP3PreloadEntry& Entry = PreloadList[EntryIndex];
+		TSharedPtr<FStreamableHandle> Handle = AssetManager.LoadPrimaryAsset(Entry.AssetId, TArray<FName>(),
+			FStreamableDelegate::CreateUObject(this, &UTP3AssetPreloadSubsystem::OnPrimaryAssetLoaded, EntryIndex), Entry.Priority);
+
+		if (Handle.IsValid())
+		{
+			Handles.Add(Handle);
+		}
+		else
+		{
+			// Already loaded or unknown id, the delegate is not called
+			OnPrimaryAssetLoaded(EntryIndex);
+		}
+	}
+}
+
+void UTP3AssetPreloadSubsystem::Deinitialize()
+{
+	for (const TSharedPtr<FStreamableHandle>& Handle : Handles)
+	{
+		Handle->CancelHandle();
+	}
+	Handles.Reset();
+
+	Super::Deinitialize();
+}
+
+FPrimaryAssetId UTP3AssetPreloadSubsystem::GetBlueprintPrimaryAssetId(const UObject* Object, FName AssetType)
+{
+	// Only the class default object of a blueprint is a primary asset, like UPrimaryDataAsset
+	if (!Object || !Object->HasAnyFlags(RF_ClassDefaultObject) || Object->GetClass()->HasAnyClassFlags(CLASS_Native))
+	{
+		return FPrimaryAssetId();
+	}
+
+	return FPrimaryAssetId(AssetType, FPackageName::GetShortFName(Object->GetOutermost()->GetFName()));
+}
+
+void UTP3AssetPreloadSubsystem::OnPrimaryAssetLoaded(int32 EntryIndex)
+{
+	UAssetManager& AssetManager = UAssetManager::Get();
+	const FTP3PreloadEntry& Entry = PreloadList[EntryIndex];
+
+	const UClass* Class = Cast<UClass>(AssetManager.GetPrimaryAssetObject(Entry.AssetId));
+	const UObject* Object = Class ? Class->GetDefaultObject() : AssetManager.GetPrimaryAssetObject(Entry.AssetId);
+	if (!Object)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Asset preload: %s not found"), *Entry.AssetId.ToString());
+		OnEntryDone();
+		return;
+	}
+
+	// Bundles of blueprint classes are not in the asset registry, read them from the metadata of the defaults
+	FAssetBundleData BundleData;
+	AssetManager.InitializeAssetBundlesFromMetadata(Object, BundleData);
+
+	TArray<FSoftObjectPath> Paths;
+	for (const FName BundleName : Entry.Bundles)
+	{
+		if (const FAssetBundleEntry* Bundle = BundleData.FindEntry(BundleName))
+		{
+			for (const FTopLevelAssetPath& Path : Bundle->AssetPaths)
+			{
+				Paths.AddUnique(FSoftObjectPath(Path));
+			}
+		}
+	}
+
+	if (Paths.Num() == 0)
+	{
+		OnEntryDone();
+		return;
+	}
+
+	TSharedPtr<FStreamableHandle> Handle = AssetManager.GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths),
+		FStreamableDelegate::CreateUObject(this, &UTP3AssetPreloadSubsystem::OnEntryDone), Entry.Priority);
+
+	if (Handle.IsValid())
+	{
+		Handles.Add(Handle);
+	}
+	else
+	{
+		OnEntryDone();
+	}
+}
+
+void UTP3AssetPreloadSubsystem::OnEntryDone()
+{
+	if (NumPending <= 0 || --NumPending > 0)
+	{
+		return;
+	}
+
+	PreloadDoneSeconds = FPlatformTime::Seconds() - GStartTime;
+	UE_LOG(LogTemp, Display, TEXT("Asset preload: %d primary assets loaded %.2f s after start"), PreloadList.Num(), PreloadDoneSeconds);
+	OnPreloadComplete.Broadcast();
+	ReportStartup();
+}
+
+void UTP3AssetPreloadSubsystem::NotifyGameplayStarted()
+{
+	if (GameplaySeconds >= 0.0)
+	{
+		return;
+	}
+
+	GameplaySeconds = FPlatformTime::Seconds() - GStartTime;
+	UE_LOG(LogTemp, Display, TEXT("Asset preload: gameplay started %.2f s after start"), GameplaySeconds);
+	ReportStartup();
+}
+
+void UTP3AssetPreloadSubsystem::ReportStartup()
+{
+	if (bReported || GameplaySeconds < 0.0 || PreloadDoneSeconds < 0.0)
+	{
+		return;
+	}
+	bReported = true;
+
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const double PeakMb = MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0);
+	const double UsedMb = MemoryStats.UsedPhysical / (1024.0 * 1024.0);
+
+	FString Label;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("BenchmarkLabel="), Label))
+	{
+		Label = TEXT("local");
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Startup: gameplay %.2f s, preload %.2f s, peak memory %.1f MB, used %.1f MB"), GameplaySeconds, PreloadDoneSeconds, PeakMb, UsedMb);
+
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Benchmark") / TEXT("TP3Startup.csv");
+	FString Text;
+	if (!FPlatformFileManager::Get().GetPlatformFile().FileExists(*Filename))
+	{
+		Text += TEXT("label,gameplay_s,preload_s,peak_mem_mb,used_mem_mb\n");
+	}
+	Text += FString::Printf(TEXT("%s,%.3f,%.3f,%.1f,%.1f\n"), *Label, GameplaySeconds, PreloadDoneSeconds, PeakMb, UsedMb);
+	FFileHelper::SaveStringToFile(Text, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("TP3ExitAfterStartup")))
+	{
+		FPlatformMisc::RequestExit(false, TEXT("TP3Startup"));
+	}
+}
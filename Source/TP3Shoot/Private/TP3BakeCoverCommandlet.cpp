@@ -0,0 +1,172 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3BakeCoverCommandlet.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "NavigationSystem.h"
+#include "TP3CoverData.h"
+#include "TP3CoverSubsystem.h"
+#include "UObject/Package.h"
+#include "UObject/SavePackage.h"
+
+UTP3BakeCoverCommandlet::UTP3BakeCoverCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+void UTP3BakeCoverCommandlet::BakeWorld(UWorld& World, UTP3CoverData& Data)
+{
+	Data.Points.Reset();
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&World);
+	const FBox Bounds = NavSys ? NavSys->GetNavigableWorldBounds() : FBox(ForceInit);
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cover bake: no navmesh in %s"), *World.GetName());
+		return;
+	}
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(TP3CoverBake), false);
+	const float Spacing = FMath::Max(Data.SampleSpacing, 10.f);
+	const FVector Extent(Spacing * 0.5f, Spacing * 0.5f, Bounds.GetSize().Z * 0.5f + 200.f);
+
+	for (float X = Bounds.Min.X + Spacing * 0.5f; X < Bounds.Max.X; X += Spacing)
+	{
+		for (float Y = Bounds.Min.Y + Spacing * 0.5f; Y < Bounds.Max.Y; Y += Spacing)
+		{
+			FNavLocation NavLocation;
+			if (!NavSys->ProjectPointToNavigation(FVector(X, Y, Bounds.GetCenter().Z), NavLocation, Extent))
+			{
+				continue;
+			}
+
+			const FVector TraceStart = NavLocation.Location + FVector(0.f, 0.f, Data.TraceHeight);
+
+			FTP3CoverPoint Point;
+			Point.Location = FVector3f(NavLocation.Location);
+			float ClosestWall = Data.ProbeDistance;
+			bool bNextToWall = false;
+
+			for (int32 Direction = 0; Direction < FTP3CoverPoint::NumDirections; ++Direction)
+			{
+				FHitResult Hit;
+				const FVector TraceEnd = TraceStart + FTP3CoverPoint::GetDirection(Direction) * Data.ExposureDistance;
+				const bool bHit = World.LineTraceSingleByChannel(Hit, TraceStart, TraceEnd, ECC_Visibility, QueryParams);
+				const float FreeDistance = bHit ? Hit.Distance : Data.ExposureDistance;
+
+				Point.Exposure[Direction] = (uint8)FMath::Clamp(FMath::RoundToInt(255.f * FreeDistance / Data.ExposureDistance), 0, 255);
+
+				// Only walls count, not slopes and steps
+				if (bHit && FreeDistance <= ClosestWall && FMath::Abs(Hit.ImpactNormal.Z) < 0.3f)
+				{
+					ClosestWall = FreeDistance;
+					Point.Facing = (uint8)Direction;
+					bNextToWall = true;
+				}
+			}
+
+			if (bNextToWall)
+			{
+				Data.Points.Add(Point);
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Cover bake: %d points in %s"), Data.Points.Num(), *World.GetName());
+}
+
+int32 UTP3BakeCoverCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamVals;
+	ParseCommandLine(*Params, Tokens, Switches, ParamVals);
+
+	FString MapsParam = ParamVals.FindRef(TEXT("Maps"));
+	if (MapsParam.IsEmpty())
+	{
+		MapsParam = TEXT("/Game/DMap+/Game/ThirdPerson/Maps/ThirdPersonMap");
+	}
+
+	TArray<FString> Maps;
+	MapsParam.ParseIntoArray(Maps, TEXT("+"));
+
+	const FString CoverDataDirectory = GetDefault<UTP3CoverSubsystem>()->CoverDataDirectory;
+	int32 NumErrors = 0;
+
+	for (const FString& Map : Maps)
+	{
+		UPackage* MapPackage = LoadPackage(nullptr, *Map, LOAD_None);
+		UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+		if (!World)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Cover bake: cannot load %s"), *Map);
+			++NumErrors;
+			continue;
+		}
+
+		// Collision for the traces and a navigation system rebuilding the navmesh from the level geometry
+		World->WorldType = EWorldType::Editor;
+		World->AddToRoot();
+		if (!World->bIsWorldInitialized)
+		{
+			World->InitWorld(UWorld::InitializationValues()
+				.AllowAudioPlayback(false)
+				.CreatePhysicsScene(true)
+				.CreateNavigation(true)
+				.CreateAISystem(false));
+		}
+		World->UpdateWorldComponents(true, false);
+
+		if (UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World))
+		{
+			NavSys->Build();
+		}
+
+		const FString PackageName = UTP3CoverSubsystem::GetCoverDataPackageName(CoverDataDirectory, MapPackage->GetName());
+		const FString AssetName = FPackageName::GetShortName(PackageName);
+		// Re-baking keeps the bake settings edited on an existing asset
+		UPackage* CoverPackage = FPackageName::DoesPackageExist(PackageName) ? LoadPackage(nullptr, *PackageName, LOAD_None) : nullptr;
+		if (!CoverPackage)
+		{
+			CoverPackage = CreatePackage(*PackageName);
+		}
+
+		UTP3CoverData* Data = FindObject<UTP3CoverData>(CoverPackage, *AssetName);
+		if (!Data)
+		{
+			Data = NewObject<UTP3CoverData>(CoverPackage, *AssetName, RF_Public | RF_Standalone);
+		}
+
+		if (const FString* SpacingParam = ParamVals.Find(TEXT("Spacing")))
+		{
+			Data->SampleSpacing = FCString::Atof(**SpacingParam);
+		}
+
+		BakeWorld(*World, *Data);
+		CoverPackage->MarkPackageDirty();
+
+		FSavePackageArgs SaveArgs;
+		SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+		const FString Filename = FPackageName::LongPackageNameToFilename(PackageName, FPackageName::GetAssetPackageExtension());
+		if (!UPackage::SavePackage(CoverPackage, Data, *Filename, SaveArgs))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Cover bake: cannot save %s"), *Filename);
+			++NumErrors;
+		}
+
+		World->RemoveFromRoot();
+		World->DestroyWorld(false);
+		CollectGarbage(RF_NoFlags);
+	}
+
+	return NumErrors > 0 ? 1 : 0;
+#else
+	return 1;
+#endif
+}
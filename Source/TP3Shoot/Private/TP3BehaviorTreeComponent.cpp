@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3BehaviorTreeComponent.h"
+
+bool UTP3BehaviorTreeComponent::bTimeTicks = false;
+FTP3TickTimes UTP3BehaviorTreeComponent::TickTimes;
+
+void UTP3BehaviorTreeComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (!bTimeTicks)
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	const double Start = FPlatformTime::Seconds();
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	TickTimes.Add(Start);
+}
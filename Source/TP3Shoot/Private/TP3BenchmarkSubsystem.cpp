@@ -0,0 +1,268 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3BenchmarkSubsystem.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "BrainComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Crc.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "TP3BehaviorTreeComponent.h"
+#include "TP3BotMovementComponent.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3HitscanSubsystem.h"
+#include "TP3RespawnSubsystem.h"
+#include "UObject/UObjectGlobals.h"
+
+UTP3BenchmarkSubsystem::UTP3BenchmarkSubsystem()
+{
+	AllyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Allie.BPAI_Allie_C")));
+	EnemyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Ennemie.BPAI_Ennemie_C")));
+}
+
+bool UTP3BenchmarkSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	int32 Bots = 0;
+	return FParse::Value(FCommandLine::Get(), TEXT("TP3Benchmark="), Bots) && Bots > 0 && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UTP3BenchmarkSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game;
+}
+
+TStatId UTP3BenchmarkSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3BenchmarkSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3BenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("TP3Benchmark="), NumBots);
+	FParse::Value(CommandLine, TEXT("BenchmarkWarmup="), WarmupSeconds);
+	FParse::Value(CommandLine, TEXT("BenchmarkSeconds="), BenchmarkSeconds);
+	FParse::Value(CommandLine, TEXT("BenchmarkSeed="), RandomSeed);
+	if (!FParse::Value(CommandLine, TEXT("BenchmarkLabel="), Label))
+	{
+		Label = TEXT("local");
+	}
+
+	// Same random streams on every run
+	FMath::RandInit(RandomSeed);
+	FMath::SRandInit(RandomSeed);
+
+	PreGCHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &UTP3BenchmarkSubsystem::OnPreGarbageCollect);
+	PostGCHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &UTP3BenchmarkSubsystem::OnPostGarbageCollect);
+
+	if (!FApp::UseFixedTimeStep())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Benchmark: no fixed time step, add -benchmark -fps=30 for comparable runs"));
+	}
+}
+
+void UTP3BenchmarkSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGCHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGCHandle);
+	UTP3BehaviorTreeComponent::bTimeTicks = false;
+	UTP3BotMovementComponent::bTimeTicks = false;
+	Bots.Reset();
+
+	Super::Deinitialize();
+}
+
+void UTP3BenchmarkSubsystem::SpawnBots()
+{
+	UWorld* World = GetWorld();
+
+	// Only the benchmark bots, so N is exact
+	for (TActorIterator<AAI_Player> It(World); It; ++It)
+	{
+		It->Destroy();
+	}
+
+	UClass* AllyClass = AllyBotClass.LoadSynchronous();
+	UClass* EnemyClass = EnemyBotClass.LoadSynchronous();
+	if (!AllyClass || !EnemyClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Benchmark: cannot load the bot classes"));
+		return;
+	}
+
+	UTP3RespawnSubsystem* Respawn = World->GetSubsystem<UTP3RespawnSubsystem>();
+
+	// The components time their own ticks, so their tick state and interval stay untouched
+	UTP3BehaviorTreeComponent::bTimeTicks = true;
+	UTP3BotMovementComponent::bTimeTicks = true;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < NumBots; ++Index)
+	{
+		UClass* BotClass = Index % 2 == 0 ? AllyClass : EnemyClass;
+		const uint8 Team = UTP3CombatantRegistry::ToTeamId(BotClass->GetDefaultObject<AAI_Player>()->Team);
+		const FVector Location = Respawn ? Respawn->PickSpawnPoint(Team) : FVector(0.f, 0.f, 100.f * Index);
+		AAI_Player* Bot = World->SpawnActor<AAI_Player>(BotClass, Location + FVector(0.f, 0.f, 100.f), FRotator::ZeroRotator, SpawnParams);
+		if (!Bot)
+		{
+			continue;
+		}
+
+		if (!Bot->GetController())
+		{
+			Bot->SpawnDefaultController();
+		}
+
+		Bots.AddDefaulted_GetRef().Bot = Bot;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Benchmark: %d bots, %.0fs warm up, %.0fs measured"), Bots.Num(), WarmupSeconds, BenchmarkSeconds);
+}
+
+void UTP3BenchmarkSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bSpawned)
+	{
+		bSpawned = true;
+		SpawnBots();
+		LastFrameWallTime = FPlatformTime::Seconds();
+		return;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	const float WallMs = (Now - LastFrameWallTime) * 1000.0;
+	LastFrameWallTime = Now;
+	SimulatedTime += DeltaTime;
+
+	const UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>();
+	const int64 Traces = Hitscan ? Hitscan->GetNumTraces() : 0;
+
+	if (SimulatedTime < WarmupSeconds)
+	{
+		FrameMs.Reset();
+		UTP3BotMovementComponent::WalkingTimes = FTP3TickTimes();
+		UTP3BotMovementComponent::NavWalkingTimes = FTP3TickTimes();
+		UTP3BotMovementComponent::OtherTimes = FTP3TickTimes();
+		NumBrainTicks = 0;
+		UTP3BehaviorTreeComponent::TickTimes = FTP3TickTimes();
+		NumGCs = 0;
+		GCMsTotal = 0.0;
+		GCMsMax = 0.0;
+		TracesAtStart = Traces;
+		return;
+	}
+
+	FrameMs.Add(WallMs);
+
+	// Brains that ticked this frame
+	const float FrameStartTime = GetWorld()->GetTimeSeconds() - DeltaTime * 0.5f;
+	for (const FBenchmarkBot& Entry : Bots)
+	{
+		const AAI_Player* Bot = Entry.Bot.Get();
+		const AAIController* Controller = Bot ? Cast<AAIController>(Bot->GetController()) : nullptr;
+		const UBrainComponent* Brain = Controller ? Controller->GetBrainComponent() : nullptr;
+		if (Brain && Brain->PrimaryComponentTick.GetLastTickGameTimeSeconds() >= FrameStartTime)
+		{
+			++NumBrainTicks;
+		}
+	}
+
+	if (SimulatedTime >= WarmupSeconds + BenchmarkSeconds)
+	{
+		bFinished = true;
+		TracesAtEnd = Traces;
+		BrainTimes = UTP3BehaviorTreeComponent::TickTimes;
+		WalkingTimes = UTP3BotMovementComponent::WalkingTimes;
+		NavWalkingTimes = UTP3BotMovementComponent::NavWalkingTimes;
+		OtherMovementTimes = UTP3BotMovementComponent::OtherTimes;
+		WriteResults();
+		FPlatformMisc::RequestExit(false, TEXT("TP3Benchmark"));
+	}
+}
+
+// Columns of the CSV, a new file is started whenever they change
+static const TCHAR* BenchmarkCsvHeader = TEXT("label,map,bots,sim_seconds,frames,frame_ms_p50,frame_ms_p90,frame_ms_p99,frame_ms_max,traces_per_s,bt_ticks_per_s,bt_ms_per_frame,bt_tick_us,movement_ms_per_frame,movement_us_per_agent,walking_tick_us,navwalking_tick_us,navwalking_tick_share,gc_count,gc_ms_total,gc_ms_max,peak_mem_mb,trace_us");
+
+void UTP3BenchmarkSubsystem::OnPreGarbageCollect()
+{
+	GCStartTime = FPlatformTime::Seconds();
+}
+
+void UTP3BenchmarkSubsystem::OnPostGarbageCollect()
+{
+	const double Ms = (FPlatformTime::Seconds() - GCStartTime) * 1000.0;
+	++NumGCs;
+	GCMsTotal += Ms;
+	GCMsMax = FMath::Max(GCMsMax, Ms);
+}
+
+void UTP3BenchmarkSubsystem::WriteResults() const
+{
+	TArray<float> Sorted = FrameMs;
+	Sorted.Sort();
+	auto Percentile = [&Sorted](float P) -> float
+		{
+			return Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::FloorToInt(P * (Sorted.Num() - 1)), 0, Sorted.Num() - 1)] : 0.f;
+		};
+
+	const int32 NumFrames = FMath::Max(1, FrameMs.Num());
+	const double MovementMs = WalkingTimes.Ms + NavWalkingTimes.Ms + OtherMovementTimes.Ms;
+	const int64 NumGroundTicks = WalkingTimes.NumTicks + NavWalkingTimes.NumTicks;
+	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+	const UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>();
+
+	// Named after the columns, so rows of commits with other columns never end up under this header
+	const FString Filename = FPaths::ProjectSavedDir() / TEXT("Benchmark") / FString::Printf(TEXT("TP3Benchmark_%08x.csv"), FCrc::StrCrc32(BenchmarkCsvHeader));
+	FString Text;
+	if (!FPlatformFileManager::Get().GetPlatformFile().FileExists(*Filename))
+	{
+		Text += BenchmarkCsvHeader;
+		Text += TEXT("\n");
+	}
+
+	Text += FString::Printf(TEXT("%s,%s,%d,%.1f,%d,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.2f,%.2f,%.1f,%.2f\n"),
+		*Label,
+		*GetWorld()->GetMapName(),
+		Bots.Num(),
+		BenchmarkSeconds,
+		FrameMs.Num(),
+		Percentile(0.5f),
+		Percentile(0.9f),
+		Percentile(0.99f),
+		Percentile(1.f),
+		(TracesAtEnd - TracesAtStart) / FMath::Max(BenchmarkSeconds, 1.f),
+		NumBrainTicks / FMath::Max(BenchmarkSeconds, 1.f),
+		BrainTimes.Ms / NumFrames,
+		BrainTimes.NumTicks > 0 ? BrainTimes.Ms * 1000.0 / BrainTimes.NumTicks : 0.0,
+		MovementMs / NumFrames,
+		MovementMs * 1000.0 / (NumFrames * FMath::Max(1, Bots.Num())),
+		WalkingTimes.NumTicks > 0 ? WalkingTimes.Ms * 1000.0 / WalkingTimes.NumTicks : 0.0,
+		NavWalkingTimes.NumTicks > 0 ? NavWalkingTimes.Ms * 1000.0 / NavWalkingTimes.NumTicks : 0.0,
+		double(NavWalkingTimes.NumTicks) / FMath::Max<int64>(1, NumGroundTicks),
+		NumGCs,
+		GCMsTotal,
+		GCMsMax,
+		MemoryStats.PeakUsedPhysical / (1024.0 * 1024.0),
+		Hitscan ? Hitscan->GetAvgSyncTraceMs() * 1000.0 : 0.0);
+
+	FFileHelper::SaveStringToFile(Text, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM, &IFileManager::Get(), FILEWRITE_Append);
+	UE_LOG(LogTemp, Display, TEXT("Benchmark: results appended to %s"), *Filename);
+}
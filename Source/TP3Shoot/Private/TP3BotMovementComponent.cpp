@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3BotMovementComponent.h"
+
+bool UTP3BotMovementComponent::bTimeTicks = false;
+FTP3TickTimes UTP3BotMovementComponent::WalkingTimes;
+FTP3TickTimes UTP3BotMovementComponent::NavWalkingTimes;
+FTP3TickTimes UTP3BotMovementComponent::OtherTimes;
+
+void UTP3BotMovementComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	if (!bTimeTicks)
+	{
+		Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+		return;
+	}
+
+	FTP3TickTimes& Times = MovementMode == MOVE_Walking ? WalkingTimes : MovementMode == MOVE_NavWalking ? NavWalkingTimes : OtherTimes;
+	const double Start = FPlatformTime::Seconds();
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	Times.Add(Start);
+}
@@ -0,0 +1,337 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3CombatantGridSubsystem.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Combatant grid update"), STAT_TP3Grid_Update, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Combatant grid query"), STAT_TP3Grid_Query, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Combatant grid cell moves"), STAT_TP3Grid_CellMoves, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<float> CVarCombatantGridCellSize(
+	TEXT("tp3.CombatantGrid.CellSize"),
+	2000.f,
+	TEXT("Size in cm of the cells of the combatant grid. Read when the world starts."));
+
+void UTP3CombatantGridSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	CellSize = FMath::Max(100.f, CVarCombatantGridCellSize.GetValueOnGameThread());
+}
+
+void UTP3CombatantGridSubsystem::Deinitialize()
+{
+	Entries.Reset();
+	FreeEntries.Reset();
+	EntryByActor.Reset();
+	Partitions.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3CombatantGridSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3CombatantGridSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3CombatantGridSubsystem, STATGROUP_Tickables);
+}
+
+FIntPoint UTP3CombatantGridSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+UTP3CombatantGridSubsystem::FTeamPartition& UTP3CombatantGridSubsystem::FindOrAddPartition(int32 Team)
+{
+	for (FTeamPartition& Partition : Partitions)
+	{
+		if (Partition.Team == Team)
+		{
+			return Partition;
+		}
+	}
+
+	FTeamPartition& Partition = Partitions.AddDefaulted_GetRef();
+	Partition.Team = Team;
+	return Partition;
+}
+
+void UTP3CombatantGridSubsystem::AddToCell(int32 EntryIndex)
+{
+	const FEntry& Entry = Entries[EntryIndex];
+	FTeamPartition& Partition = FindOrAddPartition(Entry.Team);
+	Partition.Cells.FindOrAdd(Entry.Cell).Add(EntryIndex);
+	++Partition.NumEntries;
+}
+
+void UTP3CombatantGridSubsystem::RemoveFromCell(int32 EntryIndex)
+{
+	const FEntry& Entry = Entries[EntryIndex];
+	FTeamPartition& Partition = FindOrAddPartition(Entry.Team);
+	if (TArray<int32, TInlineAllocator<8>>* Cell = Partition.Cells.Find(Entry.Cell))
+	{
+		Cell->RemoveSingleSwap(EntryIndex, EAllowShrinking::No);
+		if (Cell->Num() == 0)
+		{
+			Partition.Cells.Remove(Entry.Cell);
+		}
+		--Partition.NumEntries;
+	}
+}
+
+void UTP3CombatantGridSubsystem::Register(AActor* Combatant, int32 Team)
+{
+	if (!Combatant || EntryByActor.Contains(Combatant))
+	{
+		return;
+	}
+
+	const int32 EntryIndex = FreeEntries.Num() > 0 ? FreeEntries.Pop(EAllowShrinking::No) : Entries.AddDefaulted();
+	FEntry& Entry = Entries[EntryIndex];
+	Entry.Actor = Combatant;
+	Entry.Location = Combatant->GetActorLocation();
+	Entry.Cell = GetCell(Entry.Location);
+	Entry.Team = Team;
+
+	EntryByActor.Add(Combatant, EntryIndex);
+	AddToCell(EntryIndex);
+}
+
+void UTP3CombatantGridSubsystem::Unregister(AActor* Combatant)
+{
+	int32 EntryIndex;
+	if (!EntryByActor.RemoveAndCopyValue(Combatant, EntryIndex))
+	{
+		return;
+	}
+
+	RemoveFromCell(EntryIndex);
+	Entries[EntryIndex] = FEntry();
+	FreeEntries.Add(EntryIndex);
+}
+
+int32 UTP3CombatantGridSubsystem::GetTeam(const AActor* Combatant) const
+{
+	const int32* EntryIndex = EntryByActor.Find(Combatant);
+	return EntryIndex ? Entries[*EntryIndex].Team : INDEX_NONE;
+}
+
+void UTP3CombatantGridSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Grid_Update);
+
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); ++EntryIndex)
+	{
+		FEntry& Entry = Entries[EntryIndex];
+		const AActor* Actor = Entry.Actor.Get();
+		if (!Actor)
+		{
+			continue;
+		}
+
+		Entry.Location = Actor->GetActorLocation();
+
+		// Only combatants crossing a cell border touch the partition
+		const FIntPoint NewCell = GetCell(Entry.Location);
+		if (NewCell != Entry.Cell)
+		{
+			RemoveFromCell(EntryIndex);
+			Entry.Cell = NewCell;
+			AddToCell(EntryIndex);
+			INC_DWORD_STAT(STAT_TP3Grid_CellMoves);
+		}
+	}
+}
+
+void UTP3CombatantGridSubsystem::GatherInRadius(const FVector& Origin, float Radius, int32 Team, bool bEnemies, TArray<AActor*>& OutActors) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Grid_Query);
+
+	const double RadiusSq = FMath::Square(Radius);
+	const FIntPoint MinCell = GetCell(Origin - FVector(Radius));
+	const FIntPoint MaxCell = GetCell(Origin + FVector(Radius));
+
+	for (const FTeamPartition& Partition : Partitions)
+	{
+		if ((Partition.Team != Team) != bEnemies)
+		{
+			continue;
+		}
+
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+			{
+				const TArray<int32, TInlineAllocator<8>>* Cell = Partition.Cells.Find(FIntPoint(X, Y));
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (const int32 EntryIndex : *Cell)
+				{
+					const FEntry& Entry = Entries[EntryIndex];
+					if (FVector::DistSquared(Entry.Location, Origin) <= RadiusSq)
+					{
+						if (AActor* Actor = Entry.Actor.Get())
+						{
+							OutActors.Add(Actor);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void UTP3CombatantGridSubsystem::FindEnemiesInRadius(const FVector& Origin, float Radius, int32 Team, TArray<AActor*>& OutEnemies) const
+{
+	GatherInRadius(Origin, Radius, Team, true, OutEnemies);
+}
+
+void UTP3CombatantGridSubsystem::FindAlliesInRadius(const FVector& Origin, float Radius, int32 Team, TArray<AActor*>& OutAllies) const
+{
+	GatherInRadius(Origin, Radius, Team, false, OutAllies);
+}
+
+AActor* UTP3CombatantGridSubsystem::FindNearestEnemy(const FVector& Origin, int32 Team, float MaxRadius) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Grid_Query);
+
+	const int32 MaxRing = FMath::CeilToInt(MaxRadius / CellSize);
+	const FIntPoint Center = GetCell(Origin);
+
+	int32 BestEntry = INDEX_NONE;
+	double BestDistSq = FMath::Square(MaxRadius);
+
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		for (int32 X = Center.X - Ring; X <= Center.X + Ring; ++X)
+		{
+			const int32 StepY = (X == Center.X - Ring || X == Center.X + Ring) ? 1 : FMath::Max(1, 2 * Ring);
+			for (int32 Y = Center.Y - Ring; Y <= Center.Y + Ring; Y += StepY)
+			{
+				for (const FTeamPartition& Partition : Partitions)
+				{
+					if (Partition.Team == Team)
+					{
+						continue;
+					}
+
+					if (const TArray<int32, TInlineAllocator<8>>* Cell = Partition.Cells.Find(FIntPoint(X, Y)))
+					{
+						for (const int32 EntryIndex : *Cell)
+						{
+							const double DistSq = FVector::DistSquared(Entries[EntryIndex].Location, Origin);
+							if (DistSq <= BestDistSq && Entries[EntryIndex].Actor.IsValid())
+							{
+								BestDistSq = DistSq;
+								BestEntry = EntryIndex;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		// Nothing in the next ring can be closer than Ring cells
+		if (BestEntry != INDEX_NONE && BestDistSq <= FMath::Square(Ring * CellSize))
+		{
+			break;
+		}
+	}
+
+	return BestEntry != INDEX_NONE ? Entries[BestEntry].Actor.Get() : nullptr;
+}
+
+void UTP3CombatantGridSubsystem::FindNearestEnemies(const FVector& Origin, int32 Team, int32 Count, float MaxRadius, TArray<AActor*>& OutEnemies) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Grid_Query);
+
+	if (Count <= 0)
+	{
+		return;
+	}
+
+	int32 NumEnemies = 0;
+	for (const FTeamPartition& Partition : Partitions)
+	{
+		NumEnemies += Partition.Team != Team ? Partition.NumEntries : 0;
+	}
+
+	const double MaxRadiusSq = FMath::Square(MaxRadius);
+	const int32 MaxRing = FMath::CeilToInt(MaxRadius / CellSize);
+	const FIntPoint Center = GetCell(Origin);
+
+	TArray<FCandidate, TInlineAllocator<32>> Candidates;
+	int32 NumVisited = 0;
+
+	// Visit square rings of cells around the origin, nearest first
+	for (int32 Ring = 0; Ring <= MaxRing && NumVisited < NumEnemies; ++Ring)
+	{
+		for (int32 X = Center.X - Ring; X <= Center.X + Ring; ++X)
+		{
+			// Inner rows only need the two border cells of the ring
+			const int32 StepY = (X == Center.X - Ring || X == Center.X + Ring) ? 1 : FMath::Max(1, 2 * Ring);
+			for (int32 Y = Center.Y - Ring; Y <= Center.Y + Ring; Y += StepY)
+			{
+				for (const FTeamPartition& Partition : Partitions)
+				{
+					if (Partition.Team == Team)
+					{
+						continue;
+					}
+
+					const TArray<int32, TInlineAllocator<8>>* Cell = Partition.Cells.Find(FIntPoint(X, Y));
+					if (!Cell)
+					{
+						continue;
+					}
+
+					NumVisited += Cell->Num();
+					for (const int32 EntryIndex : *Cell)
+					{
+						const double DistSq = FVector::DistSquared(Entries[EntryIndex].Location, Origin);
+						if (DistSq <= MaxRadiusSq)
+						{
+							Candidates.Add({ EntryIndex, DistSq });
+						}
+					}
+				}
+			}
+		}
+
+		// Anything in the next ring is at least Ring cells away from the origin
+		if (Candidates.Num() >= Count)
+		{
+			Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistSq < B.DistSq; });
+			if (Candidates[Count - 1].DistSq <= FMath::Square(Ring * CellSize))
+			{
+				break;
+			}
+		}
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.DistSq < B.DistSq; });
+	int32 NumFound = 0;
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (NumFound >= Count)
+		{
+			break;
+		}
+		if (AActor* Actor = Entries[Candidate.EntryIndex].Actor.Get())
+		{
+			OutEnemies.Add(Actor);
+			++NumFound;
+		}
+	}
+}
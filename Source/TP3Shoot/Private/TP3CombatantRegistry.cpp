@@ -0,0 +1,330 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3CombatantRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "TP3CombatantGridSubsystem.h"
+#include "TP3MatchRecorderSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Registry position refresh"), STAT_TP3Registry_Refresh, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Registry range pass"), STAT_TP3Registry_RangePass, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Registered combatants"), STAT_TP3Registry_Combatants, STATGROUP_TP3Shoot);
+
+void UTP3CombatantRegistry::Deinitialize()
+{
+	TeamIds.Reset();
+	AliveFlags.Reset();
+	Lives.Reset();
+	MaxLives.Reset();
+	PosX.Reset();
+	PosY.Reset();
+	PosZ.Reset();
+	Actors.Reset();
+	LifeChangedDelegates.Reset();
+	FreeIds.Reset();
+	IdByActor.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3CombatantRegistry::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3CombatantRegistry::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3CombatantRegistry, STATGROUP_Tickables);
+}
+
+int32 UTP3CombatantRegistry::Register(AActor* Combatant, float Team, float MaxLife, FTP3OnCombatantLifeChanged&& OnLifeChanged)
+{
+	if (!Combatant)
+	{
+		return INDEX_NONE;
+	}
+
+	if (const int32* ExistingId = IdByActor.Find(Combatant))
+	{
+		return *ExistingId;
+	}
+
+	int32 Id;
+	if (FreeIds.Num() > 0)
+	{
+		Id = FreeIds.Pop(EAllowShrinking::No);
+	}
+	else
+	{
+		Id = Actors.AddDefaulted();
+		TeamIds.AddDefaulted();
+		AliveFlags.AddDefaulted();
+		Lives.AddDefaulted();
+		MaxLives.AddDefaulted();
+		PosX.AddDefaulted();
+		PosY.AddDefaulted();
+		PosZ.AddDefaulted();
+		LifeChangedDelegates.AddDefaulted();
+	}
+
+	const FVector Location = Combatant->GetActorLocation();
+	TeamIds[Id] = ToTeamId(Team);
+	AliveFlags[Id] = 1;
+	Lives[Id] = MaxLife;
+	MaxLives[Id] = MaxLife;
+	PosX[Id] = Location.X;
+	PosY[Id] = Location.Y;
+	PosZ[Id] = Location.Z;
+	Actors[Id] = Combatant;
+	LifeChangedDelegates[Id] = MoveTemp(OnLifeChanged);
+
+	IdByActor.Add(Combatant, Id);
+	INC_DWORD_STAT(STAT_TP3Registry_Combatants);
+
+	if (UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+	{
+		Grid->Register(Combatant, TeamIds[Id]);
+	}
+
+	if (Recorder)
+	{
+		Recorder->RecordSpawn(Id, *Combatant, TeamIds[Id], MaxLife);
+	}
+
+	return Id;
+}
+
+void UTP3CombatantRegistry::Unregister(int32 CombatantId)
+{
+	if (!IsValidCombatant(CombatantId))
+	{
+		return;
+	}
+
+	if (AActor* Actor = Actors[CombatantId].Get())
+	{
+		IdByActor.Remove(Actor);
+
+		if (UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+		{
+			Grid->Unregister(Actor);
+		}
+	}
+	else
+	{
+		// The actor is already gone, only the id is left to find its key
+		for (auto It = IdByActor.CreateIterator(); It; ++It)
+		{
+			if (It.Value() == CombatantId)
+			{
+				It.RemoveCurrent();
+				break;
+			}
+		}
+	}
+
+	if (Recorder)
+	{
+		Recorder->RecordDespawn(CombatantId);
+	}
+
+	TeamIds[CombatantId] = InvalidTeam;
+	AliveFlags[CombatantId] = 0;
+	Lives[CombatantId] = 0.f;
+	Actors[CombatantId].Reset();
+	LifeChangedDelegates[CombatantId].Unbind();
+	FreeIds.Add(CombatantId);
+	DEC_DWORD_STAT(STAT_TP3Registry_Combatants);
+}
+
+int32 UTP3CombatantRegistry::FindCombatant(const AActor* Actor) const
+{
+	const int32* Id = IdByActor.Find(Actor);
+	return Id ? *Id : INDEX_NONE;
+}
+
+void UTP3CombatantRegistry::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Registry_Refresh);
+
+	for (int32 Id = 0; Id < Actors.Num(); ++Id)
+	{
+		if (const AActor* Actor = Actors[Id].Get())
+		{
+			const FVector Location = Actor->GetActorLocation();
+			PosX[Id] = Location.X;
+			PosY[Id] = Location.Y;
+			PosZ[Id] = Location.Z;
+		}
+	}
+}
+
+bool UTP3CombatantRegistry::ApplyDamage(int32 CombatantId, float Amount)
+{
+	if (!IsValidCombatant(CombatantId) || !AliveFlags[CombatantId])
+	{
+		return false;
+	}
+
+	TP3_COUNT_COMBAT_EVENT(Hits);
+
+	Lives[CombatantId] -= Amount;
+	const bool bKilled = Lives[CombatantId] <= 0.f;
+	if (bKilled)
+	{
+		TP3_COUNT_COMBAT_EVENT(Kills);
+
+		Lives[CombatantId] = 0.f;
+		AliveFlags[CombatantId] = 0;
+
+		// Dead combatants are not targets until they are revived
+		if (UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+		{
+			Grid->Unregister(Actors[CombatantId].Get());
+		}
+	}
+
+	if (Recorder)
+	{
+		Recorder->RecordDamage(CombatantId, Amount, bKilled);
+	}
+
+	LifeChangedDelegates[CombatantId].ExecuteIfBound(CombatantId, bKilled);
+	if (bKilled)
+	{
+		OnCombatantKilled.Broadcast(CombatantId);
+	}
+	return bKilled;
+}
+
+bool UTP3CombatantRegistry::TryDamageEnemy(int32 AttackerId, const AActor* Target, float Amount)
+{
+	const int32 TargetId = FindCombatant(Target);
+	if (TargetId == INDEX_NONE || !IsValidCombatant(AttackerId) || !AreEnemies(AttackerId, TargetId))
+	{
+		return false;
+	}
+
+	ApplyDamage(TargetId, Amount);
+	return true;
+}
+
+void UTP3CombatantRegistry::Revive(int32 CombatantId)
+{
+	if (!IsValidCombatant(CombatantId))
+	{
+		return;
+	}
+
+	const bool bWasDead = !AliveFlags[CombatantId];
+	Lives[CombatantId] = MaxLives[CombatantId];
+	AliveFlags[CombatantId] = 1;
+
+	if (bWasDead)
+	{
+		if (UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+		{
+			Grid->Register(Actors[CombatantId].Get(), TeamIds[CombatantId]);
+		}
+
+		// The cached position is refreshed next tick, the actor was just moved to its spawn point
+		const AActor* Actor = Actors[CombatantId].Get();
+		if (Recorder && Actor)
+		{
+			Recorder->RecordRespawn(CombatantId, Actor->GetActorLocation());
+		}
+	}
+
+	LifeChangedDelegates[CombatantId].ExecuteIfBound(CombatantId, false);
+}
+
+void UTP3CombatantRegistry::SetLife(int32 CombatantId, float NewLife)
+{
+	if (!IsValidCombatant(CombatantId) || !AliveFlags[CombatantId])
+	{
+		return;
+	}
+
+	Lives[CombatantId] = FMath::Clamp(NewLife, 1.f, MaxLives[CombatantId]);
+	LifeChangedDelegates[CombatantId].ExecuteIfBound(CombatantId, false);
+}
+
+void UTP3CombatantRegistry::ApplyReplicatedLife(int32 CombatantId, float NewLife)
+{
+	if (!IsValidCombatant(CombatantId))
+	{
+		return;
+	}
+
+	const bool bWasAlive = AliveFlags[CombatantId] != 0;
+	const bool bAlive = NewLife > 0.f;
+	Lives[CombatantId] = FMath::Max(NewLife, 0.f);
+	MaxLives[CombatantId] = FMath::Max(MaxLives[CombatantId], NewLife);
+	AliveFlags[CombatantId] = bAlive;
+
+	if (bWasAlive != bAlive)
+	{
+		if (UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>())
+		{
+			if (bAlive)
+			{
+				Grid->Register(Actors[CombatantId].Get(), TeamIds[CombatantId]);
+			}
+			else
+			{
+				Grid->Unregister(Actors[CombatantId].Get());
+			}
+		}
+	}
+
+	// Never reported as a kill, the respawn is driven by the server
+	LifeChangedDelegates[CombatantId].ExecuteIfBound(CombatantId, false);
+}
+
+void UTP3CombatantRegistry::GatherEnemiesInRange(uint8 Team, const FVector& Origin, float Range, TArray<int32>& OutIds) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Registry_RangePass);
+
+	const float OriginX = Origin.X;
+	const float OriginY = Origin.Y;
+	const float OriginZ = Origin.Z;
+	const float RangeSq = FMath::Square(Range);
+
+	const uint8* RESTRICT Teams = TeamIds.GetData();
+	const uint8* RESTRICT Alive = AliveFlags.GetData();
+	const float* RESTRICT X = PosX.GetData();
+	const float* RESTRICT Y = PosY.GetData();
+	const float* RESTRICT Z = PosZ.GetData();
+
+	// Branch free test over the flat arrays so the compiler can vectorize it
+	const int32 Num = TeamIds.Num();
+	for (int32 Id = 0; Id < Num; ++Id)
+	{
+		const float DX = X[Id] - OriginX;
+		const float DY = Y[Id] - OriginY;
+		const float DZ = Z[Id] - OriginZ;
+		const bool bMatch = (Teams[Id] != Team) & (Teams[Id] != InvalidTeam) & (Alive[Id] != 0) & (DX * DX + DY * DY + DZ * DZ <= RangeSq);
+		if (bMatch)
+		{
+			OutIds.Add(Id);
+		}
+	}
+}
+
+void UTP3CombatantRegistry::GatherEnemiesInRangeParallel(TConstArrayView<FTP3RangeQuery> Queries, TArray<TArray<int32>>& OutIds) const
+{
+	OutIds.SetNum(Queries.Num());
+
+	ParallelFor(Queries.Num(), [this, &Queries, &OutIds](int32 QueryIndex)
+		{
+			const FTP3RangeQuery& Query = Queries[QueryIndex];
+			TArray<int32>& Result = OutIds[QueryIndex];
+			Result.Reset();
+			GatherEnemiesInRange(Query.Team, Query.Origin, Query.Range, Result);
+		});
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3CoverData.h"
+
+FVector FTP3CoverPoint::GetDirection(int32 Index)
+{
+	const float Angle = 2.f * PI * Index / NumDirections;
+	return FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+}
+
+float FTP3CoverPoint::GetExposure(const FVector& ToThreat) const
+{
+	float Angle = FMath::Atan2(ToThreat.Y, ToThreat.X);
+	if (Angle < 0.f)
+	{
+		Angle += 2.f * PI;
+	}
+
+	const float Sector = Angle * NumDirections / (2.f * PI);
+	const int32 Lower = FMath::FloorToInt(Sector) % NumDirections;
+	const int32 Upper = (Lower + 1) % NumDirections;
+	const float Alpha = Sector - FMath::FloorToFloat(Sector);
+
+	return FMath::Lerp((float)Exposure[Lower], (float)Exposure[Upper], Alpha) / 255.f;
+}
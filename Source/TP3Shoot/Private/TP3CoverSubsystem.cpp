@@ -0,0 +1,130 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3CoverSubsystem.h"
+#include "Engine/World.h"
+#include "Misc/PackageName.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cover query"), STAT_TP3Cover_Query, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Cover points"), STAT_TP3Cover_Points, STATGROUP_TP3Shoot);
+
+FString UTP3CoverSubsystem::GetCoverDataPackageName(const FString& CoverDataDirectory, const FString& MapPackageName)
+{
+	return CoverDataDirectory / FPackageName::GetShortName(UWorld::RemovePIEPrefix(MapPackageName)) + TEXT("_Cover");
+}
+
+void UTP3CoverSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const FString PackageName = GetCoverDataPackageName(CoverDataDirectory, InWorld.GetOutermost()->GetName());
+	const FString ObjectPath = PackageName + TEXT(".") + FPackageName::GetShortName(PackageName);
+	if (!FPackageName::DoesPackageExist(PackageName))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No baked cover data %s, run the TP3BakeCover commandlet"), *PackageName);
+		return;
+	}
+
+	CoverData = LoadObject<UTP3CoverData>(nullptr, *ObjectPath);
+	if (!CoverData)
+	{
+		return;
+	}
+
+	Cells.Reset();
+	for (int32 Index = 0; Index < CoverData->Points.Num(); ++Index)
+	{
+		Cells.FindOrAdd(GetCell(FVector(CoverData->Points[Index].Location))).Add(Index);
+	}
+
+	SET_DWORD_STAT(STAT_TP3Cover_Points, CoverData->Points.Num());
+	UE_LOG(LogTemp, Log, TEXT("Cover: %d points loaded from %s"), CoverData->Points.Num(), *PackageName);
+}
+
+void UTP3CoverSubsystem::Deinitialize()
+{
+	CoverData = nullptr;
+	Cells.Reset();
+	SET_DWORD_STAT(STAT_TP3Cover_Points, 0);
+
+	Super::Deinitialize();
+}
+
+bool UTP3CoverSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+FIntPoint UTP3CoverSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UTP3CoverSubsystem::GatherCoverPoints(const FVector& Origin, float Radius, TArray<int32>& OutIndices) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Cover_Query);
+
+	if (!CoverData)
+	{
+		return;
+	}
+
+	const double RadiusSq = FMath::Square(Radius);
+	const FIntPoint MinCell = GetCell(Origin - FVector(Radius));
+	const FIntPoint MaxCell = GetCell(Origin + FVector(Radius));
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			if (const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (const int32 Index : *Cell)
+				{
+					if (FVector::DistSquared(FVector(CoverData->Points[Index].Location), Origin) <= RadiusSq)
+					{
+						OutIndices.Add(Index);
+					}
+				}
+			}
+		}
+	}
+}
+
+int32 UTP3CoverSubsystem::FindCoverPointAt(const FVector& Location, float Tolerance) const
+{
+	if (!CoverData)
+	{
+		return INDEX_NONE;
+	}
+
+	if (const TArray<int32>* Cell = Cells.Find(GetCell(Location)))
+	{
+		for (const int32 Index : *Cell)
+		{
+			if (FVector::DistSquared(FVector(CoverData->Points[Index].Location), Location) <= FMath::Square(Tolerance))
+			{
+				return Index;
+			}
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+float UTP3CoverSubsystem::GetExposure(int32 Index, const FVector& ThreatLocation) const
+{
+	const FTP3CoverPoint& Point = CoverData->Points[Index];
+	const FVector ToThreat = ThreatLocation - FVector(Point.Location);
+
+	const float Exposure = Point.GetExposure(ToThreat);
+	if (Exposure >= 1.f)
+	{
+		return 1.f;
+	}
+
+	// A wall right next to the point covers it more than one half way to the threat
+	const float FreeDistance = Exposure * CoverData->ExposureDistance;
+	return FMath::Min(FreeDistance / FMath::Max(ToThreat.Size2D(), 1.f), 1.f);
+}
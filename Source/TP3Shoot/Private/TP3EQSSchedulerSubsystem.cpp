@@ -0,0 +1,231 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3EQSSchedulerSubsystem.h"
+#include "Engine/World.h"
+#include "EnvironmentQuery/EnvQuery.h"
+#include "EnvironmentQuery/EnvQueryManager.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3SignificanceSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("EQS scheduler start"), STAT_TP3EQS_Start, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS queries executed"), STAT_TP3EQS_Executed, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS queries served from cache"), STAT_TP3EQS_Cached, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("EQS queries joined"), STAT_TP3EQS_Joined, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("EQS queries waiting"), STAT_TP3EQS_Waiting, STATGROUP_TP3Shoot);
+
+void UTP3EQSSchedulerSubsystem::Deinitialize()
+{
+	// Running queries are aborted with the world, their callbacks find nothing to dispatch to
+	Queries.Reset();
+	Scheduled.Reset();
+	KeyByQueryId.Reset();
+	KeyByRequestId.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3EQSSchedulerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3EQSSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3EQSSchedulerSubsystem, STATGROUP_Tickables);
+}
+
+TSharedPtr<FEnvQueryResult> UTP3EQSSchedulerSubsystem::RequestQuery(UEnvQuery* Template, EEnvQueryRunMode::Type RunMode, AActor& Querier, FTP3OnSharedQueryFinished&& OnFinished, int32& OutRequestId)
+{
+	OutRequestId = INDEX_NONE;
+	if (!Template)
+	{
+		return nullptr;
+	}
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	const int32 CombatantId = Registry ? Registry->FindCombatant(&Querier) : INDEX_NONE;
+	const FVector Location = Querier.GetActorLocation();
+
+	FSharedQueryKey Key;
+	Key.Template = Template;
+	Key.Cell = FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+	Key.Team = CombatantId != INDEX_NONE ? Registry->GetTeam(CombatantId) : 0xFF;
+	Key.RunMode = uint8(RunMode);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	FSharedQuery& Query = Queries.FindOrAdd(Key);
+	if (Query.Result.IsValid() && Now - Query.ResultTime <= ResultTimeToLive)
+	{
+		INC_DWORD_STAT(STAT_TP3EQS_Cached);
+		return Query.Result;
+	}
+
+	OutRequestId = NextRequestId++;
+	KeyByRequestId.Add(OutRequestId, Key);
+
+	FWaiter& Waiter = Query.Waiters.AddDefaulted_GetRef();
+	Waiter.RequestId = OutRequestId;
+	Waiter.Querier = &Querier;
+	Waiter.OnFinished = MoveTemp(OnFinished);
+
+	const UTP3SignificanceSubsystem* Significance = GetWorld()->GetSubsystem<UTP3SignificanceSubsystem>();
+	Query.Priority = FMath::Min(Query.Priority, Significance ? Significance->GetBucket(&Querier) : 0);
+
+	if (Query.bScheduled || Query.QueryId != INDEX_NONE)
+	{
+		INC_DWORD_STAT(STAT_TP3EQS_Joined);
+		return nullptr;
+	}
+
+	Query.Template = Template;
+	Query.RunMode = RunMode;
+	Query.RequestTime = Now;
+	Query.bScheduled = true;
+	Scheduled.Add(Key);
+	return nullptr;
+}
+
+void UTP3EQSSchedulerSubsystem::CancelRequest(int32 RequestId)
+{
+	FSharedQueryKey Key;
+	if (!KeyByRequestId.RemoveAndCopyValue(RequestId, Key))
+	{
+		return;
+	}
+
+	// The query itself keeps going, its result will serve the next requests
+	if (FSharedQuery* Query = Queries.Find(Key))
+	{
+		Query->Waiters.RemoveAll([RequestId](const FWaiter& Waiter) { return Waiter.RequestId == RequestId; });
+	}
+}
+
+void UTP3EQSSchedulerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	StartQueries();
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextPurgeTime)
+	{
+		PurgeResults(Now);
+		NextPurgeTime = Now + 1.0;
+	}
+
+	SET_DWORD_STAT(STAT_TP3EQS_Waiting, Scheduled.Num());
+}
+
+void UTP3EQSSchedulerSubsystem::StartQueries()
+{
+	if (Scheduled.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3EQS_Start);
+
+	// Most significant first, then oldest first
+	Scheduled.StableSort([this](const FSharedQueryKey& A, const FSharedQueryKey& B)
+		{
+			const FSharedQuery& QueryA = Queries.FindChecked(A);
+			const FSharedQuery& QueryB = Queries.FindChecked(B);
+			return QueryA.Priority != QueryB.Priority ? QueryA.Priority < QueryB.Priority : QueryA.RequestTime < QueryB.RequestTime;
+		});
+
+	int32 NumTaken = 0;
+	int32 NumStarted = 0;
+	while (NumTaken < Scheduled.Num() && NumStarted < MaxQueriesPerFrame)
+	{
+		const FSharedQueryKey Key = Scheduled[NumTaken++];
+		FSharedQuery& Query = Queries.FindChecked(Key);
+		Query.bScheduled = false;
+
+		// The query runs for the first querier still waiting, its teammates of the cell get the same result
+		AActor* Querier = nullptr;
+		for (const FWaiter& Waiter : Query.Waiters)
+		{
+			Querier = Waiter.Querier.Get();
+			if (Querier)
+			{
+				break;
+			}
+		}
+
+		UEnvQuery* Template = Query.Template.Get();
+		if (!Querier || !Template)
+		{
+			Query.Waiters.Reset();
+			Query.Priority = MAX_int32;
+			continue;
+		}
+
+		FEnvQueryRequest Request(Template, Querier);
+		Query.QueryId = Request.Execute(Query.RunMode, FQueryFinishedSignature::CreateUObject(this, &UTP3EQSSchedulerSubsystem::OnQueryFinished));
+		if (Query.QueryId != INDEX_NONE)
+		{
+			KeyByQueryId.Add(Query.QueryId, Key);
+			++NumStarted;
+			INC_DWORD_STAT(STAT_TP3EQS_Executed);
+			continue;
+		}
+
+		// The query could not be created, nothing will come back
+		TArray<FWaiter, TInlineAllocator<4>> Waiters = MoveTemp(Query.Waiters);
+		Query.Waiters.Reset();
+		Query.Priority = MAX_int32;
+		for (FWaiter& Waiter : Waiters)
+		{
+			KeyByRequestId.Remove(Waiter.RequestId);
+			Waiter.OnFinished.ExecuteIfBound(nullptr);
+		}
+	}
+
+	Scheduled.RemoveAt(0, NumTaken, EAllowShrinking::No);
+}
+
+void UTP3EQSSchedulerSubsystem::OnQueryFinished(TSharedPtr<FEnvQueryResult> Result)
+{
+	FSharedQueryKey Key;
+	if (!Result.IsValid() || !KeyByQueryId.RemoveAndCopyValue(Result->QueryID, Key))
+	{
+		return;
+	}
+
+	FSharedQuery* Query = Queries.Find(Key);
+	if (!Query)
+	{
+		return;
+	}
+
+	Query->QueryId = INDEX_NONE;
+	Query->Priority = MAX_int32;
+
+	// Aborted and failed results are passed on but never served again
+	const bool bSucceeded = Result->IsSuccessful();
+	Query->Result = bSucceeded ? Result : nullptr;
+	Query->ResultTime = bSucceeded ? GetWorld()->GetTimeSeconds() : -1.0;
+
+	// Waiters may request again from their callback
+	TArray<FWaiter, TInlineAllocator<4>> Waiters = MoveTemp(Query->Waiters);
+	Query->Waiters.Reset();
+	for (FWaiter& Waiter : Waiters)
+	{
+		KeyByRequestId.Remove(Waiter.RequestId);
+		Waiter.OnFinished.ExecuteIfBound(bSucceeded ? Result : nullptr);
+	}
+}
+
+void UTP3EQSSchedulerSubsystem::PurgeResults(double Now)
+{
+	for (auto It = Queries.CreateIterator(); It; ++It)
+	{
+		const FSharedQuery& Query = It.Value();
+		if (!Query.bScheduled && Query.QueryId == INDEX_NONE && Query.Waiters.Num() == 0 && Now - Query.ResultTime > ResultTimeToLive)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
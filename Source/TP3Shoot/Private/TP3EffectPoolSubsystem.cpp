@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3EffectPoolSubsystem.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "Particles/ParticleSystem.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect pool hits"), STAT_TP3EffectPool_Hits, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect pool misses"), STAT_TP3EffectPool_Misses, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect pool culled"), STAT_TP3EffectPool_Culled, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Effect pool component allocations"), STAT_TP3EffectPool_Allocations, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Effect pool components"), STAT_TP3EffectPool_Components, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<int32> CVarEffectPoolSize(
+	TEXT("tp3.EffectPool.Size"),
+	32,
+	TEXT("Number of emitter components pre-warmed per particle template."));
+
+static TAutoConsoleVariable<float> CVarEffectPoolCullDistance(
+	TEXT("tp3.EffectPool.CullDistance"),
+	8000.f,
+	TEXT("Effects further than this from the local player camera are not played. 0 disables distance culling."));
+
+static TAutoConsoleVariable<bool> CVarEffectPoolCullOffscreen(
+	TEXT("tp3.EffectPool.CullOffscreen"),
+	true,
+	TEXT("Do not play effects outside of the local player camera field of view."));
+
+void UTP3EffectPoolSubsystem::Deinitialize()
+{
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3EffectPoolSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Cosmetic only, a dedicated server never draws the shots
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UTP3EffectPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+UParticleSystemComponent* UTP3EffectPoolSubsystem::CreatePooledComponent(UParticleSystem* Template)
+{
+	UWorld* World = GetWorld();
+	AWorldSettings* WorldSettings = World->GetWorldSettings();
+
+	UParticleSystemComponent* Component = NewObject<UParticleSystemComponent>(WorldSettings ? (UObject*)WorldSettings : (UObject*)World);
+	Component->bAutoActivate = false;
+	Component->bAutoDestroy = false;
+	Component->bAllowAnyoneToDestroyMe = true;
+	Component->SetUsingAbsoluteLocation(true);
+	Component->SetUsingAbsoluteRotation(true);
+	Component->SetUsingAbsoluteScale(true);
+	Component->SetTemplate(Template);
+	Component->RegisterComponentWithWorld(World);
+
+	INC_DWORD_STAT(STAT_TP3EffectPool_Allocations);
+	INC_DWORD_STAT(STAT_TP3EffectPool_Components);
+	return Component;
+}
+
+void UTP3EffectPoolSubsystem::Prewarm(UParticleSystem* Template)
+{
+	if (!Template)
+	{
+		return;
+	}
+
+	FTP3EffectPool& Pool = Pools.FindOrAdd(Template);
+	const int32 PoolSize = FMath::Max(1, CVarEffectPoolSize.GetValueOnGameThread());
+	while (Pool.Components.Num() < PoolSize)
+	{
+		Pool.Components.Add(CreatePooledComponent(Template));
+	}
+}
+
+bool UTP3EffectPoolSubsystem::ShouldCull(const FVector& Location)
+{
+	UWorld* World = GetWorld();
+	if (World->GetNetMode() == NM_DedicatedServer)
+	{
+		return true;
+	}
+
+	if (ViewFrame != GFrameCounter)
+	{
+		ViewFrame = GFrameCounter;
+		bHasView = false;
+
+		const APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PlayerController->PlayerCameraManager)
+		{
+			const APlayerCameraManager* Camera = PlayerController->PlayerCameraManager;
+			ViewLocation = Camera->GetCameraLocation();
+			ViewDirection = Camera->GetCameraRotation().Vector();
+			// Half the horizontal FOV plus some margin so effects at the screen edges are kept
+			ViewCosHalfFOV = FMath::Cos(FMath::DegreesToRadians(FMath::Min(Camera->GetFOVAngle() * 0.5f + 15.f, 180.f)));
+			bHasView = true;
+		}
+	}
+
+	// Without a local view (e.g. headless) there is nobody to cull for
+	if (!bHasView)
+	{
+		return false;
+	}
+
+	const FVector ToEffect = Location - ViewLocation;
+	const float CullDistance = CVarEffectPoolCullDistance.GetValueOnGameThread();
+	if (CullDistance > 0.f && ToEffect.SizeSquared() > FMath::Square(CullDistance))
+	{
+		return true;
+	}
+
+	return CVarEffectPoolCullOffscreen.GetValueOnGameThread() && (ToEffect.GetSafeNormal() | ViewDirection) < ViewCosHalfFOV;
+}
+
+void UTP3EffectPoolSubsystem::SpawnEffect(UParticleSystem* Template, const FTransform& Transform)
+{
+	if (!Template)
+	{
+		return;
+	}
+
+	if (ShouldCull(Transform.GetLocation()))
+	{
+		INC_DWORD_STAT(STAT_TP3EffectPool_Culled);
+		return;
+	}
+
+	FTP3EffectPool* Pool = Pools.Find(Template);
+	if (!Pool)
+	{
+		// Templates nobody pre-warmed get their pool on first use
+		Prewarm(Template);
+		Pool = Pools.Find(Template);
+	}
+
+	const int32 Index = Pool->Next;
+	Pool->Next = (Index + 1) % Pool->Components.Num();
+
+	UParticleSystemComponent* Component = Pool->Components[Index];
+	if (!IsValid(Component))
+	{
+		// Destroyed from outside (e.g. level streaming), replace it
+		Component = CreatePooledComponent(Template);
+		Pool->Components[Index] = Component;
+		INC_DWORD_STAT(STAT_TP3EffectPool_Misses);
+	}
+	else if (Component->IsActive())
+	{
+		// The ring wrapped around before the effect finished, the pool is too small for the fire rate
+		Component->DeactivateImmediate();
+		INC_DWORD_STAT(STAT_TP3EffectPool_Misses);
+	}
+	else
+	{
+		INC_DWORD_STAT(STAT_TP3EffectPool_Hits);
+	}
+
+	Component->SetWorldTransform(Transform);
+	Component->ActivateSystem(true);
+}
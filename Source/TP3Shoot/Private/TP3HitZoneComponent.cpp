@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3HitZoneComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+static TAutoConsoleVariable<bool> CVarWeaponLegacyTraces(
+	TEXT("tp3.Weapon.LegacyTraces"),
+	false,
+	TEXT("Shots trace Pawn (player) and Visibility (bots) with complex collision, against the capsules and the level, as before the hit zones."));
+
+namespace TP3HitZone
+{
+	struct FShape
+	{
+		const TCHAR* Name;
+		const TCHAR* Bone;
+		ETP3HitZone Zone;
+		float Radius;
+		float HalfHeight;
+	};
+
+	// Centered on the bone and kept upright, so the character turning does not change them
+	static const FShape Shapes[] =
+	{
+		{ TEXT("HitZoneHead"), TEXT("head"), ETP3HitZone::Head, 14.f, 14.f },
+		{ TEXT("HitZoneTorso"), TEXT("spine_02"), ETP3HitZone::Torso, 24.f, 38.f },
+		{ TEXT("HitZoneLegL"), TEXT("calf_l"), ETP3HitZone::Limb, 11.f, 44.f },
+		{ TEXT("HitZoneLegR"), TEXT("calf_r"), ETP3HitZone::Limb, 11.f, 44.f },
+	};
+}
+
+UTP3HitZoneComponent::UTP3HitZoneComponent()
+{
+	SetCollisionProfileName(TEXT("TP3HitZone"));
+	SetGenerateOverlapEvents(false);
+	SetCanEverAffectNavigation(false);
+	CanCharacterStepUpOn = ECB_No;
+	SetUsingAbsoluteRotation(true);
+	SetUsingAbsoluteScale(true);
+	ShapeColor = FColor::Orange;
+}
+
+void UTP3HitZoneComponent::CreateHitZones(AActor& Owner, USkeletalMeshComponent* Mesh)
+{
+	for (const TP3HitZone::FShape& Shape : TP3HitZone::Shapes)
+	{
+		UTP3HitZoneComponent* HitZone = Owner.CreateDefaultSubobject<UTP3HitZoneComponent>(Shape.Name);
+		HitZone->SetupAttachment(Mesh, Shape.Bone);
+		HitZone->InitCapsuleSize(Shape.Radius, Shape.HalfHeight);
+		HitZone->Zone = Shape.Zone;
+	}
+}
+
+float UTP3HitZoneComponent::GetDamageMultiplier(const FHitResult& Hit)
+{
+	const UTP3HitZoneComponent* HitZone = Cast<UTP3HitZoneComponent>(Hit.GetComponent());
+	return HitZone ? GetDamageMultiplier(HitZone->Zone) : 1.f;
+}
+
+float UTP3HitZoneComponent::GetDamageMultiplier(ETP3HitZone Zone)
+{
+	const UTP3HitZoneComponent* Defaults = GetDefault<UTP3HitZoneComponent>();
+	switch (Zone)
+	{
+	case ETP3HitZone::Head:
+		return Defaults->HeadMultiplier;
+	case ETP3HitZone::Limb:
+		return Defaults->LimbMultiplier;
+	default:
+		return Defaults->TorsoMultiplier;
+	}
+}
+
+bool UTP3HitZoneComponent::UseLegacyTraces()
+{
+	return CVarWeaponLegacyTraces.GetValueOnGameThread();
+}
+
+ECollisionChannel UTP3HitZoneComponent::GetWeaponChannel(ECollisionChannel LegacyChannel)
+{
+	return UseLegacyTraces() ? LegacyChannel : TP3_TRACE_WEAPON;
+}
@@ -0,0 +1,162 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3HitscanSubsystem.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Hitscan submit batch"), STAT_TP3Hitscan_Submit, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Hitscan resolve batch"), STAT_TP3Hitscan_Resolve, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Hitscan sync trace"), STAT_TP3Hitscan_SyncTrace, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Hitscan traces per frame"), STAT_TP3Hitscan_TracesPerFrame, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<bool> CVarHitscanAsync(
+	TEXT("tp3.Hitscan.Async"),
+	true,
+	TEXT("Batch hitscan shots into async line traces resolved next frame. 0 traces every shot synchronously."));
+
+// Level only shots: pawns and hit zones are other object types
+static const FCollisionObjectQueryParams LevelObjectQuery(ECC_TO_BITFIELD(ECC_WorldStatic) | ECC_TO_BITFIELD(ECC_WorldDynamic));
+
+void UTP3HitscanSubsystem::Deinitialize()
+{
+	PendingShots.Reset();
+	InFlightShots.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3HitscanSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3HitscanSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3HitscanSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3HitscanSubsystem::QueueShot(FTP3HitscanShot&& Shot)
+{
+	TP3_COUNT_COMBAT_EVENT(Shots);
+
+	if (!CVarHitscanAsync.GetValueOnGameThread())
+	{
+		TraceShotNow(Shot);
+		return;
+	}
+
+	PendingShots.Add(MoveTemp(Shot));
+}
+
+void UTP3HitscanSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Last frame's batch has been traced by the worker threads while the world ticked
+	ResolveInFlightShots();
+	SubmitPendingShots();
+}
+
+void UTP3HitscanSubsystem::ResolveInFlightShots()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Hitscan_Resolve);
+
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	for (FInFlightShot& InFlight : InFlightShots)
+	{
+		if (!World->QueryTraceData(InFlight.Handle, Datum))
+		{
+			// Trace data only lives for one frame, there is nothing left to wait for
+			UE_LOG(LogTemp, Warning, TEXT("Hitscan trace result was not available, shot dropped"));
+			continue;
+		}
+
+		const FHitResult* Hit = nullptr;
+		for (const FHitResult& OutHit : Datum.OutHits)
+		{
+			if (OutHit.bBlockingHit)
+			{
+				Hit = &OutHit;
+				break;
+			}
+		}
+
+		InFlight.Shot.OnResolved.ExecuteIfBound(InFlight.Shot, Hit);
+	}
+
+	InFlightShots.Reset();
+}
+
+void UTP3HitscanSubsystem::SubmitPendingShots()
+{
+	if (PendingShots.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Hitscan_Submit);
+
+	UWorld* World = GetWorld();
+	int32 NumSubmitted = 0;
+
+	InFlightShots.Reserve(PendingShots.Num());
+	for (FTP3HitscanShot& Shot : PendingShots)
+	{
+		if (!Shot.Shooter.IsValid() || !Shot.QueryParams)
+		{
+			continue;
+		}
+
+		FInFlightShot& InFlight = InFlightShots.AddDefaulted_GetRef();
+		InFlight.Handle = Shot.bLevelOnly
+			? World->AsyncLineTraceByObjectType(EAsyncTraceType::Single, Shot.Start, Shot.End, LevelObjectQuery, *Shot.QueryParams)
+			: World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Shot.Start, Shot.End, Shot.Channel, *Shot.QueryParams);
+		InFlight.Shot = MoveTemp(Shot);
+		++NumSubmitted;
+	}
+
+	PendingShots.Reset();
+	NumTraces += NumSubmitted;
+
+	INC_DWORD_STAT_BY(STAT_TP3Hitscan_TracesPerFrame, NumSubmitted);
+}
+
+void UTP3HitscanSubsystem::TraceShotNow(FTP3HitscanShot& Shot)
+{
+	if (!Shot.QueryParams)
+	{
+		return;
+	}
+
+	FHitResult HitResult;
+	bool bHit;
+	const double TraceStart = FPlatformTime::Seconds();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_TP3Hitscan_SyncTrace);
+		bHit = TraceSync(Shot, HitResult);
+	}
+	RecordSyncTraceCost((FPlatformTime::Seconds() - TraceStart) * 1000.0);
+	++NumTraces;
+
+	INC_DWORD_STAT(STAT_TP3Hitscan_TracesPerFrame);
+
+	Shot.OnResolved.ExecuteIfBound(Shot, bHit ? &HitResult : nullptr);
+}
+
+bool UTP3HitscanSubsystem::TraceSync(const FTP3HitscanShot& Shot, FHitResult& OutHit) const
+{
+	if (Shot.bLevelOnly)
+	{
+		return GetWorld()->LineTraceSingleByObjectType(OutHit, Shot.Start, Shot.End, LevelObjectQuery, *Shot.QueryParams);
+	}
+	return GetWorld()->LineTraceSingleByChannel(OutHit, Shot.Start, Shot.End, Shot.Channel, *Shot.QueryParams);
+}
+
+void UTP3HitscanSubsystem::RecordSyncTraceCost(double Ms)
+{
+	AvgSyncTraceMs = AvgSyncTraceMs > 0.0 ? FMath::Lerp(AvgSyncTraceMs, Ms, 0.1) : Ms;
+}
@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3LagCompensationSubsystem.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/PlayerState.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Lag compensation record"), STAT_TP3LagComp_Record, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Lag compensation rewind"), STAT_TP3LagComp_Rewind, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Lag compensated shots"), STAT_TP3LagComp_Shots, STATGROUP_TP3Shoot);
+
+namespace TP3LagCompensation
+{
+	// Squared distance from P to the segment Start + T * Dir, T in [0, 1]
+	static float DistSqToSegment(const FVector3f& P, const FVector3f& Start, const FVector3f& Dir, float InvLenSq, float& OutT)
+	{
+		OutT = FMath::Clamp(FVector3f::DotProduct(P - Start, Dir) * InvLenSq, 0.f, 1.f);
+		return FVector3f::DistSquared(P, Start + Dir * OutT);
+	}
+}
+
+void UTP3LagCompensationSubsystem::Deinitialize()
+{
+	Snapshots.Empty();
+	AliveFlags.Empty();
+	FrameTimes.Empty();
+	SlotActors.Empty();
+	Radii.Empty();
+	HalfHeights.Empty();
+	HeadBones.Empty();
+
+	Super::Deinitialize();
+}
+
+bool UTP3LagCompensationSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3LagCompensationSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3LagCompensationSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3LagCompensationSubsystem::Reserve(int32 NewCapacity)
+{
+	Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(NewCapacity, 64));
+	const int32 Frames = FMath::Max(HistorySize, 2);
+
+	Snapshots.SetNumUninitialized(Frames * Capacity);
+	AliveFlags.SetNumZeroed(Frames * Capacity);
+	FrameTimes.SetNumZeroed(Frames);
+	NewestFrame = INDEX_NONE;
+	NumFrames = 0;
+
+	SlotActors.SetNum(Capacity);
+	Radii.SetNumZeroed(Capacity);
+	HalfHeights.SetNumZeroed(Capacity);
+	HeadBones.Init(INDEX_NONE, Capacity);
+}
+
+void UTP3LagCompensationSubsystem::RefreshSlot(int32 Id, const AActor* Actor)
+{
+	SlotActors[Id] = Actor;
+	Radii[Id] = 0.f;
+	HalfHeights[Id] = 0.f;
+	HeadBones[Id] = INDEX_NONE;
+
+	if (const ACharacter* Character = Cast<ACharacter>(Actor))
+	{
+		Character->GetCapsuleComponent()->GetScaledCapsuleSize(Radii[Id], HalfHeights[Id]);
+		if (const USkeletalMeshComponent* Mesh = Character->GetMesh())
+		{
+			HeadBones[Id] = Mesh->GetBoneIndex(HeadBoneName);
+		}
+	}
+
+	for (int32 Frame = 0; Frame < FrameTimes.Num(); ++Frame)
+	{
+		AliveFlags[Frame * Capacity + Id] = 0;
+	}
+}
+
+void UTP3LagCompensationSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Only a server resolves the shots of remote clients
+	const ENetMode NetMode = GetWorld()->GetNetMode();
+	if (NetMode != NM_DedicatedServer && NetMode != NM_ListenServer)
+	{
+		return;
+	}
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Registry)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3LagComp_Record);
+
+	const int32 NumSlots = Registry->GetNumSlots();
+	if (NumSlots > Capacity || FrameTimes.Num() == 0)
+	{
+		Reserve(NumSlots);
+	}
+
+	NewestFrame = (NewestFrame + 1) % FrameTimes.Num();
+	NumFrames = FMath::Min(NumFrames + 1, FrameTimes.Num());
+	FrameTimes[NewestFrame] = GetWorld()->GetTimeSeconds();
+
+	FHitboxSnapshot* RESTRICT FrameSnapshots = Snapshots.GetData() + NewestFrame * Capacity;
+	uint8* RESTRICT FrameAlive = AliveFlags.GetData() + NewestFrame * Capacity;
+
+	for (int32 Id = 0; Id < NumSlots; ++Id)
+	{
+		const AActor* Actor = Registry->IsValidCombatant(Id) && Registry->IsAlive(Id) ? Registry->GetActor(Id) : nullptr;
+		FrameAlive[Id] = Actor != nullptr;
+		if (!Actor)
+		{
+			continue;
+		}
+
+		if (SlotActors[Id].Get() != Actor)
+		{
+			RefreshSlot(Id, Actor);
+			FrameAlive[Id] = 1;
+		}
+
+		// Bones are in reference pose on a dedicated server that does not tick the animations, close enough for a head
+		const FVector Center = Actor->GetActorLocation();
+		FVector Head = Center + FVector(0.f, 0.f, HalfHeights[Id] - Radii[Id]);
+		if (HeadBones[Id] != INDEX_NONE)
+		{
+			Head = static_cast<const ACharacter*>(Actor)->GetMesh()->GetBoneTransform(HeadBones[Id]).GetLocation();
+		}
+
+		FrameSnapshots[Id].Center = FVector3f(Center);
+		FrameSnapshots[Id].Head = FVector3f(Head);
+	}
+}
+
+double UTP3LagCompensationSubsystem::GetRewindTime(const APawn& Shooter, double ClientTime) const
+{
+	// The client sees the other combatants half a round trip late, plus its interpolation delay
+	const APlayerState* PlayerState = Shooter.GetPlayerState();
+	const double HalfPing = PlayerState ? PlayerState->ExactPing * 0.0005 : 0.0;
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	return FMath::Clamp(ClientTime - HalfPing - ExtraRewindSeconds, Now - MaxRewindSeconds, Now);
+}
+
+bool UTP3LagCompensationSubsystem::TraceRewound(const FVector& Start, const FVector& End, int32 ShooterId, double Time, FTP3RewoundHit& OutHit) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3LagComp_Rewind);
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (NumFrames == 0 || !Registry || !Registry->IsValidCombatant(ShooterId))
+	{
+		return false;
+	}
+
+	INC_DWORD_STAT(STAT_TP3LagComp_Shots);
+
+	// Newest frame recorded at or before Time, and the one after it
+	const int32 HistoryFrames = FrameTimes.Num();
+	int32 Newer = NewestFrame;
+	int32 Older = NewestFrame;
+	for (int32 Age = 0; Age < NumFrames; ++Age)
+	{
+		const int32 Frame = (NewestFrame - Age + HistoryFrames) % HistoryFrames;
+		Older = Frame;
+		if (FrameTimes[Frame] <= Time)
+		{
+			break;
+		}
+		Newer = Frame;
+	}
+
+	const double Span = FrameTimes[Newer] - FrameTimes[Older];
+	const float Alpha = Span > UE_SMALL_NUMBER ? FMath::Clamp(float((Time - FrameTimes[Older]) / Span), 0.f, 1.f) : 1.f;
+
+	const FHitboxSnapshot* RESTRICT OlderSnapshots = Snapshots.GetData() + Older * Capacity;
+	const FHitboxSnapshot* RESTRICT NewerSnapshots = Snapshots.GetData() + Newer * Capacity;
+	const uint8* RESTRICT OlderAlive = AliveFlags.GetData() + Older * Capacity;
+	const uint8* RESTRICT NewerAlive = AliveFlags.GetData() + Newer * Capacity;
+
+	const FVector3f SegmentStart(Start);
+	const FVector3f Dir = FVector3f(End) - SegmentStart;
+	const float LenSq = Dir.SizeSquared();
+	if (LenSq < UE_SMALL_NUMBER)
+	{
+		return false;
+	}
+	const float InvLenSq = 1.f / LenSq;
+	const float Len = FMath::Sqrt(LenSq);
+
+	float BestT = 2.f;
+	const int32 NumSlots = FMath::Min(Registry->GetNumSlots(), Capacity);
+	for (int32 Id = 0; Id < NumSlots; ++Id)
+	{
+		if (!(OlderAlive[Id] & NewerAlive[Id]) || Id == ShooterId || !Registry->IsValidCombatant(Id) || !Registry->AreEnemies(ShooterId, Id))
+		{
+			continue;
+		}
+
+		const float Radius = Radii[Id];
+		const float HalfHeight = HalfHeights[Id];
+		const FVector3f Center = FMath::Lerp(OlderSnapshots[Id].Center, NewerSnapshots[Id].Center, Alpha);
+
+		// Bounding sphere of the capsule first, most combatants stop here
+		float T;
+		if (TP3LagCompensation::DistSqToSegment(Center, SegmentStart, Dir, InvLenSq, T) > FMath::Square(HalfHeight + HeadRadius))
+		{
+			continue;
+		}
+
+		// Head sphere
+		const FVector3f Head = FMath::Lerp(OlderSnapshots[Id].Head, NewerSnapshots[Id].Head, Alpha);
+		const float HeadDistSq = TP3LagCompensation::DistSqToSegment(Head, SegmentStart, Dir, InvLenSq, T);
+		if (HeadDistSq <= FMath::Square(HeadRadius))
+		{
+			const float EntryT = T - FMath::Sqrt(FMath::Square(HeadRadius) - HeadDistSq) / Len;
+			if (EntryT < BestT)
+			{
+				BestT = EntryT;
+				OutHit.CombatantId = Id;
+				OutHit.bHead = true;
+			}
+		}
+
+		// Vertical capsule, as the segment between its sphere centers
+		const FVector3f Axis(0.f, 0.f, FMath::Max(HalfHeight - Radius, 0.f));
+		FVector PointOnShot, PointOnAxis;
+		FMath::SegmentDistToSegmentSafe(Start, End, FVector(Center - Axis), FVector(Center + Axis), PointOnShot, PointOnAxis);
+		const float BodyDistSq = FVector::DistSquared(PointOnShot, PointOnAxis);
+		if (BodyDistSq <= FMath::Square(Radius))
+		{
+			const float EntryT = float(FVector::Dist(Start, PointOnShot)) / Len - FMath::Sqrt(FMath::Square(Radius) - BodyDistSq) / Len;
+			if (EntryT < BestT)
+			{
+				BestT = EntryT;
+				OutHit.CombatantId = Id;
+				OutHit.bHead = false;
+			}
+		}
+	}
+
+	if (BestT > 1.f)
+	{
+		return false;
+	}
+
+	OutHit.Impact = Start + FVector(Dir) * FMath::Max(BestT, 0.f);
+	return true;
+}
@@ -0,0 +1,193 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3LineOfSightSubsystem.h"
+#include "CollisionQueryParams.h"
+#include "Engine/World.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Line of sight submit"), STAT_TP3LineOfSight_Submit, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Line of sight resolve"), STAT_TP3LineOfSight_Resolve, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line of sight cached"), STAT_TP3LineOfSight_Cached, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line of sight stale"), STAT_TP3LineOfSight_Stale, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Line of sight traces"), STAT_TP3LineOfSight_Traces, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Line of sight queued"), STAT_TP3LineOfSight_Queued, STATGROUP_TP3Shoot);
+
+void UTP3LineOfSightSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UTP3CombatantRegistry>();
+
+	Super::Initialize(Collection);
+
+	Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+}
+
+void UTP3LineOfSightSubsystem::Deinitialize()
+{
+	Pairs.Reset();
+	Queue.Reset();
+	InFlightTraces.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3LineOfSightSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3LineOfSightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3LineOfSightSubsystem, STATGROUP_Tickables);
+}
+
+ETP3Visibility UTP3LineOfSightSubsystem::GetVisibility(int32 ObserverId, int32 TargetId)
+{
+	if (!Registry || !Registry->IsValidCombatant(ObserverId) || !Registry->IsValidCombatant(TargetId) || ObserverId == TargetId)
+	{
+		return ETP3Visibility::Unknown;
+	}
+
+	const uint64 Key = MakeKey(ObserverId, TargetId);
+	const double Now = GetWorld()->GetTimeSeconds();
+	FPairEntry& Entry = Pairs.FindOrAdd(Key);
+	Entry.RequestTime = Now;
+
+	if (!Entry.bQueued)
+	{
+		// Locations in key order, the entry is shared by both directions
+		const FVector3f LocationA(Registry->GetLocation(FMath::Min(ObserverId, TargetId)));
+		const FVector3f LocationB(Registry->GetLocation(FMath::Max(ObserverId, TargetId)));
+		const float InvalidateDistanceSq = FMath::Square(InvalidateDistance);
+
+		const bool bStale = Entry.TraceTime < 0.0
+			|| Now - Entry.TraceTime > TimeToLive
+			|| FVector3f::DistSquared(LocationA, Entry.LocationA) > InvalidateDistanceSq
+			|| FVector3f::DistSquared(LocationB, Entry.LocationB) > InvalidateDistanceSq;
+
+		if (bStale)
+		{
+			Entry.bQueued = true;
+			Queue.Add(Key);
+			INC_DWORD_STAT(STAT_TP3LineOfSight_Stale);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_TP3LineOfSight_Cached);
+		}
+	}
+
+	return Entry.Result;
+}
+
+void UTP3LineOfSightSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Last frame's traces ran on the worker threads while the world ticked
+	ResolveTraces();
+	SubmitTraces();
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextPurgeTime)
+	{
+		PurgeUnusedPairs(Now);
+		NextPurgeTime = Now + 1.0;
+	}
+
+	SET_DWORD_STAT(STAT_TP3LineOfSight_Queued, Queue.Num());
+}
+
+void UTP3LineOfSightSubsystem::ResolveTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3LineOfSight_Resolve);
+
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	for (const FInFlightTrace& InFlight : InFlightTraces)
+	{
+		FPairEntry* Entry = Pairs.Find(InFlight.Key);
+		if (!Entry)
+		{
+			continue;
+		}
+
+		Entry->bQueued = false;
+		if (!World->QueryTraceData(InFlight.Handle, Datum))
+		{
+			continue;
+		}
+
+		// Both combatants are ignored, anything blocking is in the way
+		bool bBlocked = false;
+		for (const FHitResult& Hit : Datum.OutHits)
+		{
+			bBlocked |= Hit.bBlockingHit;
+		}
+		Entry->Result = bBlocked ? ETP3Visibility::Hidden : ETP3Visibility::Visible;
+	}
+
+	InFlightTraces.Reset();
+}
+
+void UTP3LineOfSightSubsystem::SubmitTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3LineOfSight_Submit);
+
+	UWorld* World = GetWorld();
+	const double Now = World->GetTimeSeconds();
+	const FVector Eye(0.f, 0.f, EyeHeight);
+
+	int32 NumTaken = 0;
+	while (NumTaken < Queue.Num() && InFlightTraces.Num() < MaxTracesPerFrame)
+	{
+		const uint64 Key = Queue[NumTaken++];
+		FPairEntry* Entry = Pairs.Find(Key);
+		if (!Entry)
+		{
+			continue;
+		}
+
+		const int32 IdA = int32(Key >> 32);
+		const int32 IdB = int32(Key & 0xFFFFFFFF);
+		AActor* ActorA = Registry->IsValidCombatant(IdA) ? Registry->GetActor(IdA) : nullptr;
+		AActor* ActorB = Registry->IsValidCombatant(IdB) ? Registry->GetActor(IdB) : nullptr;
+		if (!ActorA || !ActorB)
+		{
+			Entry->bQueued = false;
+			continue;
+		}
+
+		const FVector LocationA = Registry->GetLocation(IdA);
+		const FVector LocationB = Registry->GetLocation(IdB);
+		Entry->LocationA = FVector3f(LocationA);
+		Entry->LocationB = FVector3f(LocationB);
+		Entry->TraceTime = Now;
+
+		FCollisionQueryParams Params(FName(TEXT("LineOfSightTrace")), false);
+		Params.AddIgnoredActor(ActorA);
+		Params.AddIgnoredActor(ActorB);
+
+		FInFlightTrace& InFlight = InFlightTraces.AddDefaulted_GetRef();
+		InFlight.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, LocationA + Eye, LocationB + Eye, ECC_Visibility, Params);
+		InFlight.Key = Key;
+		INC_DWORD_STAT(STAT_TP3LineOfSight_Traces);
+	}
+
+	// The rest waits for the next frames, still oldest first
+	Queue.RemoveAt(0, NumTaken, EAllowShrinking::No);
+}
+
+void UTP3LineOfSightSubsystem::PurgeUnusedPairs(double Now)
+{
+	const double MaxIdle = FMath::Max(4.0 * TimeToLive, 1.0);
+	for (auto It = Pairs.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().bQueued && Now - It.Value().RequestTime > MaxIdle)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
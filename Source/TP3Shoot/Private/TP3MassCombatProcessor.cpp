@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3MassCombatProcessor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "MassExecutionContext.h"
+#include "TP3MassCombatantFragments.h"
+#include "TP3RespawnSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mass combatant combat"), STAT_TP3Mass_Combat, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Mass combatants alive"), STAT_TP3Mass_Alive, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<float> CVarMassSightRange(
+	TEXT("tp3.Mass.SightRange"),
+	5000.f,
+	TEXT("Distance at which a distant combatant notices an enemy and walks to it."));
+
+static TAutoConsoleVariable<float> CVarMassFireRange(
+	TEXT("tp3.Mass.FireRange"),
+	2000.f,
+	TEXT("Distance at which a distant combatant shoots, same as the fire task of the bots."));
+
+static TAutoConsoleVariable<float> CVarMassFireInterval(
+	TEXT("tp3.Mass.FireInterval"),
+	0.4f,
+	TEXT("Seconds between two shots of a distant combatant."));
+
+static TAutoConsoleVariable<float> CVarMassDamage(
+	TEXT("tp3.Mass.Damage"),
+	5.f,
+	TEXT("Damage of one hit, same as AAI_Player::Fire."));
+
+static TAutoConsoleVariable<float> CVarMassHitChance(
+	TEXT("tp3.Mass.HitChance"),
+	0.6f,
+	TEXT("Hit chance at point blank, falls linearly to 0 at the fire range."));
+
+static TAutoConsoleVariable<float> CVarMassRespawnDelay(
+	TEXT("tp3.Mass.RespawnDelay"),
+	3.f,
+	TEXT("Seconds before a dead distant combatant respawns."));
+
+UTP3MassCombatProcessor::UTP3MassCombatProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Standalone | EProcessorExecutionFlags::Server);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+
+	// Respawns pick their point from the respawn subsystem
+	bRequiresGameThreadExecution = true;
+}
+
+void UTP3MassCombatProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTP3MassCombatantFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTP3MassNavigationFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddTagRequirement<FTP3MassCombatantTag>(EMassFragmentPresence::All);
+}
+
+void UTP3MassCombatProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Mass_Combat);
+
+	const float DeltaTime = Context.GetDeltaTimeSeconds();
+	const float SightRange = FMath::Max(CVarMassSightRange.GetValueOnGameThread(), 100.f);
+	const float FireRange = CVarMassFireRange.GetValueOnGameThread();
+	const float FireInterval = CVarMassFireInterval.GetValueOnGameThread();
+	const float Damage = CVarMassDamage.GetValueOnGameThread();
+	const float HitChance = CVarMassHitChance.GetValueOnGameThread();
+
+	auto GetCell = [SightRange](const FVector& Location)
+		{
+			return FIntPoint(FMath::FloorToInt(Location.X / SightRange), FMath::FloorToInt(Location.Y / SightRange));
+		};
+
+	// First pass: every combatant in a grid of SightRange cells, dead ones included to keep the query order
+	Locations.Reset();
+	Teams.Reset();
+	Cells.Reset();
+	int32 NumAlive = 0;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+		{
+			const TConstArrayView<FTP3MassCombatantFragment> Combatants = ChunkContext.GetFragmentView<FTP3MassCombatantFragment>();
+			const TConstArrayView<FTP3MassNavigationFragment> Navigations = ChunkContext.GetFragmentView<FTP3MassNavigationFragment>();
+
+			for (int32 Index = 0; Index < ChunkContext.GetNumEntities(); ++Index)
+			{
+				const int32 Slot = Locations.Add(Navigations[Index].Location);
+				Teams.Add(Combatants[Index].Team);
+				if (Combatants[Index].Life > 0.f)
+				{
+					Cells.FindOrAdd(GetCell(Navigations[Index].Location)).Add(Slot);
+					++NumAlive;
+				}
+			}
+		});
+
+	SET_DWORD_STAT(STAT_TP3Mass_Alive, NumAlive);
+	// Slots follow the chunks of this frame, the damage of the last frame was already applied
+	Damages.Reset();
+	Damages.SetNumZeroed(Locations.Num());
+
+	// Second pass: pick the nearest enemy, walk to it and shoot it
+	int32 Slot = 0;
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+		{
+			const TArrayView<FTP3MassCombatantFragment> Combatants = ChunkContext.GetMutableFragmentView<FTP3MassCombatantFragment>();
+			const TArrayView<FTP3MassNavigationFragment> Navigations = ChunkContext.GetMutableFragmentView<FTP3MassNavigationFragment>();
+
+			for (int32 Index = 0; Index < ChunkContext.GetNumEntities(); ++Index, ++Slot)
+			{
+				FTP3MassCombatantFragment& Combatant = Combatants[Index];
+				if (Combatant.Life <= 0.f)
+				{
+					continue;
+				}
+
+				const FIntPoint Center = GetCell(Locations[Slot]);
+				int32 Target = INDEX_NONE;
+				double BestDistSq = FMath::Square(SightRange);
+				for (int32 X = Center.X - 1; X <= Center.X + 1; ++X)
+				{
+					for (int32 Y = Center.Y - 1; Y <= Center.Y + 1; ++Y)
+					{
+						if (const TArray<int32>* Cell = Cells.Find(FIntPoint(X, Y)))
+						{
+							for (const int32 Other : *Cell)
+							{
+								const double DistSq = FVector::DistSquared(Locations[Other], Locations[Slot]);
+								if (Teams[Other] != Combatant.Team && DistSq < BestDistSq)
+								{
+									BestDistSq = DistSq;
+									Target = Other;
+								}
+							}
+						}
+					}
+				}
+
+				Combatant.FireCooldown -= DeltaTime;
+				if (Target == INDEX_NONE)
+				{
+					continue;
+				}
+
+				// Walk to the target, and only re-path once it moved away from the end of the current path
+				FTP3MassNavigationFragment& Navigation = Navigations[Index];
+				if (FVector::DistSquared(Navigation.Goal, Locations[Target]) > FMath::Square(500.f))
+				{
+					Navigation.Goal = Locations[Target];
+					Navigation.PathPoints.Reset();
+					Navigation.PathIndex = 0;
+				}
+
+				const float Distance = FMath::Sqrt(BestDistSq);
+				if (Distance <= FireRange && Combatant.FireCooldown <= 0.f)
+				{
+					Combatant.FireCooldown = FireInterval;
+					if (FMath::FRand() < HitChance * (1.f - Distance / FMath::Max(FireRange, 1.f)))
+					{
+						Damages[Target] += Damage;
+					}
+				}
+			}
+		});
+
+	// Third pass: apply the damage of the frame and bring the dead back
+	UTP3RespawnSubsystem* Respawn = EntityManager.GetWorld() ? EntityManager.GetWorld()->GetSubsystem<UTP3RespawnSubsystem>() : nullptr;
+	const float RespawnDelay = CVarMassRespawnDelay.GetValueOnGameThread();
+	Slot = 0;
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+		{
+			const TArrayView<FTP3MassCombatantFragment> Combatants = ChunkContext.GetMutableFragmentView<FTP3MassCombatantFragment>();
+			const TArrayView<FTP3MassNavigationFragment> Navigations = ChunkContext.GetMutableFragmentView<FTP3MassNavigationFragment>();
+
+			for (int32 Index = 0; Index < ChunkContext.GetNumEntities(); ++Index, ++Slot)
+			{
+				FTP3MassCombatantFragment& Combatant = Combatants[Index];
+				if (Combatant.Life > 0.f)
+				{
+					if (Damages[Slot] > 0.f)
+					{
+						Combatant.Life -= Damages[Slot];
+						if (Combatant.Life <= 0.f)
+						{
+							Combatant.Life = 0.f;
+							Combatant.RespawnDelay = RespawnDelay;
+							TP3_COUNT_COMBAT_EVENT(Kills);
+						}
+					}
+					continue;
+				}
+
+				Combatant.RespawnDelay -= DeltaTime;
+				if (Combatant.RespawnDelay <= 0.f)
+				{
+					FTP3MassNavigationFragment& Navigation = Navigations[Index];
+					Navigation.Location = Respawn ? Respawn->PickSpawnPoint(Combatant.Team) : Navigation.Location;
+					Navigation.Goal = Navigation.Location;
+					Navigation.PathPoints.Reset();
+					Navigation.PathIndex = 0;
+					Combatant.Life = Combatant.MaxLife;
+					TP3_COUNT_COMBAT_EVENT(Respawns);
+				}
+			}
+		});
+}
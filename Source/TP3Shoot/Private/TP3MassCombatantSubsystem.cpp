@@ -0,0 +1,307 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3MassCombatantSubsystem.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "MassEntityManager.h"
+#include "MassEntitySubsystem.h"
+#include "MassExecutionContext.h"
+#include "Misc/CommandLine.h"
+#include "NavigationSystem.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3MassCombatantFragments.h"
+#include "TP3RespawnSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mass combatant promotion"), STAT_TP3Mass_Promotion, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass combatant promotions"), STAT_TP3Mass_Promotions, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass combatant demotions"), STAT_TP3Mass_Demotions, STATGROUP_TP3Shoot);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdMassSpawnCombatants(
+	TEXT("tp3.Mass.SpawnCombatants"),
+	TEXT("tp3.Mass.SpawnCombatants <PerTeam>: spawns distant combatants around the spawn points of each team."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UTP3MassCombatantSubsystem* Subsystem = World ? World->GetSubsystem<UTP3MassCombatantSubsystem>() : nullptr;
+			if (Subsystem && Args.Num() > 0)
+			{
+				Subsystem->SpawnCombatants(FCString::Atoi(*Args[0]));
+			}
+		}));
+
+UTP3MassCombatantSubsystem::UTP3MassCombatantSubsystem()
+{
+	AllyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Allie.BPAI_Allie_C")));
+	EnemyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Ennemie.BPAI_Ennemie_C")));
+}
+
+bool UTP3MassCombatantSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3MassCombatantSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3MassCombatantSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3MassCombatantSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UMassEntitySubsystem>();
+
+	Super::Initialize(Collection);
+
+	PromotionQuery.AddRequirement<FTP3MassCombatantFragment>(EMassFragmentAccess::ReadOnly);
+	PromotionQuery.AddRequirement<FTP3MassNavigationFragment>(EMassFragmentAccess::ReadOnly);
+	PromotionQuery.AddTagRequirement<FTP3MassCombatantTag>(EMassFragmentPresence::All);
+}
+
+void UTP3MassCombatantSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	AllyClass = AllyBotClass.LoadSynchronous();
+	EnemyClass = EnemyBotClass.LoadSynchronous();
+	if (AllyClass)
+	{
+		AllyTeam = UTP3CombatantRegistry::ToTeamId(AllyClass->GetDefaultObject<AAI_Player>()->Team);
+	}
+	if (EnemyClass)
+	{
+		EnemyTeam = UTP3CombatantRegistry::ToTeamId(EnemyClass->GetDefaultObject<AAI_Player>()->Team);
+	}
+
+	int32 CountPerTeam = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("TP3MassCombatants="), CountPerTeam))
+	{
+		SpawnCombatants(CountPerTeam);
+	}
+}
+
+UClass* UTP3MassCombatantSubsystem::GetBotClass(uint8 Team) const
+{
+	return Team == EnemyTeam ? EnemyClass.Get() : AllyClass.Get();
+}
+
+FMassEntityHandle UTP3MassCombatantSubsystem::CreateEntity(uint8 Team, float Life, float MaxLife, const FVector& Location)
+{
+	UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+	if (!EntitySubsystem)
+	{
+		return FMassEntityHandle();
+	}
+
+	FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+	if (!Archetype.IsValid())
+	{
+		const UScriptStruct* Composition[] = { FTP3MassCombatantFragment::StaticStruct(), FTP3MassNavigationFragment::StaticStruct(), FTP3MassCombatantTag::StaticStruct() };
+		Archetype = EntityManager.CreateArchetype(MakeArrayView(Composition));
+	}
+
+	const FMassEntityHandle Entity = EntityManager.CreateEntity(Archetype);
+
+	FTP3MassCombatantFragment& Combatant = EntityManager.GetFragmentDataChecked<FTP3MassCombatantFragment>(Entity);
+	Combatant.Team = Team;
+	Combatant.Life = Life;
+	Combatant.MaxLife = MaxLife;
+
+	FTP3MassNavigationFragment& Navigation = EntityManager.GetFragmentDataChecked<FTP3MassNavigationFragment>(Entity);
+	Navigation.Location = Location;
+	Navigation.Goal = Location;
+
+	return Entity;
+}
+
+void UTP3MassCombatantSubsystem::SpawnCombatants(int32 CountPerTeam)
+{
+	if (CountPerTeam <= 0)
+	{
+		return;
+	}
+	bEnabled = true;
+
+	UWorld* World = GetWorld();
+	UTP3RespawnSubsystem* Respawn = World->GetSubsystem<UTP3RespawnSubsystem>();
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(World);
+
+	for (const uint8 Team : { AllyTeam, EnemyTeam })
+	{
+		const UClass* BotClass = GetBotClass(Team);
+		const float MaxLife = BotClass ? BotClass->GetDefaultObject<AAI_Player>()->Life : 100.f;
+
+		for (int32 Index = 0; Index < CountPerTeam; ++Index)
+		{
+			// Spread around the spawn point so the first paths do not all start from the same polygon
+			FVector Location = Respawn ? Respawn->PickSpawnPoint(Team) : FVector::ZeroVector;
+			Location += FVector(FMath::FRandRange(-500.f, 500.f), FMath::FRandRange(-500.f, 500.f), 0.f);
+
+			FNavLocation NavLocation;
+			if (NavSys && NavSys->ProjectPointToNavigation(Location, NavLocation))
+			{
+				Location = NavLocation.Location;
+			}
+
+			CreateEntity(Team, MaxLife, MaxLife, Location);
+		}
+	}
+}
+
+AAI_Player* UTP3MassCombatantSubsystem::SpawnBot(uint8 Team, float Life, const FVector& Location)
+{
+	UClass* BotClass = GetBotClass(Team);
+	if (!BotClass)
+	{
+		return nullptr;
+	}
+
+	UWorld* World = GetWorld();
+	const FTransform SpawnTransform(Location + FVector(0.f, 0.f, 100.f));
+	AAI_Player* Bot = World->SpawnActorDeferred<AAI_Player>(BotClass, SpawnTransform, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn);
+	if (!Bot)
+	{
+		return nullptr;
+	}
+
+	Bot->Team = Team;
+	UGameplayStatics::FinishSpawningActor(Bot, SpawnTransform);
+
+	if (!Bot->GetController())
+	{
+		Bot->SpawnDefaultController();
+	}
+
+	// Registered at BeginPlay with its full life, the entity may have lost some
+	if (UTP3CombatantRegistry* Registry = World->GetSubsystem<UTP3CombatantRegistry>())
+	{
+		Registry->SetLife(Bot->GetCombatantId(), Life);
+	}
+
+	return Bot;
+}
+
+bool UTP3MassCombatantSubsystem::IsNearViewer(const FVector& Location, double Radius) const
+{
+	const double RadiusSq = FMath::Square(Radius);
+	for (const FVector& ViewerLocation : ViewerLocations)
+	{
+		if (FVector::DistSquared(Location, ViewerLocation) < RadiusSq)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void UTP3MassCombatantSubsystem::PromoteNearEntities()
+{
+	UMassEntitySubsystem* EntitySubsystem = GetWorld()->GetSubsystem<UMassEntitySubsystem>();
+	if (!EntitySubsystem)
+	{
+		return;
+	}
+
+	FMassEntityManager& EntityManager = EntitySubsystem->GetMutableEntityManager();
+
+	Promotions.Reset();
+	FMassExecutionContext Context(EntityManager);
+	PromotionQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+		{
+			const TConstArrayView<FTP3MassCombatantFragment> Combatants = ChunkContext.GetFragmentView<FTP3MassCombatantFragment>();
+			const TConstArrayView<FTP3MassNavigationFragment> Navigations = ChunkContext.GetFragmentView<FTP3MassNavigationFragment>();
+
+			for (int32 Index = 0; Index < ChunkContext.GetNumEntities() && Promotions.Num() < MaxTransfersPerFrame; ++Index)
+			{
+				if (Combatants[Index].Life > 0.f && IsNearViewer(Navigations[Index].Location, PromoteRadius))
+				{
+					Promotions.Add({ ChunkContext.GetEntity(Index), Combatants[Index].Team, Combatants[Index].Life, Navigations[Index].Location });
+				}
+			}
+		});
+
+	// Entities are destroyed outside of the query, the chunks must not change while it runs
+	for (const FPromotion& Promotion : Promotions)
+	{
+		if (SpawnBot(Promotion.Team, Promotion.Life, Promotion.Location))
+		{
+			EntityManager.DestroyEntity(Promotion.Entity);
+			INC_DWORD_STAT(STAT_TP3Mass_Promotions);
+		}
+	}
+}
+
+void UTP3MassCombatantSubsystem::DemoteFarBots()
+{
+	UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Registry)
+	{
+		return;
+	}
+
+	int32 NumDemoted = 0;
+
+	for (int32 Id = 0; Id < Registry->GetNumSlots() && NumDemoted < MaxTransfersPerFrame; ++Id)
+	{
+		if (!Registry->IsValidCombatant(Id) || !Registry->IsAlive(Id))
+		{
+			continue;
+		}
+
+		// Only the bots, the player character always stays an actor
+		AAI_Player* Bot = Cast<AAI_Player>(Registry->GetActor(Id));
+		const FVector Location = Registry->GetLocation(Id);
+		if (!Bot || IsNearViewer(Location, DemoteRadius))
+		{
+			continue;
+		}
+
+		if (!CreateEntity(Registry->GetTeam(Id), Registry->GetLife(Id), Registry->GetMaxLife(Id), Location).IsSet())
+		{
+			return;
+		}
+
+		if (AController* Controller = Bot->GetController())
+		{
+			Controller->Destroy();
+		}
+		Bot->Destroy();
+		++NumDemoted;
+		INC_DWORD_STAT(STAT_TP3Mass_Demotions);
+	}
+}
+
+void UTP3MassCombatantSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Mass_Promotion);
+
+	// Bots are spawned and destroyed by the server, clients only see the replicated actors
+	if (!bEnabled || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	// Every player, a bot fighting any of them stays an actor
+	ViewerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr)
+		{
+			ViewerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+
+	if (ViewerLocations.Num() == 0)
+	{
+		return;
+	}
+
+	PromoteNearEntities();
+	DemoteFarBots();
+}
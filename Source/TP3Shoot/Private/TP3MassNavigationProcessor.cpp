@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3MassNavigationProcessor.h"
+#include "HAL/IConsoleManager.h"
+#include "MassExecutionContext.h"
+#include "NavigationData.h"
+#include "NavigationSystem.h"
+#include "TP3MassCombatantFragments.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mass combatant navigation"), STAT_TP3Mass_Navigation, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Mass combatant path finds"), STAT_TP3Mass_PathFinds, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<float> CVarMassMoveSpeed(
+	TEXT("tp3.Mass.MoveSpeed"),
+	400.f,
+	TEXT("Walk speed in cm/s of the distant combatants."));
+
+static TAutoConsoleVariable<int32> CVarMassPathBudget(
+	TEXT("tp3.Mass.PathBudget"),
+	16,
+	TEXT("Max navmesh path finds of the distant combatants per frame."));
+
+UTP3MassNavigationProcessor::UTP3MassNavigationProcessor()
+	: EntityQuery(*this)
+{
+	ExecutionFlags = (int32)(EProcessorExecutionFlags::Standalone | EProcessorExecutionFlags::Server);
+	ProcessingPhase = EMassProcessingPhase::PrePhysics;
+
+	// Path finds use the navigation system
+	bRequiresGameThreadExecution = true;
+}
+
+void UTP3MassNavigationProcessor::ConfigureQueries()
+{
+	EntityQuery.AddRequirement<FTP3MassNavigationFragment>(EMassFragmentAccess::ReadWrite);
+	EntityQuery.AddRequirement<FTP3MassCombatantFragment>(EMassFragmentAccess::ReadOnly);
+	EntityQuery.AddTagRequirement<FTP3MassCombatantTag>(EMassFragmentPresence::All);
+}
+
+void UTP3MassNavigationProcessor::Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Mass_Navigation);
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(EntityManager.GetWorld());
+	const ANavigationData* NavData = NavSys ? NavSys->GetDefaultNavDataInstance(FNavigationSystem::DontCreate) : nullptr;
+
+	const float Step = CVarMassMoveSpeed.GetValueOnGameThread() * Context.GetDeltaTimeSeconds();
+	int32 PathBudget = CVarMassPathBudget.GetValueOnGameThread();
+
+	EntityQuery.ForEachEntityChunk(EntityManager, Context, [&](FMassExecutionContext& ChunkContext)
+		{
+			const TArrayView<FTP3MassNavigationFragment> Navigations = ChunkContext.GetMutableFragmentView<FTP3MassNavigationFragment>();
+			const TConstArrayView<FTP3MassCombatantFragment> Combatants = ChunkContext.GetFragmentView<FTP3MassCombatantFragment>();
+
+			for (int32 Index = 0; Index < ChunkContext.GetNumEntities(); ++Index)
+			{
+				FTP3MassNavigationFragment& Navigation = Navigations[Index];
+				if (Combatants[Index].Life <= 0.f)
+				{
+					continue;
+				}
+
+				if (Navigation.PathIndex >= Navigation.PathPoints.Num())
+				{
+					if (!NavData || PathBudget <= 0 || FVector::DistSquared(Navigation.Location, Navigation.Goal) < FMath::Square(100.f))
+					{
+						continue;
+					}
+
+					--PathBudget;
+					INC_DWORD_STAT(STAT_TP3Mass_PathFinds);
+
+					const FPathFindingQuery Query(nullptr, *NavData, Navigation.Location, Navigation.Goal);
+					const FPathFindingResult Result = NavSys->FindPathSync(Query);
+
+					Navigation.PathPoints.Reset();
+					Navigation.PathIndex = 0;
+					if (Result.IsSuccessful() && Result.Path.IsValid())
+					{
+						// The first point is the start, and only the first few corners matter before the next re-path
+						const TArray<FNavPathPoint>& Points = Result.Path->GetPathPoints();
+						for (int32 Point = 1; Point < Points.Num() && Navigation.PathPoints.Num() < 8; ++Point)
+						{
+							Navigation.PathPoints.Add(Points[Point].Location);
+						}
+					}
+					continue;
+				}
+
+				const FVector ToCorner = Navigation.PathPoints[Navigation.PathIndex] - Navigation.Location;
+				const float Distance = ToCorner.Size();
+				if (Distance <= Step)
+				{
+					Navigation.Location = Navigation.PathPoints[Navigation.PathIndex];
+					++Navigation.PathIndex;
+				}
+				else
+				{
+					Navigation.Location += ToCorner * (Step / Distance);
+				}
+			}
+		});
+}
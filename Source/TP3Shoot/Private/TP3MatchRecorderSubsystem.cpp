@@ -0,0 +1,401 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3MatchRecorderSubsystem.h"
+#include "Containers/Queue.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Compression.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Match recorder sample"), STAT_TP3Recorder_Sample, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Match recorder bytes"), STAT_TP3Recorder_Bytes, STATGROUP_TP3Shoot);
+
+static FAutoConsoleCommandWithWorldAndArgs CmdRecordStart(
+	TEXT("tp3.Record.Start"),
+	TEXT("tp3.Record.Start [File]: records the match, in Saved/Recordings by default."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (UTP3MatchRecorderSubsystem* Recorder = World ? World->GetSubsystem<UTP3MatchRecorderSubsystem>() : nullptr)
+			{
+				Recorder->StartRecording(Args.Num() > 0 ? Args[0] : FString());
+			}
+		}));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdRecordStop(
+	TEXT("tp3.Record.Stop"),
+	TEXT("tp3.Record.Stop: stops the match recording and closes the file."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (UTP3MatchRecorderSubsystem* Recorder = World ? World->GetSubsystem<UTP3MatchRecorderSubsystem>() : nullptr)
+			{
+				Recorder->StopRecording();
+			}
+		}));
+
+/** Compresses the chunks and writes them to the file, the file is only touched by this thread */
+class FTP3RecordingWriter : public FRunnable
+{
+public:
+	FTP3RecordingWriter(const FString& InFilename, TArray<uint8>&& InHeader)
+		: Filename(InFilename)
+		, Header(MoveTemp(InHeader))
+		, WorkEvent(FPlatformProcess::GetSynchEventFromPool())
+	{
+	}
+
+	virtual ~FTP3RecordingWriter() override
+	{
+		FPlatformProcess::ReturnSynchEventToPool(WorkEvent);
+	}
+
+	// Game thread
+	void Enqueue(TArray<uint8>&& Chunk)
+	{
+		Pending.Enqueue(MoveTemp(Chunk));
+		WorkEvent->Trigger();
+	}
+
+	// Any thread, the file could not be opened or written and nothing reads the queue anymore
+	bool HasFailed() const { return bFailed; }
+
+	virtual uint32 Run() override
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+		File.Reset(PlatformFile.OpenWrite(*Filename));
+		if (!File)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Match recorder: cannot open %s"), *Filename);
+			bFailed = true;
+			return 1;
+		}
+		if (!File->Write(Header.GetData(), Header.Num()))
+		{
+			Fail();
+		}
+
+		while (!bStopping)
+		{
+			WorkEvent->Wait(100);
+			WritePending();
+		}
+
+		// Chunks enqueued before the stop
+		WritePending();
+		File.Reset();
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		bStopping = true;
+		WorkEvent->Trigger();
+	}
+
+private:
+	void WritePending()
+	{
+		TArray<uint8> Chunk;
+		while (Pending.Dequeue(Chunk))
+		{
+			if (!File)
+			{
+				continue;
+			}
+
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, Chunk.Num());
+			Compressed.SetNumUninitialized(CompressedSize, EAllowShrinking::No);
+			if (!FCompression::CompressMemory(NAME_Oodle, Compressed.GetData(), CompressedSize, Chunk.GetData(), Chunk.Num()))
+			{
+				continue;
+			}
+
+			const uint32 Sizes[2] = { uint32(Chunk.Num()), uint32(CompressedSize) };
+			if (!File->Write(reinterpret_cast<const uint8*>(Sizes), sizeof(Sizes)) || !File->Write(Compressed.GetData(), CompressedSize))
+			{
+				Fail();
+			}
+		}
+	}
+
+	// Disk full or file gone, the remaining chunks are dropped
+	void Fail()
+	{
+		UE_LOG(LogTemp, Error, TEXT("Match recorder: cannot write %s"), *Filename);
+		File.Reset();
+		bFailed = true;
+	}
+
+	FString Filename;
+	TArray<uint8> Header;
+	TArray<uint8> Compressed;
+	TUniquePtr<IFileHandle> File;
+	TQueue<TArray<uint8>, EQueueMode::Spsc> Pending;
+	FEvent* WorkEvent;
+	std::atomic<bool> bStopping = false;
+	std::atomic<bool> bFailed = false;
+};
+
+bool UTP3MatchRecorderSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3MatchRecorderSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3MatchRecorderSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3MatchRecorderSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FString Filename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("TP3Record="), Filename) || FParse::Param(FCommandLine::Get(), TEXT("TP3Record")))
+	{
+		StartRecording(Filename);
+	}
+}
+
+void UTP3MatchRecorderSubsystem::Deinitialize()
+{
+	StopRecording();
+
+	Super::Deinitialize();
+}
+
+void UTP3MatchRecorderSubsystem::StartRecording(const FString& Filename)
+{
+	// Only the authority sees every event
+	if (IsRecording() || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const FString MapName = GetWorld()->GetMapName();
+	const FString Path = Filename.IsEmpty()
+		? FPaths::ProjectSavedDir() / TEXT("Recordings") / FString::Printf(TEXT("%s_%s.tp3rec"), *MapName, *FDateTime::Now().ToString())
+		: Filename;
+
+	TP3MatchRecording::FWriter Header;
+	Header.Bytes.Append(reinterpret_cast<const uint8*>(&TP3MatchRecording::Magic), sizeof(uint32));
+	Header.Bytes.Append(reinterpret_cast<const uint8*>(&TP3MatchRecording::Version), sizeof(uint32));
+	Header.WriteString(MapName);
+
+	Writer = new FTP3RecordingWriter(Path, MoveTemp(Header.Bytes));
+	WriterThread = FRunnableThread::Create(Writer, TEXT("TP3RecordingWriter"), 0, TPri_BelowNormal);
+
+	Chunk.Bytes.Reset();
+	Chunk.Bytes.Reserve(ChunkSize + 1024);
+	LastLocations.Reset();
+	LastYaws.Reset();
+	TimeSinceSample = SampleInterval;
+
+	// Combatants already in the match
+	if (UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>())
+	{
+		Registry->SetRecorder(this);
+		for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+		{
+			if (Registry->IsValidCombatant(Id) && Registry->GetActor(Id))
+			{
+				RecordSpawn(Id, *Registry->GetActor(Id), Registry->GetTeam(Id), Registry->GetMaxLife(Id));
+			}
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Match recorder: recording to %s"), *Path);
+}
+
+void UTP3MatchRecorderSubsystem::StopRecording()
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	if (UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>())
+	{
+		Registry->SetRecorder(nullptr);
+	}
+
+	FlushChunk();
+
+	// Waits for the last chunks, once at the end of the recording
+	WriterThread->Kill(true);
+	delete WriterThread;
+	delete Writer;
+	WriterThread = nullptr;
+	Writer = nullptr;
+}
+
+void UTP3MatchRecorderSubsystem::FlushChunk()
+{
+	if (Writer && Chunk.Bytes.Num() > 0)
+	{
+		INC_DWORD_STAT_BY(STAT_TP3Recorder_Bytes, Chunk.Bytes.Num());
+		Writer->Enqueue(MoveTemp(Chunk.Bytes));
+		Chunk.Bytes.Reset(ChunkSize + 1024);
+	}
+}
+
+void UTP3MatchRecorderSubsystem::RecordSpawn(int32 Id, const AActor& Actor, uint8 Team, float MaxLife)
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	// The first sample of a new combatant is written against the origin
+	if (LastLocations.Num() <= Id)
+	{
+		LastLocations.SetNumZeroed(Id + 1);
+		LastYaws.SetNumZeroed(Id + 1);
+	}
+	LastLocations[Id] = FIntVector::ZeroValue;
+	LastYaws[Id] = 0;
+
+	Chunk.WriteTag(TP3MatchRecording::ETag::Spawn);
+	Chunk.WriteVarUInt(Id);
+	Chunk.WriteByte(Team);
+	Chunk.WriteFloat(MaxLife);
+	Chunk.WriteString(Actor.GetClass()->GetPathName());
+}
+
+void UTP3MatchRecorderSubsystem::RecordDespawn(int32 Id)
+{
+	if (IsRecording())
+	{
+		Chunk.WriteTag(TP3MatchRecording::ETag::Despawn);
+		Chunk.WriteVarUInt(Id);
+	}
+}
+
+void UTP3MatchRecorderSubsystem::RecordFireStart(int32 ShooterId, const FVector& Start, const FVector& End)
+{
+	if (IsRecording())
+	{
+		const FIntVector QuantizedStart = TP3MatchRecording::QuantizeLocation(Start);
+		Chunk.WriteTag(TP3MatchRecording::ETag::FireStart);
+		Chunk.WriteVarUInt(ShooterId);
+		Chunk.WriteIntVector(QuantizedStart);
+		Chunk.WriteIntVector(TP3MatchRecording::QuantizeLocation(End) - QuantizedStart);
+	}
+}
+
+void UTP3MatchRecorderSubsystem::RecordFireEnd(int32 ShooterId, int32 HitId, const FVector& Impact)
+{
+	if (IsRecording())
+	{
+		Chunk.WriteTag(TP3MatchRecording::ETag::FireEnd);
+		Chunk.WriteVarUInt(ShooterId);
+		Chunk.WriteVarUInt(HitId + 1);
+		Chunk.WriteIntVector(TP3MatchRecording::QuantizeLocation(Impact));
+	}
+}
+
+void UTP3MatchRecorderSubsystem::RecordDamage(int32 TargetId, float Amount, bool bKilled)
+{
+	if (IsRecording())
+	{
+		Chunk.WriteTag(TP3MatchRecording::ETag::Damage);
+		Chunk.WriteVarUInt(TargetId);
+		Chunk.WriteFloat(Amount);
+		Chunk.WriteByte(bKilled);
+	}
+}
+
+void UTP3MatchRecorderSubsystem::RecordRespawn(int32 Id, const FVector& Location)
+{
+	if (IsRecording())
+	{
+		Chunk.WriteTag(TP3MatchRecording::ETag::Respawn);
+		Chunk.WriteVarUInt(Id);
+		Chunk.WriteIntVector(TP3MatchRecording::QuantizeLocation(Location));
+	}
+}
+
+void UTP3MatchRecorderSubsystem::SampleTransforms()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Recorder_Sample);
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Registry)
+	{
+		return;
+	}
+
+	const int32 NumSlots = FMath::Min(Registry->GetNumSlots(), LastLocations.Num());
+
+	int32 Count = 0;
+	for (int32 Id = 0; Id < NumSlots; ++Id)
+	{
+		Count += Registry->IsValidCombatant(Id) && Registry->IsAlive(Id);
+	}
+
+	Chunk.WriteTag(TP3MatchRecording::ETag::Transforms);
+	Chunk.WriteVarUInt(Count);
+
+	for (int32 Id = 0; Id < NumSlots; ++Id)
+	{
+		if (!Registry->IsValidCombatant(Id) || !Registry->IsAlive(Id))
+		{
+			continue;
+		}
+		const AActor* Actor = Registry->GetActor(Id);
+
+		// Most combatants move a few hundred cm between two samples, one or two bytes per axis
+		const FIntVector Location = TP3MatchRecording::QuantizeLocation(Registry->GetLocation(Id));
+		const int32 Yaw = Actor ? TP3MatchRecording::QuantizeYaw(Actor->GetActorRotation().Yaw) : LastYaws[Id];
+
+		Chunk.WriteVarUInt(Id);
+		Chunk.WriteIntVector(Location - LastLocations[Id]);
+		Chunk.WriteVarInt(Yaw - LastYaws[Id]);
+
+		LastLocations[Id] = Location;
+		LastYaws[Id] = Yaw;
+	}
+}
+
+void UTP3MatchRecorderSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	// Otherwise the chunks pile up in the queue for the rest of the match
+	if (Writer->HasFailed())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Match recorder: the writer failed, recording stopped"));
+		StopRecording();
+		return;
+	}
+
+	TimeSinceSample += DeltaTime;
+	if (TimeSinceSample >= SampleInterval)
+	{
+		TimeSinceSample = 0.f;
+		SampleTransforms();
+	}
+
+	// The events of the frame were recorded while the actors ticked
+	Chunk.WriteTag(TP3MatchRecording::ETag::FrameEnd);
+	Chunk.WriteFloat(DeltaTime);
+
+	if (Chunk.Bytes.Num() >= ChunkSize)
+	{
+		FlushChunk();
+	}
+}
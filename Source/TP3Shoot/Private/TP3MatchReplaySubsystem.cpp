@@ -0,0 +1,345 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3MatchReplaySubsystem.h"
+#include "AI_Player.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3HitscanSubsystem.h"
+#include "TP3HitZoneComponent.h"
+#include "TP3MatchRecording.h"
+#include "TP3RespawnSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3Shoot/TP3ShootCharacter.h"
+#include "TP3TracerSubsystem.h"
+
+DECLARE_CYCLE_STAT(TEXT("Match replay frame"), STAT_TP3Replay_Frame, STATGROUP_TP3Shoot);
+
+bool UTP3MatchReplaySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	FString Filename;
+	return FParse::Value(FCommandLine::Get(), TEXT("TP3Replay="), Filename) && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UTP3MatchReplaySubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game;
+}
+
+TStatId UTP3MatchReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3MatchReplaySubsystem, STATGROUP_Tickables);
+}
+
+void UTP3MatchReplaySubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	FString Filename;
+	FParse::Value(FCommandLine::Get(), TEXT("TP3Replay="), Filename);
+	if (!Load(Filename))
+	{
+		FPlatformMisc::RequestExit(false, TEXT("TP3Replay"));
+		return;
+	}
+
+	// Only the recorded combatants, the local player pawn included
+	if (UTP3CombatantRegistry* Registry = InWorld.GetSubsystem<UTP3CombatantRegistry>())
+	{
+		for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+		{
+			if (AActor* Actor = Registry->IsValidCombatant(Id) ? Registry->GetActor(Id) : nullptr)
+			{
+				Actor->Destroy();
+			}
+		}
+	}
+
+	// Recorded kills must not queue respawns of their own, only the recorded respawns bring the puppets back
+	if (UTP3RespawnSubsystem* Respawn = InWorld.GetSubsystem<UTP3RespawnSubsystem>())
+	{
+		Respawn->SetSuspended(true);
+	}
+
+	ShotQueryParams = FCollisionQueryParams(FName(TEXT("ReplayTrace")));
+	bPlaying = true;
+	StartWallTime = FPlatformTime::Seconds();
+}
+
+bool UTP3MatchReplaySubsystem::Load(const FString& Filename)
+{
+	TArray<uint8> File;
+	if (!FFileHelper::LoadFileToArray(File, *Filename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Replay: cannot read %s"), *Filename);
+		return false;
+	}
+
+	TP3MatchRecording::FReader Reader{ File };
+	uint32 Header[2] = {};
+	for (uint32& Value : Header)
+	{
+		for (int32 Byte = 0; Byte < 4; ++Byte)
+		{
+			Value |= uint32(Reader.ReadByte()) << (Byte * 8);
+		}
+	}
+	if (Header[0] != TP3MatchRecording::Magic || Header[1] != TP3MatchRecording::Version)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Replay: %s is not a version %u recording"), *Filename, TP3MatchRecording::Version);
+		return false;
+	}
+
+	const FString MapName = Reader.ReadString();
+	if (MapName != GetWorld()->GetMapName())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Replay: recorded on %s, playing on %s"), *MapName, *GetWorld()->GetMapName());
+	}
+
+	// Chunks of [raw size][compressed size][data]
+	while (Reader.Offset + 8 <= File.Num())
+	{
+		uint32 Sizes[2];
+		FMemory::Memcpy(Sizes, File.GetData() + Reader.Offset, sizeof(Sizes));
+		Reader.Offset += sizeof(Sizes);
+		if (Reader.Offset + int64(Sizes[1]) > File.Num())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Replay: truncated chunk, the recording stops there"));
+			break;
+		}
+
+		const int32 StreamOffset = Stream.AddUninitialized(Sizes[0]);
+		if (!FCompression::UncompressMemory(NAME_Oodle, Stream.GetData() + StreamOffset, Sizes[0], File.GetData() + Reader.Offset, Sizes[1]))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Replay: corrupted chunk, the recording stops there"));
+			Stream.SetNum(StreamOffset);
+			break;
+		}
+		Reader.Offset += Sizes[1];
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Replay: %s, %d KB of records"), *Filename, Stream.Num() / 1024);
+	return true;
+}
+
+UTP3MatchReplaySubsystem::FReplayCombatant* UTP3MatchReplaySubsystem::FindCombatant(int32 Id)
+{
+	return Combatants.IsValidIndex(Id) && Combatants[Id].Actor.IsValid() ? &Combatants[Id] : nullptr;
+}
+
+void UTP3MatchReplaySubsystem::Spawn(int32 Id, uint8 Team, float MaxLife, const FString& ClassPath)
+{
+	if (Combatants.Num() <= Id)
+	{
+		Combatants.SetNum(Id + 1);
+	}
+	Combatants[Id] = FReplayCombatant();
+
+	UClass* Class = FSoftClassPath(ClassPath).TryLoadClass<AActor>();
+	if (!Class)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Replay: unknown combatant class %s"), *ClassPath);
+		return;
+	}
+
+	AActor* Actor = GetWorld()->SpawnActorDeferred<AActor>(Class, FTransform::Identity, nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!Actor)
+	{
+		return;
+	}
+
+	// Puppets: no brain and no input, everything comes from the recording
+	if (APawn* Pawn = Cast<APawn>(Actor))
+	{
+		Pawn->AutoPossessAI = EAutoPossessAI::Disabled;
+		Pawn->AutoPossessPlayer = EAutoReceiveInput::Disabled;
+	}
+	if (AAI_Player* Bot = Cast<AAI_Player>(Actor))
+	{
+		Bot->Team = Team;
+		Bot->Life = MaxLife;
+	}
+	else if (ATP3ShootCharacter* Player = Cast<ATP3ShootCharacter>(Actor))
+	{
+		Player->Team = Team;
+		Player->Life = MaxLife;
+	}
+	Actor->FinishSpawning(FTransform::Identity);
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	Combatants[Id].Actor = Actor;
+	Combatants[Id].CombatantId = Registry ? Registry->FindCombatant(Actor) : INDEX_NONE;
+}
+
+bool UTP3MatchReplaySubsystem::PlayFrame()
+{
+	using namespace TP3MatchRecording;
+
+	UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>();
+	UTP3TracerSubsystem* Tracers = GetWorld()->GetSubsystem<UTP3TracerSubsystem>();
+
+	FReader Reader{ Stream, Offset };
+	while (!Reader.AtEnd() && Reader.IsValid())
+	{
+		const ETag Tag = ETag(Reader.ReadByte());
+		switch (Tag)
+		{
+		case ETag::FrameEnd:
+			RecordedSeconds += Reader.ReadFloat();
+			Offset = Reader.Offset;
+			return Reader.IsValid();
+
+		case ETag::Spawn:
+		{
+			const int32 Id = Reader.ReadVarUInt();
+			const uint8 Team = Reader.ReadByte();
+			const float MaxLife = Reader.ReadFloat();
+			const FString ClassPath = Reader.ReadString();
+			Spawn(Id, Team, MaxLife, ClassPath);
+			break;
+		}
+
+		case ETag::Despawn:
+			if (FReplayCombatant* Combatant = FindCombatant(Reader.ReadVarUInt()))
+			{
+				Combatant->Actor->Destroy();
+				Combatant->Actor.Reset();
+			}
+			break;
+
+		case ETag::FireStart:
+		{
+			FReplayCombatant* Combatant = FindCombatant(Reader.ReadVarUInt());
+			const FIntVector Start = Reader.ReadIntVector();
+			const FIntVector End = Start + Reader.ReadIntVector();
+			if (Combatant && Hitscan)
+			{
+				// Same trace as the match, for its cost, the recorded outcome is applied below
+				FTP3HitscanShot Shot;
+				Shot.Start = FVector(Start);
+				Shot.End = FVector(End);
+				Shot.Channel = UTP3HitZoneComponent::GetWeaponChannel(ECC_Visibility);
+				Shot.Shooter = Combatant->Actor;
+				Shot.QueryParams = &ShotQueryParams;
+				Hitscan->QueueShot(MoveTemp(Shot));
+				Combatant->LastFireStart = FVector(Start);
+			}
+			break;
+		}
+
+		case ETag::FireEnd:
+		{
+			FReplayCombatant* Combatant = FindCombatant(Reader.ReadVarUInt());
+			Reader.ReadVarUInt();
+			const FIntVector Impact = Reader.ReadIntVector();
+			if (Combatant && Tracers && Registry && Registry->IsValidCombatant(Combatant->CombatantId))
+			{
+				Tracers->AddTracer(Combatant->LastFireStart, FVector(Impact), Registry->GetTeam(Combatant->CombatantId));
+			}
+			break;
+		}
+
+		case ETag::Damage:
+		{
+			FReplayCombatant* Combatant = FindCombatant(Reader.ReadVarUInt());
+			const float Amount = Reader.ReadFloat();
+			Reader.ReadByte();
+			if (Combatant && Registry)
+			{
+				Registry->ApplyDamage(Combatant->CombatantId, Amount);
+			}
+			break;
+		}
+
+		case ETag::Respawn:
+		{
+			FReplayCombatant* Combatant = FindCombatant(Reader.ReadVarUInt());
+			const FIntVector Location = Reader.ReadIntVector();
+			if (Combatant)
+			{
+				UTP3RespawnSubsystem* Respawn = GetWorld()->GetSubsystem<UTP3RespawnSubsystem>();
+				if (ACharacter* Character = Respawn ? Cast<ACharacter>(Combatant->Actor.Get()) : nullptr)
+				{
+					Respawn->RespawnAt(Character, Combatant->CombatantId, FVector(Location));
+				}
+				else
+				{
+					Combatant->Actor->SetActorLocation(FVector(Location), false, nullptr, ETeleportType::TeleportPhysics);
+					if (Registry)
+					{
+						Registry->Revive(Combatant->CombatantId);
+					}
+				}
+			}
+			break;
+		}
+
+		case ETag::Transforms:
+		{
+			const int32 Count = Reader.ReadVarUInt();
+			for (int32 Index = 0; Index < Count && Reader.IsValid(); ++Index)
+			{
+				const int32 Id = Reader.ReadVarUInt();
+				const FIntVector LocationDelta = Reader.ReadIntVector();
+				const int32 YawDelta = Reader.ReadVarInt();
+
+				// Deltas are against the previous sample even when the actor could not be spawned
+				if (Combatants.Num() <= Id)
+				{
+					Combatants.SetNum(Id + 1);
+				}
+				FReplayCombatant& Combatant = Combatants[Id];
+				Combatant.Location += LocationDelta;
+				Combatant.Yaw += YawDelta;
+				if (AActor* Actor = Combatant.Actor.Get())
+				{
+					Actor->SetActorLocationAndRotation(FVector(Combatant.Location), FRotator(0.f, DequantizeYaw(Combatant.Yaw), 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+				}
+			}
+			break;
+		}
+
+		default:
+			UE_LOG(LogTemp, Error, TEXT("Replay: unknown record %d at %d"), int32(Tag), Reader.Offset - 1);
+			return false;
+		}
+	}
+
+	return false;
+}
+
+void UTP3MatchReplaySubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bPlaying)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Replay_Frame);
+
+	if (PlayFrame())
+	{
+		++NumFrames;
+		return;
+	}
+
+	Finish();
+}
+
+void UTP3MatchReplaySubsystem::Finish()
+{
+	bPlaying = false;
+
+	const double WallSeconds = FPlatformTime::Seconds() - StartWallTime;
+	UE_LOG(LogTemp, Display, TEXT("Replay: %d frames, %.1f recorded seconds in %.1f s (%.1fx real time)"),
+		NumFrames, RecordedSeconds, WallSeconds, WallSeconds > 0.0 ? RecordedSeconds / WallSeconds : 0.0);
+
+	FPlatformMisc::RequestExit(false, TEXT("TP3Replay"));
+}
@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3PathBrokerSubsystem.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "NavigationSystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Path broker launch"), STAT_TP3Path_Launch, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Path broker dispatch"), STAT_TP3Path_Dispatch, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Path requests queued"), STAT_TP3Path_Queued, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path queries"), STAT_TP3Path_Queries, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Path requests sharing a corridor"), STAT_TP3Path_Shared, STATGROUP_TP3Shoot);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Path latency p50 ms"), STAT_TP3Path_LatencyP50, STATGROUP_TP3Shoot);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Path latency p90 ms"), STAT_TP3Path_LatencyP90, STATGROUP_TP3Shoot);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Path latency p99 ms"), STAT_TP3Path_LatencyP99, STATGROUP_TP3Shoot);
+
+void UTP3PathBrokerSubsystem::Deinitialize()
+{
+	Groups.Reset();
+	GroupByKey.Reset();
+	Queue.Reset();
+	GroupByQueryId.Reset();
+	GroupByRequestId.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3PathBrokerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3PathBrokerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3PathBrokerSubsystem, STATGROUP_Tickables);
+}
+
+int32 UTP3PathBrokerSubsystem::RequestPath(AActor& Agent, const FVector& Goal, FTP3OnPathReady&& OnReady)
+{
+	const APawn* Pawn = Cast<APawn>(&Agent);
+	const FVector Start = Pawn ? Pawn->GetNavAgentLocation() : Agent.GetActorLocation();
+
+	const FIntVector4 Key(
+		FMath::FloorToInt(Start.X / CorridorCellSize), FMath::FloorToInt(Start.Y / CorridorCellSize),
+		FMath::FloorToInt(Goal.X / CorridorCellSize), FMath::FloorToInt(Goal.Y / CorridorCellSize));
+
+	int32 GroupId;
+	if (const int32* OpenGroup = GroupByKey.Find(Key))
+	{
+		GroupId = *OpenGroup;
+		INC_DWORD_STAT(STAT_TP3Path_Shared);
+	}
+	else
+	{
+		GroupId = NextId++;
+		Groups.Add(GroupId).Key = Key;
+		GroupByKey.Add(Key, GroupId);
+		Queue.Add(GroupId);
+	}
+
+	FRequest& Request = Groups[GroupId].Requests.AddDefaulted_GetRef();
+	Request.RequestId = NextId++;
+	Request.Agent = &Agent;
+	Request.Start = Start;
+	Request.Goal = Goal;
+	Request.RequestTime = FPlatformTime::Seconds();
+	Request.OnReady = MoveTemp(OnReady);
+
+	GroupByRequestId.Add(Request.RequestId, GroupId);
+	return Request.RequestId;
+}
+
+void UTP3PathBrokerSubsystem::CancelRequest(int32 RequestId)
+{
+	int32 GroupId;
+	if (!GroupByRequestId.RemoveAndCopyValue(RequestId, GroupId))
+	{
+		return;
+	}
+
+	// The leader stays in place for the others, its callback is just dropped
+	if (FGroup* Group = Groups.Find(GroupId))
+	{
+		for (FRequest& Request : Group->Requests)
+		{
+			if (Request.RequestId == RequestId)
+			{
+				Request.OnReady.Unbind();
+			}
+		}
+	}
+}
+
+void UTP3PathBrokerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	LaunchQueries();
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextStatsTime)
+	{
+		UpdateLatencyStats();
+		NextStatsTime = Now + 1.0;
+	}
+
+	SET_DWORD_STAT(STAT_TP3Path_Queued, GroupByRequestId.Num());
+}
+
+void UTP3PathBrokerSubsystem::LaunchQueries()
+{
+	if (Queue.Num() == 0)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Path_Launch);
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+
+	int32 NumTaken = 0;
+	int32 NumLaunched = 0;
+	while (NumTaken < Queue.Num() && NumLaunched < MaxQueriesPerFrame)
+	{
+		const int32 GroupId = Queue[NumTaken++];
+		FGroup& Group = Groups.FindChecked(GroupId);
+
+		// Queried from the first request whose agent is still there
+		int32 LeaderIndex = Group.Requests.IndexOfByPredicate([](const FRequest& Request) { return Request.Agent.IsValid(); });
+		const APawn* Pawn = LeaderIndex != INDEX_NONE ? Cast<APawn>(Group.Requests[LeaderIndex].Agent.Get()) : nullptr;
+		const ANavigationData* NavData = NavSys && Pawn ? NavSys->GetNavDataForProps(Pawn->GetNavAgentPropertiesRef(), Pawn->GetNavAgentLocation()) : nullptr;
+		if (!NavData)
+		{
+			DispatchGroup(GroupId, nullptr);
+			continue;
+		}
+
+		if (LeaderIndex != 0)
+		{
+			Group.Requests.Swap(0, LeaderIndex);
+		}
+
+		const FRequest& Leader = Group.Requests[0];
+		FPathFindingQuery Query(Pawn, *NavData, Leader.Start, Leader.Goal, NavData->GetDefaultQueryFilter());
+		Group.QueryId = NavSys->FindPathAsync(Pawn->GetNavAgentPropertiesRef(), Query,
+			FNavPathQueryDelegate::CreateUObject(this, &UTP3PathBrokerSubsystem::OnPathFound), EPathFindingMode::Regular);
+		GroupByQueryId.Add(Group.QueryId, GroupId);
+
+		++NumLaunched;
+		INC_DWORD_STAT(STAT_TP3Path_Queries);
+	}
+
+	Queue.RemoveAt(0, NumTaken, EAllowShrinking::No);
+}
+
+void UTP3PathBrokerSubsystem::OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	int32 GroupId;
+	if (GroupByQueryId.RemoveAndCopyValue(QueryId, GroupId))
+	{
+		DispatchGroup(GroupId, Result == ENavigationQueryResult::Success && Path.IsValid() && Path->IsValid() ? Path : nullptr);
+	}
+}
+
+void UTP3PathBrokerSubsystem::DispatchGroup(int32 GroupId, FNavPathSharedPtr LeaderPath)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Path_Dispatch);
+
+	FGroup Group;
+	if (!Groups.RemoveAndCopyValue(GroupId, Group))
+	{
+		return;
+	}
+	if (const int32* OpenGroup = GroupByKey.Find(Group.Key); OpenGroup && *OpenGroup == GroupId)
+	{
+		GroupByKey.Remove(Group.Key);
+	}
+
+	for (int32 Index = 0; Index < Group.Requests.Num(); ++Index)
+	{
+		FRequest& Request = Group.Requests[Index];
+		if (!GroupByRequestId.Remove(Request.RequestId))
+		{
+			// Cancelled
+			continue;
+		}
+
+		FNavPathSharedPtr Path = LeaderPath;
+		if (LeaderPath.IsValid() && Index > 0)
+		{
+			Path = MakeSharedPath(*LeaderPath, Group.Requests[0], Request);
+			if (!Path.IsValid())
+			{
+				QueueAlone(MoveTemp(Request));
+				continue;
+			}
+		}
+
+		RecordLatency(Request.RequestTime);
+		Request.OnReady.ExecuteIfBound(Path);
+	}
+}
+
+void UTP3PathBrokerSubsystem::QueueAlone(FRequest&& Request)
+{
+	// Not in GroupByKey, so no other request joins it
+	const int32 GroupId = NextId++;
+	GroupByRequestId.Add(Request.RequestId, GroupId);
+	Groups.Add(GroupId).Requests.Add(MoveTemp(Request));
+	Queue.Add(GroupId);
+}
+
+FNavPathSharedPtr UTP3PathBrokerSubsystem::MakeSharedPath(const FNavigationPath& LeaderPath, const FRequest& Leader, const FRequest& Request) const
+{
+	const UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	const ANavigationData* NavData = LeaderPath.GetNavigationDataUsed();
+
+	// Keeps the follower on its side of the corridor instead of on the exact points of the leader
+	const FVector Offset = (Request.Start - Leader.Start).GetClampedToMaxSize2D(CorridorWidth) * FVector(1.f, 1.f, 0.f);
+	const FVector Extent(CorridorWidth, CorridorWidth, 200.f);
+
+	const TArray<FNavPathPoint>& LeaderPoints = LeaderPath.GetPathPoints();
+	TArray<FVector> Points;
+	Points.Reserve(LeaderPoints.Num());
+	Points.Add(Request.Start);
+	for (int32 Index = 1; Index < LeaderPoints.Num() - 1; ++Index)
+	{
+		FNavLocation Projected;
+		const FVector Point = LeaderPoints[Index].Location + Offset;
+		const bool bOnNavMesh = NavSys && NavData && NavSys->ProjectPointToNavigation(Point, Projected, Extent, NavData);
+		Points.Add(bOnNavMesh ? Projected.Location : LeaderPoints[Index].Location);
+	}
+	Points.Add(Request.Goal);
+
+	// The corridor is only checked around the leader, the legs from the follower start and to its goal may cross a wall
+	FVector HitLocation;
+	const FSharedConstNavQueryFilter Filter = NavData ? NavData->GetDefaultQueryFilter() : nullptr;
+	if (!NavData
+		|| NavData->Raycast(Points[0], Points[1], HitLocation, Filter)
+		|| NavData->Raycast(Points[Points.Num() - 2], Points.Last(), HitLocation, Filter))
+	{
+		return nullptr;
+	}
+
+	FNavPathSharedRef Path = MakeShared<FNavigationPath, ESPMode::ThreadSafe>(Points, nullptr);
+	Path->SetNavigationDataUsed(NavData);
+	return Path;
+}
+
+void UTP3PathBrokerSubsystem::RecordLatency(double RequestTime)
+{
+	const float Ms = float((FPlatformTime::Seconds() - RequestTime) * 1000.0);
+	if (LatenciesMs.Num() < LatencyWindow)
+	{
+		LatenciesMs.Add(Ms);
+	}
+	else
+	{
+		LatenciesMs[NextLatency] = Ms;
+	}
+	NextLatency = (NextLatency + 1) % LatencyWindow;
+}
+
+void UTP3PathBrokerSubsystem::UpdateLatencyStats()
+{
+	if (LatenciesMs.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<float, TInlineAllocator<LatencyWindow>> Sorted(LatenciesMs);
+	Sorted.Sort();
+	const auto Percentile = [&Sorted](float Ratio) { return Sorted[FMath::Min(Sorted.Num() - 1, FMath::FloorToInt(Ratio * Sorted.Num()))]; };
+
+	SET_FLOAT_STAT(STAT_TP3Path_LatencyP50, Percentile(0.5f));
+	SET_FLOAT_STAT(STAT_TP3Path_LatencyP90, Percentile(0.9f));
+	SET_FLOAT_STAT(STAT_TP3Path_LatencyP99, Percentile(0.99f));
+}
@@ -0,0 +1,348 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3ProjectileSubsystem.h"
+#include "AI_Player.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3HitZoneComponent.h"
+#include "TP3MatchRecorderSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Projectile resolve batch"), STAT_TP3Projectile_Resolve, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Projectile integrate"), STAT_TP3Projectile_Integrate, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Projectile submit batch"), STAT_TP3Projectile_Submit, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Projectiles in flight"), STAT_TP3Projectile_InFlight, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectile impacts"), STAT_TP3Projectile_Impacts, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Projectiles dropped"), STAT_TP3Projectile_Dropped, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<bool> CVarProjectileBullets(
+	TEXT("tp3.Projectile.Bullets"),
+	false,
+	TEXT("Bots fire bullets with travel time, gravity and drag instead of instant hitscan shots."));
+
+static FAutoConsoleCommandWithWorldAndArgs CmdProjectileStress(
+	TEXT("tp3.Projectile.Stress"),
+	TEXT("tp3.Projectile.Stress <Count>: fires Count bullets without damage from random combatants."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UTP3ProjectileSubsystem* Subsystem = World ? World->GetSubsystem<UTP3ProjectileSubsystem>() : nullptr;
+			if (Subsystem && Args.Num() > 0)
+			{
+				Subsystem->LaunchStress(FCString::Atoi(*Args[0]));
+			}
+		}));
+
+void UTP3ProjectileSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Collection.InitializeDependency<UTP3CombatantRegistry>();
+
+	Super::Initialize(Collection);
+
+	Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+
+	// Padded to whole vectors, the padding lanes are integrated with the others and never read
+	const int32 Capacity = Align(FMath::Max(MaxProjectiles, 4), 4);
+	for (TArray<float>* Buffer : { &PosX, &PosY, &PosZ, &PrevX, &PrevY, &PrevZ, &VelX, &VelY, &VelZ, &Ages })
+	{
+		Buffer->SetNumZeroed(Capacity);
+	}
+	ShooterIds.SetNumZeroed(Capacity);
+	Shooters.SetNum(Capacity);
+	Damages.SetNumZeroed(Capacity);
+	LaunchLocations.SetNumZeroed(Capacity);
+	DeadFlags.SetNumZeroed(Capacity);
+	InFlightTraces.Reserve(Capacity);
+}
+
+void UTP3ProjectileSubsystem::Deinitialize()
+{
+	NumProjectiles = 0;
+	InFlightTraces.Reset();
+	ShooterQueryParams.Reset();
+	ShooterQueryParamsOwners.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3ProjectileSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3ProjectileSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3ProjectileSubsystem, STATGROUP_Tickables);
+}
+
+bool UTP3ProjectileSubsystem::ShouldFireBullets()
+{
+	return CVarProjectileBullets.GetValueOnGameThread();
+}
+
+bool UTP3ProjectileSubsystem::Launch(int32 ShooterId, const FVector& Start, const FVector& Direction, float Damage)
+{
+	if (!Registry || !Registry->IsValidCombatant(ShooterId))
+	{
+		return false;
+	}
+
+	if (NumProjectiles >= MaxProjectiles)
+	{
+		INC_DWORD_STAT(STAT_TP3Projectile_Dropped);
+		return false;
+	}
+
+	TP3_COUNT_COMBAT_EVENT(Shots);
+
+	const int32 Index = NumProjectiles++;
+	const FVector Velocity = Direction.GetSafeNormal() * MuzzleSpeed;
+	PosX[Index] = PrevX[Index] = Start.X;
+	PosY[Index] = PrevY[Index] = Start.Y;
+	PosZ[Index] = PrevZ[Index] = Start.Z;
+	VelX[Index] = Velocity.X;
+	VelY[Index] = Velocity.Y;
+	VelZ[Index] = Velocity.Z;
+	Ages[Index] = 0.f;
+	ShooterIds[Index] = ShooterId;
+	Shooters[Index] = Registry->GetActor(ShooterId);
+	Damages[Index] = Damage;
+	LaunchLocations[Index] = FVector3f(Start);
+	DeadFlags[Index] = 0;
+
+	// Built now so the batch submit only reads it
+	GetShooterQueryParams(ShooterId);
+
+	return true;
+}
+
+void UTP3ProjectileSubsystem::LaunchStress(int32 Count)
+{
+	if (!Registry)
+	{
+		return;
+	}
+
+	TArray<int32> Alive;
+	for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+	{
+		if (Registry->IsValidCombatant(Id) && Registry->IsAlive(Id))
+		{
+			Alive.Add(Id);
+		}
+	}
+
+	for (int32 Shot = 0; Shot < Count && Alive.Num() > 0; ++Shot)
+	{
+		const int32 ShooterId = Alive[FMath::RandHelper(Alive.Num())];
+		const FVector Direction = FRotator(FMath::FRandRange(-2.f, 5.f), FMath::FRandRange(0.f, 360.f), 0.f).Vector();
+		const FVector Start = Registry->GetLocation(ShooterId) + FVector(0.f, 0.f, 60.f) + Direction * 60.f;
+		if (!Launch(ShooterId, Start, Direction, 0.f))
+		{
+			break;
+		}
+	}
+}
+
+const FCollisionQueryParams& UTP3ProjectileSubsystem::GetShooterQueryParams(int32 ShooterId)
+{
+	if (ShooterQueryParams.Num() <= ShooterId)
+	{
+		ShooterQueryParams.SetNum(ShooterId + 1);
+		ShooterQueryParamsOwners.SetNum(ShooterId + 1);
+	}
+
+	// Ids are reused once a combatant leaves the registry
+	AActor* Shooter = Registry->GetActor(ShooterId);
+	if (ShooterQueryParamsOwners[ShooterId] != Shooter)
+	{
+		ShooterQueryParams[ShooterId] = FCollisionQueryParams(FName(TEXT("ProjectileTrace")), UTP3HitZoneComponent::UseLegacyTraces(), Shooter);
+		ShooterQueryParams[ShooterId].bReturnPhysicalMaterial = false;
+		ShooterQueryParamsOwners[ShooterId] = Shooter;
+	}
+	return ShooterQueryParams[ShooterId];
+}
+
+void UTP3ProjectileSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// Last frame's segments have been traced by the worker threads while the world ticked
+	ResolveTraces();
+	Compact();
+	Integrate(DeltaTime);
+	SubmitTraces();
+
+	SET_DWORD_STAT(STAT_TP3Projectile_InFlight, NumProjectiles);
+}
+
+void UTP3ProjectileSubsystem::ResolveTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Projectile_Resolve);
+
+	UWorld* World = GetWorld();
+	FTraceDatum Datum;
+
+	for (const FInFlightTrace& InFlight : InFlightTraces)
+	{
+		if (!World->QueryTraceData(InFlight.Handle, Datum))
+		{
+			continue;
+		}
+
+		for (const FHitResult& Hit : Datum.OutHits)
+		{
+			if (Hit.bBlockingHit)
+			{
+				Impact(InFlight.Index, Hit);
+				break;
+			}
+		}
+	}
+
+	InFlightTraces.Reset();
+}
+
+void UTP3ProjectileSubsystem::Impact(int32 Index, const FHitResult& Hit)
+{
+	DeadFlags[Index] = 1;
+	INC_DWORD_STAT(STAT_TP3Projectile_Impacts);
+
+	// The shooter may have left the registry while its bullet was flying, and its id been given to another combatant
+	const int32 ShooterId = ShooterIds[Index];
+	AActor* Shooter = Shooters[Index].Get();
+	if (!Shooter || Registry->GetActor(ShooterId) != Shooter)
+	{
+		return;
+	}
+
+	if (Damages[Index] > 0.f)
+	{
+		Registry->TryDamageEnemy(ShooterId, Hit.GetActor(), Damages[Index] * UTP3HitZoneComponent::GetDamageMultiplier(Hit));
+	}
+
+	if (UTP3MatchRecorderSubsystem* Recorder = GetWorld()->GetSubsystem<UTP3MatchRecorderSubsystem>())
+	{
+		Recorder->RecordFireEnd(ShooterId, Registry->FindCombatant(Hit.GetActor()), Hit.Location);
+	}
+
+	// Same tracer and impact as a hitscan shot, from the muzzle to where the bullet landed
+	if (AAI_Player* Bot = Cast<AAI_Player>(Shooter))
+	{
+		Bot->MulticastShotEffects(FVector(LaunchLocations[Index]), Hit.Location, true);
+	}
+}
+
+void UTP3ProjectileSubsystem::MoveSlot(int32 From, int32 To)
+{
+	PosX[To] = PosX[From];
+	PosY[To] = PosY[From];
+	PosZ[To] = PosZ[From];
+	PrevX[To] = PrevX[From];
+	PrevY[To] = PrevY[From];
+	PrevZ[To] = PrevZ[From];
+	VelX[To] = VelX[From];
+	VelY[To] = VelY[From];
+	VelZ[To] = VelZ[From];
+	Ages[To] = Ages[From];
+	ShooterIds[To] = ShooterIds[From];
+	Shooters[To] = MoveTemp(Shooters[From]);
+	Damages[To] = Damages[From];
+	LaunchLocations[To] = LaunchLocations[From];
+	DeadFlags[To] = DeadFlags[From];
+}
+
+void UTP3ProjectileSubsystem::Compact()
+{
+	const float KillZ = GetWorld()->GetWorldSettings() ? GetWorld()->GetWorldSettings()->KillZ : -UE_BIG_NUMBER;
+
+	int32 Index = 0;
+	while (Index < NumProjectiles)
+	{
+		const bool bDead = DeadFlags[Index] || Ages[Index] > MaxLifetime || PosZ[Index] < KillZ;
+		if (!bDead)
+		{
+			++Index;
+			continue;
+		}
+
+		// Order does not matter, fill the hole with the last bullet
+		--NumProjectiles;
+		if (Index != NumProjectiles)
+		{
+			MoveSlot(NumProjectiles, Index);
+		}
+		Shooters[NumProjectiles].Reset();
+	}
+}
+
+void UTP3ProjectileSubsystem::Integrate(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Projectile_Integrate);
+
+	const VectorRegister4Float Dt = VectorSetFloat1(DeltaTime);
+	const VectorRegister4Float GravityDt = VectorSetFloat1(GetWorld()->GetGravityZ() * DeltaTime);
+	const VectorRegister4Float DragDt = VectorSetFloat1(DragCoefficient * DeltaTime);
+	const VectorRegister4Float One = VectorOneFloat();
+	const VectorRegister4Float Zero = VectorZeroFloat();
+
+	float* RESTRICT X = PosX.GetData();
+	float* RESTRICT Y = PosY.GetData();
+	float* RESTRICT Z = PosZ.GetData();
+	float* RESTRICT PX = PrevX.GetData();
+	float* RESTRICT PY = PrevY.GetData();
+	float* RESTRICT PZ = PrevZ.GetData();
+	float* RESTRICT VX = VelX.GetData();
+	float* RESTRICT VY = VelY.GetData();
+	float* RESTRICT VZ = VelZ.GetData();
+	float* RESTRICT Age = Ages.GetData();
+
+	const int32 Num = Align(NumProjectiles, 4);
+	for (int32 Index = 0; Index < Num; Index += 4)
+	{
+		VectorRegister4Float VelocityX = VectorLoad(VX + Index);
+		VectorRegister4Float VelocityY = VectorLoad(VY + Index);
+		VectorRegister4Float VelocityZ = VectorLoad(VZ + Index);
+
+		// Quadratic drag as a scale of the velocity, clamped so a long frame cannot reverse it
+		const VectorRegister4Float SpeedSq = VectorMultiplyAdd(VelocityX, VelocityX, VectorMultiplyAdd(VelocityY, VelocityY, VectorMultiply(VelocityZ, VelocityZ)));
+		const VectorRegister4Float DragScale = VectorMax(VectorSubtract(One, VectorMultiply(DragDt, VectorSqrt(SpeedSq))), Zero);
+		VelocityX = VectorMultiply(VelocityX, DragScale);
+		VelocityY = VectorMultiply(VelocityY, DragScale);
+		VelocityZ = VectorMultiplyAdd(VelocityZ, DragScale, GravityDt);
+
+		const VectorRegister4Float LocationX = VectorLoad(X + Index);
+		const VectorRegister4Float LocationY = VectorLoad(Y + Index);
+		const VectorRegister4Float LocationZ = VectorLoad(Z + Index);
+		VectorStore(LocationX, PX + Index);
+		VectorStore(LocationY, PY + Index);
+		VectorStore(LocationZ, PZ + Index);
+		VectorStore(VectorMultiplyAdd(VelocityX, Dt, LocationX), X + Index);
+		VectorStore(VectorMultiplyAdd(VelocityY, Dt, LocationY), Y + Index);
+		VectorStore(VectorMultiplyAdd(VelocityZ, Dt, LocationZ), Z + Index);
+		VectorStore(VelocityX, VX + Index);
+		VectorStore(VelocityY, VY + Index);
+		VectorStore(VelocityZ, VZ + Index);
+		VectorStore(VectorAdd(VectorLoad(Age + Index), Dt), Age + Index);
+	}
+}
+
+void UTP3ProjectileSubsystem::SubmitTraces()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Projectile_Submit);
+
+	UWorld* World = GetWorld();
+	const ECollisionChannel Channel = UTP3HitZoneComponent::GetWeaponChannel(ECC_Visibility);
+	for (int32 Index = 0; Index < NumProjectiles; ++Index)
+	{
+		const FVector Start(PrevX[Index], PrevY[Index], PrevZ[Index]);
+		const FVector End(PosX[Index], PosY[Index], PosZ[Index]);
+		const FCollisionQueryParams& Params = ShooterQueryParams[ShooterIds[Index]];
+
+		FInFlightTrace& InFlight = InFlightTraces.AddDefaulted_GetRef();
+		InFlight.Handle = World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, Channel, Params);
+		InFlight.Index = Index;
+	}
+}
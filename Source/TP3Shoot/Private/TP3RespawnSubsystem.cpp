@@ -0,0 +1,305 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3RespawnSubsystem.h"
+#include "AIController.h"
+#include "BrainComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerStart.h"
+#include "NavigationSystem.h"
+#include "TP3CombatantGridSubsystem.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Respawn point ranking"), STAT_TP3Respawn_Rank, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pending respawns"), STAT_TP3Respawn_Pending, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawn points"), STAT_TP3Respawn_Points, STATGROUP_TP3Shoot);
+
+// Where dead combatants used to be teleported, kept as a seed and as the fallback
+static const FVector LegacyRespawnLocation(1300, 1200, 90);
+
+void UTP3RespawnSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	BuildSpawnPoints(InWorld);
+}
+
+void UTP3RespawnSubsystem::Deinitialize()
+{
+	SpawnPoints.Reset();
+	Rankings.Reset();
+	PendingRespawns.Reset();
+	SET_DWORD_STAT(STAT_TP3Respawn_Pending, 0);
+	SET_DWORD_STAT(STAT_TP3Respawn_Points, 0);
+
+	Super::Deinitialize();
+}
+
+bool UTP3RespawnSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3RespawnSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3RespawnSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3RespawnSubsystem::BuildSpawnPoints(UWorld& World)
+{
+	SpawnPoints.Reset();
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(&World);
+	if (!NavSys)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("No navigation system, dead combatants will respawn at the default location"));
+		return;
+	}
+
+	auto TryAddPoint = [this, NavSys](const FVector& Candidate, const FVector& Extent)
+		{
+			FNavLocation NavLocation;
+			if (SpawnPoints.Num() < MaxSpawnPoints && NavSys->ProjectPointToNavigation(Candidate, NavLocation, Extent))
+			{
+				// Skip points almost on top of an existing one
+				for (const FVector& Existing : SpawnPoints)
+				{
+					if (FVector::DistSquared(Existing, NavLocation.Location) < FMath::Square(100.f))
+					{
+						return;
+					}
+				}
+				SpawnPoints.Add(NavLocation.Location);
+			}
+		};
+
+	// Rings of samples around the player starts and the legacy respawn location
+	TArray<FVector> Seeds;
+	Seeds.Add(LegacyRespawnLocation);
+	for (TActorIterator<APlayerStart> It(&World); It; ++It)
+	{
+		Seeds.Add(It->GetActorLocation());
+	}
+
+	const FVector SeedExtent(200.f, 200.f, 500.f);
+	for (const FVector& Seed : Seeds)
+	{
+		TryAddPoint(Seed, SeedExtent);
+		for (int32 Sample = 0; Sample < SamplesPerSeed; ++Sample)
+		{
+			const float Angle = 2.f * PI * Sample / FMath::Max(1, SamplesPerSeed);
+			TryAddPoint(Seed + FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * SeedRadius, SeedExtent);
+		}
+	}
+
+	// Coarse grid over the navigable bounds, spread out to fit in the point budget
+	const FBox Bounds = NavSys->GetNavigableWorldBounds();
+	if (GridSpacing > 0.f && Bounds.IsValid)
+	{
+		const FVector Size = Bounds.GetSize();
+		const int32 Budget = FMath::Max(1, MaxSpawnPoints - SpawnPoints.Num());
+		const float Spacing = FMath::Max(GridSpacing, FMath::Sqrt(Size.X * Size.Y / Budget));
+		const FVector GridExtent(Spacing * 0.5f, Spacing * 0.5f, Size.Z * 0.5f + 200.f);
+
+		for (float X = Bounds.Min.X + Spacing * 0.5f; X < Bounds.Max.X; X += Spacing)
+		{
+			for (float Y = Bounds.Min.Y + Spacing * 0.5f; Y < Bounds.Max.Y; Y += Spacing)
+			{
+				TryAddPoint(FVector(X, Y, Bounds.GetCenter().Z), GridExtent);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TP3Respawn_Points, SpawnPoints.Num());
+	UE_LOG(LogTemp, Log, TEXT("Respawn: %d spawn points on the navmesh"), SpawnPoints.Num());
+}
+
+void UTP3RespawnSubsystem::RankSpawnPoints()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Respawn_Rank);
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	const UTP3CombatantGridSubsystem* Grid = GetWorld()->GetSubsystem<UTP3CombatantGridSubsystem>();
+	if (!Registry || !Grid || SpawnPoints.Num() == 0)
+	{
+		return;
+	}
+
+	TArray<bool, TInlineAllocator<8>> TeamsInPlay;
+	for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+	{
+		if (Registry->IsValidCombatant(Id))
+		{
+			const uint8 Team = Registry->GetTeam(Id);
+			if (TeamsInPlay.Num() <= Team)
+			{
+				TeamsInPlay.SetNumZeroed(Team + 1);
+			}
+			TeamsInPlay[Team] = true;
+		}
+	}
+
+	Rankings.SetNum(TeamsInPlay.Num());
+
+	TArray<float> Scores;
+	TArray<AActor*> Nearest;
+	TArray<int32> Order;
+	for (int32 Team = 0; Team < TeamsInPlay.Num(); ++Team)
+	{
+		if (!TeamsInPlay[Team])
+		{
+			continue;
+		}
+
+		// Score is the distance to the closest enemy, points inside MinEnemyDistance go last
+		Scores.SetNumUninitialized(SpawnPoints.Num());
+		for (int32 Point = 0; Point < SpawnPoints.Num(); ++Point)
+		{
+			Nearest.Reset();
+			Grid->FindNearestEnemies(SpawnPoints[Point], Team, 1, MaxScoredDistance, Nearest);
+
+			const float Distance = Nearest.Num() > 0 ? FVector::Dist(Nearest[0]->GetActorLocation(), SpawnPoints[Point]) : MaxScoredDistance;
+			Scores[Point] = Distance < MinEnemyDistance ? Distance - MaxScoredDistance : Distance;
+		}
+
+		Order.Reset(SpawnPoints.Num());
+		for (int32 Point = 0; Point < SpawnPoints.Num(); ++Point)
+		{
+			Order.Add(Point);
+		}
+		Order.Sort([&Scores](int32 A, int32 B) { return Scores[A] > Scores[B]; });
+
+		FTeamRanking& Ranking = Rankings[Team];
+		Ranking.BestPoints.Reset();
+		Ranking.BestPoints.Append(Order.GetData(), FMath::Min(Order.Num(), FMath::Max(1, TopPointsPerTeam)));
+		Ranking.Cursor = 0;
+	}
+}
+
+FVector UTP3RespawnSubsystem::PickSpawnPoint(uint8 Team)
+{
+	if (Rankings.IsValidIndex(Team) && Rankings[Team].BestPoints.Num() > 0)
+	{
+		// Round-robin so a wave of deaths does not stack everybody on the best point
+		FTeamRanking& Ranking = Rankings[Team];
+		const int32 Point = Ranking.BestPoints[Ranking.Cursor];
+		Ranking.Cursor = (Ranking.Cursor + 1) % Ranking.BestPoints.Num();
+		return SpawnPoints[Point];
+	}
+
+	return SpawnPoints.Num() > 0 ? SpawnPoints[FMath::RandHelper(SpawnPoints.Num())] : LegacyRespawnLocation;
+}
+
+void UTP3RespawnSubsystem::SetCharacterActive(ACharacter* Character, bool bActive)
+{
+	Character->SetActorHiddenInGame(!bActive);
+	Character->SetActorEnableCollision(bActive);
+
+	UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	if (bActive)
+	{
+		Movement->SetMovementMode(MOVE_Walking);
+	}
+	else
+	{
+		Movement->StopMovementImmediately();
+		Movement->DisableMovement();
+	}
+
+	if (AAIController* AIController = Cast<AAIController>(Character->GetController()))
+	{
+		AIController->StopMovement();
+		if (UBrainComponent* Brain = AIController->GetBrainComponent())
+		{
+			if (bActive)
+			{
+				Brain->ResumeLogic(TEXT("Respawned"));
+			}
+			else
+			{
+				Brain->PauseLogic(TEXT("Dead"));
+			}
+		}
+	}
+}
+
+void UTP3RespawnSubsystem::QueueRespawn(ACharacter* Character, int32 CombatantId)
+{
+	if (!Character)
+	{
+		return;
+	}
+
+	SetCharacterActive(Character, false);
+
+	if (bSuspended)
+	{
+		return;
+	}
+
+	FPendingRespawn& Pending = PendingRespawns.AddDefaulted_GetRef();
+	Pending.Character = Character;
+	Pending.CombatantId = CombatantId;
+	Pending.RespawnTime = GetWorld()->GetTimeSeconds() + RespawnDelay;
+
+	INC_DWORD_STAT(STAT_TP3Respawn_Pending);
+}
+
+void UTP3RespawnSubsystem::RespawnAt(ACharacter* Character, int32 CombatantId, const FVector& Location)
+{
+	UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Character || !Registry || !Registry->IsValidCombatant(CombatantId))
+	{
+		return;
+	}
+
+	Character->SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+
+	SetCharacterActive(Character, true);
+	Registry->Revive(CombatantId);
+	TP3_COUNT_COMBAT_EVENT(Respawns);
+}
+
+void UTP3RespawnSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now >= NextRankTime)
+	{
+		NextRankTime = Now + ScoreInterval;
+		RankSpawnPoints();
+	}
+
+	int32 NumDue = 0;
+	while (NumDue < PendingRespawns.Num() && PendingRespawns[NumDue].RespawnTime <= Now)
+	{
+		++NumDue;
+	}
+	if (NumDue == 0)
+	{
+		return;
+	}
+
+	UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	for (int32 Index = 0; Index < NumDue; ++Index)
+	{
+		const FPendingRespawn& Pending = PendingRespawns[Index];
+		ACharacter* Character = Pending.Character.Get();
+		if (!Character || !Registry || !Registry->IsValidCombatant(Pending.CombatantId))
+		{
+			continue;
+		}
+
+		const float HalfHeight = Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		RespawnAt(Character, Pending.CombatantId, PickSpawnPoint(Registry->GetTeam(Pending.CombatantId)) + FVector(0.f, 0.f, HalfHeight));
+	}
+
+	PendingRespawns.RemoveAt(0, NumDue, EAllowShrinking::No);
+	DEC_DWORD_STAT_BY(STAT_TP3Respawn_Pending, NumDue);
+}
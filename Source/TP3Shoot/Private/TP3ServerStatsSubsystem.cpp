@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3ServerStatsSubsystem.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "Misc/App.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Server connected players"), STAT_TP3Server_Players, STATGROUP_TP3Shoot);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server busy ms"), STAT_TP3Server_BusyMs, STATGROUP_TP3Shoot);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Server ms per player"), STAT_TP3Server_MsPerPlayer, STATGROUP_TP3Shoot);
+
+CSV_DEFINE_CATEGORY(TP3Net, true);
+
+bool UTP3ServerStatsSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	return IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UTP3ServerStatsSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game;
+}
+
+TStatId UTP3ServerStatsSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3ServerStatsSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3ServerStatsSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 NumPlayers = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	// The server sleeps to honor NetServerMaxTickRate, the rest of the frame is work
+	const double BusyMs = FMath::Max(FApp::GetDeltaTime() - FApp::GetIdleTime(), 0.0) * 1000.0;
+	const double MsPerPlayer = NumPlayers > 0 ? BusyMs / NumPlayers : 0.0;
+
+	SET_DWORD_STAT(STAT_TP3Server_Players, NumPlayers);
+	SET_FLOAT_STAT(STAT_TP3Server_BusyMs, BusyMs);
+	SET_FLOAT_STAT(STAT_TP3Server_MsPerPlayer, MsPerPlayer);
+	CSV_CUSTOM_STAT(TP3Net, Players, NumPlayers, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TP3Net, BusyMs, BusyMs, ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(TP3Net, MsPerPlayer, MsPerPlayer, ECsvCustomStatOp::Set);
+
+	if (ReportInterval <= 0.f)
+	{
+		return;
+	}
+
+	BusyMsSum += BusyMs;
+	++NumFrames;
+	TimeSinceReport += DeltaTime;
+	if (TimeSinceReport >= ReportInterval)
+	{
+		const double AverageBusyMs = BusyMsSum / NumFrames;
+		UE_LOG(LogTemp, Display, TEXT("Server: %d players, %.1f fps, %.2f ms busy per frame, %.3f ms per player, %.1f KB/s out"),
+			NumPlayers,
+			NumFrames / TimeSinceReport,
+			AverageBusyMs,
+			NumPlayers > 0 ? AverageBusyMs / NumPlayers : 0.0,
+			NetDriver ? NetDriver->OutBytesPerSecond / 1024.f : 0.f);
+
+		BusyMsSum = 0.0;
+		NumFrames = 0;
+		TimeSinceReport = 0.f;
+	}
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3ShooterAnimInstance.h"
+#include "AI_Player.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3Shoot/TP3ShootCharacter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shooter anim game thread copy"), STAT_TP3Anim_PreUpdate, STATGROUP_TP3Shoot);
+DECLARE_CYCLE_STAT(TEXT("Shooter anim worker update"), STAT_TP3Anim_Update, STATGROUP_TP3Shoot);
+
+void FTP3ShooterAnimInstanceProxy::PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds)
+{
+	Super::PreUpdate(InAnimInstance, DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Anim_PreUpdate);
+
+	const ACharacter* Character = Cast<ACharacter>(InAnimInstance->TryGetPawnOwner());
+	if (!Character)
+	{
+		return;
+	}
+
+	Velocity = Character->GetVelocity();
+	ActorRotation = Character->GetActorRotation();
+	AimRotation = Character->GetBaseAimRotation();
+	bIsInAir = Character->GetCharacterMovement() && Character->GetCharacterMovement()->IsFalling();
+
+	if (const AAI_Player* Bot = Cast<AAI_Player>(Character))
+	{
+		bIsAiming = Bot->IsAiming;
+		bIsFiring = Bot->IsFiring;
+	}
+	else if (const ATP3ShootCharacter* Player = Cast<ATP3ShootCharacter>(Character))
+	{
+		bIsAiming = Player->IsAiming;
+		bIsFiring = Player->IsFiring;
+	}
+}
+
+void FTP3ShooterAnimInstanceProxy::Update(float DeltaSeconds)
+{
+	Super::Update(DeltaSeconds);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Anim_Update);
+
+	Speed = Velocity.Size2D();
+	Direction = Speed > KINDA_SMALL_NUMBER ? (Velocity.Rotation() - ActorRotation).GetNormalized().Yaw : 0.f;
+
+	const FRotator AimDelta = (AimRotation - ActorRotation).GetNormalized();
+	AimPitch = AimDelta.Pitch;
+	AimYaw = AimDelta.Yaw;
+}
@@ -0,0 +1,329 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3SignificanceSubsystem.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "BrainComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/WidgetComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "SignificanceManager.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Significance update"), STAT_TP3Significance_Update, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots in bucket 0"), STAT_TP3Significance_Bucket0, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots in bucket 1"), STAT_TP3Significance_Bucket1, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots in bucket 2"), STAT_TP3Significance_Bucket2, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots in bucket 3+"), STAT_TP3Significance_Bucket3, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bots nav walking"), STAT_TP3Significance_NavWalking, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<bool> CVarSignificanceEnabled(
+	TEXT("tp3.Significance.Enabled"),
+	true,
+	TEXT("Bots are bucketed by significance. Off keeps every bot in the first bucket at full rate, to measure the saving."));
+
+static TAutoConsoleVariable<bool> CVarSignificanceNavWalking(
+	TEXT("tp3.Significance.NavWalking"),
+	true,
+	TEXT("Bots of the nav walking buckets move in MOVE_NavWalking. Off keeps every bot in MOVE_Walking, to compare the movement cost."));
+
+static const FName BotSignificanceTag(TEXT("TP3Bot"));
+
+UTP3SignificanceSubsystem::UTP3SignificanceSubsystem()
+{
+	// Defaults when DefaultGame.ini has no buckets
+	Buckets.SetNum(4);
+	Buckets[0].MaxDistance = 2500.f;
+
+	Buckets[1].MaxDistance = 6000.f;
+	Buckets[1].BrainTickInterval = 0.1f;
+	Buckets[1].WidgetTickInterval = 0.1f;
+	Buckets[1].AnimFramesToSkip = 1;
+
+	Buckets[2].MaxDistance = 12000.f;
+	Buckets[2].ActorTickInterval = 0.1f;
+	Buckets[2].MovementTickInterval = 0.05f;
+	Buckets[2].BrainTickInterval = 0.25f;
+	Buckets[2].WidgetTickInterval = 0.5f;
+	Buckets[2].AnimFramesToSkip = 3;
+	Buckets[2].bNavWalking = true;
+
+	Buckets[3].MaxDistance = UE_BIG_NUMBER;
+	Buckets[3].ActorTickInterval = 0.25f;
+	Buckets[3].MovementTickInterval = 0.1f;
+	Buckets[3].BrainTickInterval = 0.5f;
+	Buckets[3].WidgetTickInterval = 1.f;
+	Buckets[3].AnimFramesToSkip = 6;
+	Buckets[3].bNavWalking = true;
+}
+
+void UTP3SignificanceSubsystem::Deinitialize()
+{
+	if (USignificanceManager* Manager = USignificanceManager::Get(GetWorld()))
+	{
+		Manager->UnregisterAll(BotSignificanceTag);
+	}
+
+	BotBuckets.Reset();
+	PromotedUntil.Reset();
+	Views.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3SignificanceSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3SignificanceSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3SignificanceSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3SignificanceSubsystem::RegisterBot(AAI_Player* Bot)
+{
+	USignificanceManager* Manager = USignificanceManager::Get(GetWorld());
+	if (!Bot || !Manager || Buckets.Num() == 0 || BotBuckets.Contains(Bot))
+	{
+		return;
+	}
+
+	// The frame skips of the buckets go through the LOD map of the update rate optimizations
+	if (USkeletalMeshComponent* Mesh = Bot->GetMesh())
+	{
+		Mesh->bEnableUpdateRateOptimizations = true;
+	}
+
+	// Nav walking bots are put back on the ground by a trace every NavMeshProjectionInterval instead of a sweep per move
+	if (UCharacterMovementComponent* Movement = Bot->GetCharacterMovement())
+	{
+		Movement->bProjectNavMeshWalking = true;
+	}
+
+	BotBuckets.Add(Bot, 0);
+	ApplyBucket(*Bot, 0);
+
+	// Higher is more significant, so the best bucket over all the views wins
+	auto Significance = [this](USignificanceManager::FManagedObjectInfo* Info, const FTransform& View) -> float
+		{
+			const AAI_Player* Bot = Cast<AAI_Player>(Info->GetObject());
+			return Bot ? float(Buckets.Num() - 1 - ComputeBucket(*Bot, View)) : 0.f;
+		};
+
+	auto PostSignificance = [this](USignificanceManager::FManagedObjectInfo* Info, float OldSignificance, float NewSignificance, bool bFinal)
+		{
+			AAI_Player* Bot = Cast<AAI_Player>(Info->GetObject());
+			int32* AppliedBucket = Bot ? BotBuckets.Find(Bot) : nullptr;
+			const int32 Bucket = bFinal ? 0 : FMath::Clamp(Buckets.Num() - 1 - FMath::RoundToInt(NewSignificance), 0, Buckets.Num() - 1);
+			if (AppliedBucket && *AppliedBucket != Bucket)
+			{
+				*AppliedBucket = Bucket;
+				ApplyBucket(*Bot, Bucket);
+			}
+		};
+
+	Manager->RegisterObject(Bot, BotSignificanceTag, Significance, USignificanceManager::EPostSignificanceType::Sequential, PostSignificance);
+}
+
+void UTP3SignificanceSubsystem::UnregisterBot(AAI_Player* Bot)
+{
+	if (BotBuckets.Remove(Bot) == 0)
+	{
+		return;
+	}
+
+	PromotedUntil.Remove(Bot);
+	if (USignificanceManager* Manager = USignificanceManager::Get(GetWorld()))
+	{
+		Manager->UnregisterObject(Bot);
+	}
+}
+
+void UTP3SignificanceSubsystem::PromoteToFullRate(AAI_Player* Bot)
+{
+	int32* AppliedBucket = BotBuckets.Find(Bot);
+	if (!AppliedBucket)
+	{
+		return;
+	}
+
+	PromotedUntil.Add(Bot, GetWorld()->GetTimeSeconds() + PromotionDuration);
+	if (*AppliedBucket != 0)
+	{
+		*AppliedBucket = 0;
+		ApplyBucket(*Bot, 0);
+	}
+}
+
+int32 UTP3SignificanceSubsystem::GetBucket(const AActor* Bot) const
+{
+	const AAI_Player* AIBot = Cast<AAI_Player>(Bot);
+	const int32* AppliedBucket = AIBot ? BotBuckets.Find(AIBot) : nullptr;
+	return AppliedBucket ? *AppliedBucket : 0;
+}
+
+int32 UTP3SignificanceSubsystem::ComputeBucket(const AAI_Player& Bot, const FTransform& View) const
+{
+	if (!CVarSignificanceEnabled.GetValueOnAnyThread())
+	{
+		return 0;
+	}
+
+	// Runs on worker threads during the significance update, PromotedUntil is only written on the game thread
+	if (const double* Until = PromotedUntil.Find(&Bot))
+	{
+		if (*Until > GetWorld()->GetTimeSeconds())
+		{
+			return 0;
+		}
+	}
+
+	const FVector ToBot = Bot.GetActorLocation() - View.GetLocation();
+	const float Distance = ToBot.Size();
+
+	int32 Bucket = Buckets.Num() - 1;
+	for (int32 Index = 0; Index < Buckets.Num(); ++Index)
+	{
+		if (Distance < Buckets[Index].MaxDistance)
+		{
+			Bucket = Index;
+			break;
+		}
+	}
+
+	// Bots out of the view cone and not rendered lately drop one bucket
+	const bool bInView = FVector::DotProduct(ToBot.GetSafeNormal(), View.GetRotation().GetForwardVector()) > 0.5f;
+	if (Bucket > 0 && !bInView && !Bot.WasRecentlyRendered(0.25f))
+	{
+		Bucket = FMath::Min(Bucket + 1, Buckets.Num() - 1);
+	}
+
+	return Bucket;
+}
+
+void UTP3SignificanceSubsystem::ApplyBucket(AAI_Player& Bot, int32 Bucket) const
+{
+	const FTP3SignificanceBucket& Settings = Buckets[Bucket];
+
+	Bot.SetActorTickInterval(Settings.ActorTickInterval);
+
+	if (UCharacterMovementComponent* Movement = Bot.GetCharacterMovement())
+	{
+		Movement->SetComponentTickInterval(Settings.MovementTickInterval);
+	}
+	ApplyMovementMode(Bot, Settings);
+
+	if (Bot.HealthBarComponent)
+	{
+		Bot.HealthBarComponent->SetComponentTickInterval(Settings.WidgetTickInterval);
+	}
+
+	if (USkeletalMeshComponent* Mesh = Bot.GetMesh())
+	{
+		if (FAnimUpdateRateParameters* Params = Mesh->AnimUpdateRateParams)
+		{
+			Params->bShouldUseLodMap = true;
+			Params->LODToFrameSkipMap.Reset();
+			for (int32 LOD = 0; LOD < FMath::Max(1, Mesh->GetNumLODs()); ++LOD)
+			{
+				Params->LODToFrameSkipMap.Add(LOD, Settings.AnimFramesToSkip);
+			}
+		}
+	}
+
+	if (AAIController* Controller = Cast<AAIController>(Bot.GetController()))
+	{
+		Controller->SetActorTickInterval(Settings.ActorTickInterval);
+		if (UBrainComponent* Brain = Controller->GetBrainComponent())
+		{
+			Brain->SetComponentTickInterval(Settings.BrainTickInterval);
+		}
+	}
+}
+
+void UTP3SignificanceSubsystem::ApplyMovementMode(AAI_Player& Bot, const FTP3SignificanceBucket& Settings) const
+{
+	UCharacterMovementComponent* Movement = Bot.GetCharacterMovement();
+	if (!Movement)
+	{
+		return;
+	}
+
+	// Falling, launched or root motion bots keep their mode, they come back through MOVE_Walking when they land
+	const bool bWantsNavWalking = Settings.bNavWalking && CVarSignificanceNavWalking.GetValueOnGameThread();
+	if (bWantsNavWalking && Movement->MovementMode == MOVE_Walking && !Movement->HasAnimRootMotion())
+	{
+		Movement->SetMovementMode(MOVE_NavWalking);
+	}
+	else if (!bWantsNavWalking && Movement->MovementMode == MOVE_NavWalking)
+	{
+		Movement->SetMovementMode(MOVE_Walking);
+	}
+}
+
+void UTP3SignificanceSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Significance_Update);
+
+	USignificanceManager* Manager = USignificanceManager::Get(GetWorld());
+	if (!Manager || BotBuckets.Num() == 0)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	for (auto It = PromotedUntil.CreateIterator(); It; ++It)
+	{
+		if (It.Value() <= Now)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	Views.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController && PlayerController->IsLocalController())
+		{
+			FVector ViewLocation;
+			FRotator ViewRotation;
+			PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+			Views.Emplace(ViewRotation, ViewLocation);
+		}
+	}
+
+	// No local view (dedicated server), every bot keeps its bucket
+	if (Views.Num() > 0)
+	{
+		Manager->Update(Views);
+	}
+
+	int32 BucketCounts[4] = {};
+	int32 NumNavWalking = 0;
+	for (const TPair<TObjectKey<AAI_Player>, int32>& Pair : BotBuckets)
+	{
+		++BucketCounts[FMath::Min(Pair.Value, 3)];
+
+		// Landed bots of the nav walking buckets switch back, the others may have been knocked out of nav walking
+		const FTP3SignificanceBucket& Settings = Buckets[Pair.Value];
+		if (AAI_Player* Bot = Pair.Key.ResolveObjectPtr())
+		{
+			ApplyMovementMode(*Bot, Settings);
+			NumNavWalking += Bot->GetCharacterMovement() && Bot->GetCharacterMovement()->MovementMode == MOVE_NavWalking;
+		}
+	}
+
+	SET_DWORD_STAT(STAT_TP3Significance_Bucket0, BucketCounts[0]);
+	SET_DWORD_STAT(STAT_TP3Significance_Bucket1, BucketCounts[1]);
+	SET_DWORD_STAT(STAT_TP3Significance_Bucket2, BucketCounts[2]);
+	SET_DWORD_STAT(STAT_TP3Significance_Bucket3, BucketCounts[3]);
+	SET_DWORD_STAT(STAT_TP3Significance_NavWalking, NumNavWalking);
+}
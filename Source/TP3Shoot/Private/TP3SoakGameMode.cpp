@@ -0,0 +1,266 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3SoakGameMode.h"
+#include "AI_Player.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3HitscanSubsystem.h"
+#include "TP3RespawnSubsystem.h"
+
+ATP3SoakGameMode::ATP3SoakGameMode()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// Nobody plays, the local player only spectates
+	bStartPlayersAsSpectators = true;
+
+	AllyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Allie.BPAI_Allie_C")));
+	EnemyBotClass = TSoftClassPtr<AAI_Player>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BPAI_Ennemie.BPAI_Ennemie_C")));
+}
+
+void ATP3SoakGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	FParse::Value(CommandLine, TEXT("SoakBots="), BotsPerTeam);
+	FParse::Value(CommandLine, TEXT("SoakKillLimit="), KillLimit);
+	FParse::Value(CommandLine, TEXT("SoakSeconds="), MaxMatchSeconds);
+	FParse::Value(CommandLine, TEXT("SoakFps="), FixedFrameRate);
+	FParse::Value(CommandLine, TEXT("SoakSeed="), RandomSeed);
+	if (!FParse::Value(CommandLine, TEXT("BenchmarkLabel="), Label))
+	{
+		Label = TEXT("local");
+	}
+	if (!FParse::Value(CommandLine, TEXT("SoakOutput="), OutputFilename))
+	{
+		OutputFilename = FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("%s_%d.json"), *Label, RandomSeed);
+	}
+
+	// Same random streams for the same seed
+	FMath::RandInit(RandomSeed);
+	FMath::SRandInit(RandomSeed);
+
+	// Fixed simulation step, and no frame rate cap so each frame starts as soon as the last one is done
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / FMath::Max(FixedFrameRate, 1.f));
+	if (GEngine)
+	{
+		GEngine->bUseFixedFrameRate = false;
+		GEngine->SetMaxFPS(0.f);
+	}
+
+	if (FApp::CanEverRender())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Soak: the match is rendered, add -nullrhi to run it headless"));
+	}
+}
+
+void ATP3SoakGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	if (BotsPerTeam > 0)
+	{
+		SpawnBots();
+	}
+
+	UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Registry)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Soak: no combatant registry, nothing to play"));
+		return;
+	}
+
+	for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+	{
+		if (Registry->IsValidCombatant(Id))
+		{
+			Teams.FindOrAdd(Registry->GetTeam(Id));
+		}
+	}
+	KilledHandle = Registry->OnCombatantKilled.AddUObject(this, &ATP3SoakGameMode::OnCombatantKilled);
+
+	StartWallTime = FPlatformTime::Seconds();
+	UE_LOG(LogTemp, Display, TEXT("Soak: seed %d, %d teams, first to %d kills or %.0fs at %.0f fps"), RandomSeed, Teams.Num(), KillLimit, MaxMatchSeconds, FixedFrameRate);
+}
+
+void ATP3SoakGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>())
+	{
+		Registry->OnCombatantKilled.Remove(KilledHandle);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ATP3SoakGameMode::SpawnBots()
+{
+	UWorld* World = GetWorld();
+
+	// Only the soak bots, so both teams are the same size
+	for (TActorIterator<AAI_Player> It(World); It; ++It)
+	{
+		It->Destroy();
+	}
+
+	UClass* AllyClass = AllyBotClass.LoadSynchronous();
+	UClass* EnemyClass = EnemyBotClass.LoadSynchronous();
+	if (!AllyClass || !EnemyClass)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Soak: cannot load the bot classes"));
+		return;
+	}
+
+	UTP3RespawnSubsystem* Respawn = World->GetSubsystem<UTP3RespawnSubsystem>();
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+	for (int32 Index = 0; Index < BotsPerTeam * 2; ++Index)
+	{
+		UClass* BotClass = Index % 2 == 0 ? AllyClass : EnemyClass;
+		const uint8 Team = UTP3CombatantRegistry::ToTeamId(BotClass->GetDefaultObject<AAI_Player>()->Team);
+		const FVector Location = Respawn ? Respawn->PickSpawnPoint(Team) : FVector(0.f, 0.f, 100.f * Index);
+		AAI_Player* Bot = World->SpawnActor<AAI_Player>(BotClass, Location + FVector(0.f, 0.f, 100.f), FRotator::ZeroRotator, SpawnParams);
+		if (Bot && !Bot->GetController())
+		{
+			Bot->SpawnDefaultController();
+		}
+	}
+}
+
+void ATP3SoakGameMode::OnCombatantKilled(int32 CombatantId)
+{
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	const uint8 VictimTeam = Registry->GetTeam(CombatantId);
+
+	// The registry does not know the killer, with two teams it can only be the other one
+	for (TPair<uint8, FTeamStats>& Pair : Teams)
+	{
+		if (Pair.Key == VictimTeam)
+		{
+			++Pair.Value.Deaths;
+		}
+		else
+		{
+			++Pair.Value.Kills;
+		}
+	}
+}
+
+void ATP3SoakGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (bFinished || Teams.Num() == 0)
+	{
+		return;
+	}
+
+	SimulatedSeconds += DeltaSeconds;
+	++NumFrames;
+
+	if (const uint8 Winner = FindWinner(false))
+	{
+		FinishMatch(Winner, TEXT("kill_limit"));
+	}
+	else if (SimulatedSeconds >= MaxMatchSeconds)
+	{
+		FinishMatch(FindWinner(true), TEXT("time_limit"));
+	}
+}
+
+uint8 ATP3SoakGameMode::FindWinner(bool bTimeUp) const
+{
+	uint8 Winner = 0;
+	int32 BestKills = bTimeUp ? 0 : KillLimit - 1;
+	bool bTied = false;
+	for (const TPair<uint8, FTeamStats>& Pair : Teams)
+	{
+		if (Pair.Value.Kills > BestKills)
+		{
+			Winner = Pair.Key;
+			BestKills = Pair.Value.Kills;
+			bTied = false;
+		}
+		else if (Pair.Value.Kills == BestKills && Winner != 0)
+		{
+			bTied = true;
+		}
+	}
+	return bTied ? 0 : Winner;
+}
+
+void ATP3SoakGameMode::FinishMatch(uint8 Winner, const TCHAR* Reason)
+{
+	bFinished = true;
+
+	UE_LOG(LogTemp, Display, TEXT("Soak: %s after %.1fs, winner team %d"), Reason, SimulatedSeconds, Winner);
+	WriteResults(Winner, Reason);
+	FPlatformMisc::RequestExit(false, TEXT("TP3Soak"));
+}
+
+void ATP3SoakGameMode::WriteResults(uint8 Winner, const TCHAR* Reason) const
+{
+	const double WallSeconds = FPlatformTime::Seconds() - StartWallTime;
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	const UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>();
+
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetStringField(TEXT("label"), Label);
+	Root->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Root->SetNumberField(TEXT("seed"), RandomSeed);
+	Root->SetNumberField(TEXT("bots_per_team"), BotsPerTeam);
+	Root->SetNumberField(TEXT("kill_limit"), KillLimit);
+	Root->SetNumberField(TEXT("fixed_fps"), FixedFrameRate);
+	Root->SetStringField(TEXT("end_reason"), Reason);
+	Root->SetNumberField(TEXT("winner"), Winner);
+	Root->SetNumberField(TEXT("sim_seconds"), SimulatedSeconds);
+	Root->SetNumberField(TEXT("wall_seconds"), WallSeconds);
+	Root->SetNumberField(TEXT("speedup"), WallSeconds > 0.0 ? SimulatedSeconds / WallSeconds : 0.0);
+	Root->SetNumberField(TEXT("frames"), NumFrames);
+	Root->SetNumberField(TEXT("traces"), Hitscan ? Hitscan->GetNumTraces() : 0);
+
+	TArray<TSharedPtr<FJsonValue>> TeamValues;
+	for (const TPair<uint8, FTeamStats>& Pair : Teams)
+	{
+		int32 Alive = 0;
+		for (int32 Id = 0; Registry && Id < Registry->GetNumSlots(); ++Id)
+		{
+			Alive += Registry->IsValidCombatant(Id) && Registry->GetTeam(Id) == Pair.Key && Registry->IsAlive(Id);
+		}
+
+		TSharedRef<FJsonObject> TeamObject = MakeShared<FJsonObject>();
+		TeamObject->SetNumberField(TEXT("team"), Pair.Key);
+		TeamObject->SetNumberField(TEXT("kills"), Pair.Value.Kills);
+		TeamObject->SetNumberField(TEXT("deaths"), Pair.Value.Deaths);
+		TeamObject->SetNumberField(TEXT("alive_at_end"), Alive);
+		TeamValues.Add(MakeShared<FJsonValueObject>(TeamObject));
+	}
+	Root->SetArrayField(TEXT("teams"), TeamValues);
+
+	FString Text;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Text);
+	FJsonSerializer::Serialize(Root, Writer);
+
+	if (FFileHelper::SaveStringToFile(Text, *OutputFilename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogTemp, Display, TEXT("Soak: results written to %s"), *OutputFilename);
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("Soak: cannot write %s"), *OutputFilename);
+	}
+}
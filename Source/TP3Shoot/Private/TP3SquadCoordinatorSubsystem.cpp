@@ -0,0 +1,190 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3SquadCoordinatorSubsystem.h"
+#include "AIController.h"
+#include "AI_Player.h"
+#include "Async/ParallelFor.h"
+#include "BehaviorTree/BlackboardData.h"
+#include "BehaviorTree/Blackboard/BlackboardKeyType_Object.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Squad target assignment"), STAT_TP3Squad_Solve, STATGROUP_TP3Shoot);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Squad targets assigned"), STAT_TP3Squad_Assigned, STATGROUP_TP3Shoot);
+
+static TAutoConsoleVariable<bool> CVarSquadCoordinator(
+	TEXT("tp3.Squad.Coordinator"),
+	true,
+	TEXT("Assign the targets of the bots per team at a fixed interval."));
+
+bool UTP3SquadCoordinatorSubsystem::IsEnabled()
+{
+	return CVarSquadCoordinator.GetValueOnGameThread();
+}
+
+void UTP3SquadCoordinatorSubsystem::Deinitialize()
+{
+	Bots.Reset();
+	Candidates.Reset();
+	KeyIds.Reset();
+
+	Super::Deinitialize();
+}
+
+bool UTP3SquadCoordinatorSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3SquadCoordinatorSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3SquadCoordinatorSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3SquadCoordinatorSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	// The bots only think on the server
+	if (!IsEnabled() || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const double Now = GetWorld()->GetTimeSeconds();
+	if (Now < NextSolveTime)
+	{
+		return;
+	}
+	NextSolveTime = Now + Interval;
+
+	Solve();
+}
+
+void UTP3SquadCoordinatorSubsystem::GatherBots()
+{
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+
+	Bots.Reset();
+	for (int32 Id = 0; Id < Registry->GetNumSlots(); ++Id)
+	{
+		if (!Registry->IsValidCombatant(Id) || !Registry->IsAlive(Id))
+		{
+			continue;
+		}
+
+		const AAI_Player* Bot = Cast<AAI_Player>(Registry->GetActor(Id));
+		const AAIController* Controller = Bot ? Cast<AAIController>(Bot->GetController()) : nullptr;
+		UBlackboardComponent* Blackboard = Controller ? Controller->GetBlackboardComponent() : nullptr;
+		const UBlackboardData* BlackboardAsset = Blackboard ? Blackboard->GetBlackboardAsset() : nullptr;
+		if (!BlackboardAsset)
+		{
+			continue;
+		}
+
+		FBlackboard::FKey* KeyId = KeyIds.Find(BlackboardAsset);
+		if (!KeyId)
+		{
+			KeyId = &KeyIds.Add(BlackboardAsset, BlackboardAsset->GetKeyID(TargetKeyName));
+		}
+		if (*KeyId == FBlackboard::InvalidKey)
+		{
+			continue;
+		}
+
+		const int32 CurrentTarget = Registry->FindCombatant(Cast<AActor>(Blackboard->GetValue<UBlackboardKeyType_Object>(*KeyId)));
+		Bots.Add({ Id, Blackboard, *KeyId, CurrentTarget });
+	}
+}
+
+void UTP3SquadCoordinatorSubsystem::Solve()
+{
+	SCOPE_CYCLE_COUNTER(STAT_TP3Squad_Solve);
+
+	const UTP3CombatantRegistry* Registry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (!Registry)
+	{
+		return;
+	}
+
+	GatherBots();
+	if (Bots.Num() == 0)
+	{
+		return;
+	}
+
+	// Score the nearest enemies of each bot in parallel, the registry is only read
+	const int32 NumCandidates = FMath::Max(1, CandidatesPerBot);
+	Candidates.SetNumUninitialized(Bots.Num() * NumCandidates);
+	ParallelFor(Bots.Num(), [this, Registry, NumCandidates](int32 BotIndex)
+		{
+			const FBot& Bot = Bots[BotIndex];
+			const FVector Origin = Registry->GetLocation(Bot.CombatantId);
+
+			TArray<int32> Enemies;
+			Registry->GatherEnemiesInRange(Registry->GetTeam(Bot.CombatantId), Origin, MaxRange, Enemies);
+
+			FCandidate* Best = &Candidates[BotIndex * NumCandidates];
+			for (int32 Slot = 0; Slot < NumCandidates; ++Slot)
+			{
+				Best[Slot] = { MAX_flt, BotIndex, INDEX_NONE };
+			}
+
+			// Keeps the NumCandidates lowest scores, insertion sorted
+			for (const int32 EnemyId : Enemies)
+			{
+				float Score = FVector::Dist(Origin, Registry->GetLocation(EnemyId));
+				Score *= EnemyId == Bot.CurrentTarget ? CurrentTargetBonus : 1.f;
+
+				int32 Slot = NumCandidates - 1;
+				if (Score >= Best[Slot].Score)
+				{
+					continue;
+				}
+				while (Slot > 0 && Best[Slot - 1].Score > Score)
+				{
+					Best[Slot] = Best[Slot - 1];
+					--Slot;
+				}
+				Best[Slot] = { Score, BotIndex, EnemyId };
+			}
+		});
+
+	// Greedy: best pairs first, each enemy takes at most MaxAttackersPerTarget bots
+	Candidates.RemoveAll([](const FCandidate& Candidate) { return Candidate.TargetId == INDEX_NONE; });
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) { return A.Score < B.Score; });
+
+	Assignments.Init(INDEX_NONE, Bots.Num());
+	AttackersPerTarget.Init(0, Registry->GetNumSlots());
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (Assignments[Candidate.BotIndex] == INDEX_NONE && AttackersPerTarget[Candidate.TargetId] < MaxAttackersPerTarget)
+		{
+			Assignments[Candidate.BotIndex] = Candidate.TargetId;
+			++AttackersPerTarget[Candidate.TargetId];
+		}
+	}
+
+	// Bots whose candidates are all taken still go for their best one
+	for (const FCandidate& Candidate : Candidates)
+	{
+		if (Assignments[Candidate.BotIndex] == INDEX_NONE)
+		{
+			Assignments[Candidate.BotIndex] = Candidate.TargetId;
+		}
+	}
+
+	for (int32 BotIndex = 0; BotIndex < Bots.Num(); ++BotIndex)
+	{
+		const FBot& Bot = Bots[BotIndex];
+		const int32 TargetId = Assignments[BotIndex];
+		if (TargetId != Bot.CurrentTarget)
+		{
+			Bot.Blackboard->SetValue<UBlackboardKeyType_Object>(Bot.KeyId, TargetId != INDEX_NONE ? Registry->GetActor(TargetId) : nullptr);
+			INC_DWORD_STAT(STAT_TP3Squad_Assigned);
+		}
+	}
+}
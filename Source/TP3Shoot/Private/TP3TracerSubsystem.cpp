@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TP3TracerSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Materials/MaterialInterface.h"
+#include "TP3Shoot/TP3Shoot.h"
+
+DECLARE_CYCLE_STAT(TEXT("Tracer update"), STAT_TP3Tracer_Update, STATGROUP_TP3Shoot);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Live tracers"), STAT_TP3Tracer_Live, STATGROUP_TP3Shoot);
+
+void UTP3TracerSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+#if !TP3_WITH_DEBUG_TRACERS
+	if (InWorld.GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	UStaticMesh* Mesh = Cast<UStaticMesh>(TracerMesh.TryLoad());
+	if (!Mesh)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Tracer mesh %s could not be loaded, tracers are disabled"), *TracerMesh.ToString());
+		return;
+	}
+
+	UMaterialInterface* Material = Cast<UMaterialInterface>(TracerMaterial.TryLoad());
+	Tracers.SetNum(FMath::Max(1, MaxTracers));
+	TracerComponents.Add(CreateTracerComponent(InWorld, Mesh, Material, 0));
+	TracerComponents.Add(CreateTracerComponent(InWorld, Mesh, Material, 1));
+#else
+	Tracers.SetNum(FMath::Max(1, MaxTracers));
+#endif
+}
+
+UInstancedStaticMeshComponent* UTP3TracerSubsystem::CreateTracerComponent(UWorld& InWorld, UStaticMesh* Mesh, UMaterialInterface* Material, uint8 Team)
+{
+	AWorldSettings* WorldSettings = InWorld.GetWorldSettings();
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(WorldSettings ? (UObject*)WorldSettings : (UObject*)&InWorld);
+	Component->SetStaticMesh(Mesh);
+	if (Material)
+	{
+		// One material instance per team instead of per-instance data, the default material has no custom data input
+		UMaterialInstanceDynamic* TeamMaterial = UMaterialInstanceDynamic::Create(Material, Component);
+		TeamMaterial->SetVectorParameterValue(TracerColorParameter, FLinearColor(GetTeamColor(Team)));
+		Component->SetMaterial(0, TeamMaterial);
+	}
+	Component->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	Component->SetCastShadow(false);
+	Component->SetMobility(EComponentMobility::Movable);
+	Component->RegisterComponentWithWorld(&InWorld);
+
+	// Every slot of the ring gets its instance up front, hidden with a zero scale until used
+	TArray<FTransform> Hidden;
+	Hidden.Init(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), Tracers.Num());
+	Component->AddInstances(Hidden, false, true);
+	return Component;
+}
+
+void UTP3TracerSubsystem::Deinitialize()
+{
+	for (UInstancedStaticMeshComponent* Component : TracerComponents)
+	{
+		Component->DestroyComponent();
+	}
+	TracerComponents.Reset();
+	Tracers.Reset();
+	SET_DWORD_STAT(STAT_TP3Tracer_Live, 0);
+
+	Super::Deinitialize();
+}
+
+bool UTP3TracerSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Cosmetic only, a dedicated server never draws the shots
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+bool UTP3TracerSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+TStatId UTP3TracerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UTP3TracerSubsystem, STATGROUP_Tickables);
+}
+
+void UTP3TracerSubsystem::AddTracer(const FVector& Start, const FVector& End, uint8 Team)
+{
+#if TP3_WITH_DEBUG_TRACERS
+	DrawDebugLine(GetWorld(), Start, End, GetTeamColor(Team), false, TracerLifetime, 5, TracerThickness);
+#else
+	if (TracerComponents.Num() == 0)
+	{
+		return;
+	}
+
+	const int32 Slot = NextSlot;
+	NextSlot = (NextSlot + 1) % Tracers.Num();
+
+	FTracer& Tracer = Tracers[Slot];
+	if (!Tracer.bLive)
+	{
+		Tracer.bLive = true;
+		++NumLive;
+	}
+	else if (Tracer.TeamIndex != GetTeamIndex(Team))
+	{
+		// The replaced tracer is drawn by the other component
+		HideInstance(Tracer, Slot);
+	}
+	Tracer.TeamIndex = GetTeamIndex(Team);
+	Tracer.ExpireTime = GetWorld()->GetTimeSeconds() + TracerLifetime;
+
+	// Stretch the unit mesh from Start to End
+	const FVector Segment = End - Start;
+	const float Length = Segment.Size();
+	const float Width = TracerThickness / 100.f;
+	const FTransform Transform(
+		FRotationMatrix::MakeFromZ(Segment.GetSafeNormal()).ToQuat(),
+		Start + Segment * 0.5f,
+		FVector(Width, Width, Length / 100.f));
+
+	TracerComponents[Tracer.TeamIndex]->UpdateInstanceTransform(Slot, Transform, true, false, true);
+	bRenderStateDirty = true;
+#endif
+}
+
+void UTP3TracerSubsystem::HideInstance(const FTracer& Tracer, int32 Slot)
+{
+	const FTransform Hidden(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector);
+	TracerComponents[Tracer.TeamIndex]->UpdateInstanceTransform(Slot, Hidden, true, false, true);
+	bRenderStateDirty = true;
+}
+
+void UTP3TracerSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SCOPE_CYCLE_COUNTER(STAT_TP3Tracer_Update);
+
+	if (TracerComponents.Num() == 0)
+	{
+		return;
+	}
+
+	if (NumLive > 0)
+	{
+		const double Now = GetWorld()->GetTimeSeconds();
+
+		for (int32 Slot = 0; Slot < Tracers.Num(); ++Slot)
+		{
+			FTracer& Tracer = Tracers[Slot];
+			if (Tracer.bLive && Tracer.ExpireTime <= Now)
+			{
+				Tracer.bLive = false;
+				--NumLive;
+				HideInstance(Tracer, Slot);
+			}
+		}
+	}
+
+	// One render state update per frame for all the tracers added or expired
+	if (bRenderStateDirty)
+	{
+		for (UInstancedStaticMeshComponent* Component : TracerComponents)
+		{
+			Component->MarkRenderStateDirty();
+		}
+		bRenderStateDirty = false;
+	}
+
+	SET_DWORD_STAT(STAT_TP3Tracer_Live, NumLive);
+}
@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "CollisionQueryParams.h"
+#include "GenericTeamAgentInterface.h"
 #include "AI_Player.generated.h"
 
+struct FTP3HitscanShot;
+
 UCLASS(config = Game)
-class TP3SHOOT_API AAI_Player : public ACharacter
+class TP3SHOOT_API AAI_Player : public ACharacter, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
@@ -21,16 +25,17 @@ class TP3SHOOT_API AAI_Player : public ACharacter
 
 
 public:
-	AAI_Player();
+	AAI_Player(const FObjectInitializer& ObjectInitializer);
 
 	/** Base turn rate, in deg/sec. Other scaling may affect final turn rate. */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Input)
 	float TurnRateGamepad;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Stats")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Replicated, Category = "Stats")
 	float Team;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Stats")
+	// Starting life, then mirrors the combatant registry for Blueprints
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, ReplicatedUsing = OnRep_Life, Category = "Stats")
 	float Life;
 
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "UI")
@@ -43,17 +48,36 @@ protected:
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
 	class USkeletalMeshComponent* SK_Gun;
 
-	// Particle Start
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UParticleSystem* ParticleStart;
+	// Particle Start, loaded with the Effects bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Effects"))
+	TSoftObjectPtr<class UParticleSystem> ParticleStart;
+
+	// Particle Impact, loaded with the Effects bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Effects"))
+	TSoftObjectPtr<class UParticleSystem> ParticleImpact;
+
+	// Mesh of SK_Gun, set once the Weapon bundle is loaded
+	UPROPERTY(EditAnywhere, Category = Mesh, meta = (AssetBundles = "Weapon"))
+	TSoftObjectPtr<class USkeletalMesh> GunMesh;
+
+	// Pool playing ParticleStart and ParticleImpact
+	UPROPERTY(Transient)
+	class UTP3EffectPoolSubsystem* EffectPool;
+
+	// Renders the shot tracers
+	UPROPERTY(Transient)
+	class UTP3TracerSubsystem* Tracers;
+
+	// Fire animation, loaded with the Weapon bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Weapon"))
+	TSoftObjectPtr<class UAnimMontage> FireAnimation;
+
+	// Weapon and effect assets requested at BeginPlay, already in memory when the preload list has them
+	TSharedPtr<struct FStreamableHandle> GameplayAssetsHandle;
 
-	// Particle Impact
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UParticleSystem* ParticleImpact;
+	void LoadGameplayAssets();
 
-	// Fire animation
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UAnimMontage* FireAnimation;
+	void OnGameplayAssetsLoaded();
 
 	// Timer for Boost Speed
 	FTimerHandle BoostSpeedTimer;
@@ -89,10 +113,6 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void StopAiming();
 
-	// Firing function
-	UFUNCTION(BlueprintCallable, Category = "Actions")
-	void Fire();
-
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void BoostSpeed();
 
@@ -102,12 +122,48 @@ protected:
 	UFUNCTION(BlueprintCallable, Category = "Actions")
 	void FireParticle(FVector Start, FVector Impact);
 
+	// Called by the hitscan subsystem once the shot queued by Fire has been traced
+	void OnFireResolved(const FTP3HitscanShot& Shot, const FHitResult* Hit);
+
+	// Query params shared by every shot, built at BeginPlay
+	FCollisionQueryParams FireQueryParams;
+
+	// Id of this character in the combatant registry, valid between BeginPlay and EndPlay
+	int32 CombatantId = INDEX_NONE;
+
+	UPROPERTY(Transient)
+	class UTP3CombatantRegistry* CombatantRegistry;
+
+	// Records the shots while a match recording runs
+	UPROPERTY(Transient)
+	class UTP3MatchRecorderSubsystem* Recorder;
+
+	// Called by the combatant registry when this character took damage
+	void OnLifeChanged(int32 Id, bool bKilled);
+
+	// Clients mirror the life of the server in their registry
+	UFUNCTION()
+	void OnRep_Life();
+
+	// Tracer and impact of a shot resolved on the server, cosmetic only
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastShotEffects(FVector_NetQuantize Start, FVector_NetQuantize End, bool bHit);
+
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Blueprints of this class are primary assets so the asset manager can preload them with their bundles
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
 
+	// IGenericTeamAgentInterface, Team as a generic team id for the perception affiliation filters
+	virtual FGenericTeamId GetGenericTeamId() const override;
 
 public:
 	/** Returns CameraBoom subobject **/
@@ -115,6 +171,12 @@ public:
 	/** Returns FollowCamera subobject **/
 	FORCEINLINE class UCameraComponent* GetFollowCamera() const { return FollowCamera; }
 
+	int32 GetCombatantId() const { return CombatantId; }
+
+	// Firing function, also called by the native BT tasks. Server only, bots have no owning client.
+	UFUNCTION(BlueprintCallable, Category = "Actions")
+	void Fire();
+
 	void DecreaseHealth(float Amount);
 
 	void UpdateHealthBar();
@@ -122,11 +184,11 @@ public:
 public:
 
 	// Is Aiming
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Aiming")
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Replicated, Category = "Aiming")
 	bool IsAiming;
 
 	// Is Firing
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Firing")
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Replicated, Category = "Firing")
 	bool IsFiring;
 
 };
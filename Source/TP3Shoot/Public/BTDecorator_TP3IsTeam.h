@@ -0,0 +1,28 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTDecorator.h"
+#include "BTDecorator_TP3IsTeam.generated.h"
+
+/**
+ * Native replacement of BTTask_IsTeam1: passes if the controlled combatant is in Team,
+ * read from the combatant registry.
+ */
+UCLASS()
+class TP3SHOOT_API UBTDecorator_TP3IsTeam : public UBTDecorator
+{
+	GENERATED_BODY()
+
+public:
+	UBTDecorator_TP3IsTeam();
+
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual bool CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const override;
+
+	UPROPERTY(EditAnywhere, Category = Condition, meta = (ClampMin = "0", ClampMax = "254"))
+	int32 Team;
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTDecorator.h"
+#include "BTDecorator_TP3LifeBelow.generated.h"
+
+/**
+ * Native replacement of BTTask_HalfLife: passes while the life of the controlled combatant
+ * is below LifeRatio of its max life, read from the combatant registry.
+ */
+UCLASS()
+class TP3SHOOT_API UBTDecorator_TP3LifeBelow : public UBTDecorator
+{
+	GENERATED_BODY()
+
+public:
+	UBTDecorator_TP3LifeBelow();
+
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual bool CalculateRawConditionValue(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) const override;
+
+	// 0.5 is the Life < 50 test of the Blueprint task
+	UPROPERTY(EditAnywhere, Category = Condition, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float LifeRatio;
+};
@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTService.h"
+#include "BTService_TP3LineOfSight.generated.h"
+
+/**
+ * Writes the nearest enemy within MaxRange and whether the controlled combatant can see it to the blackboard,
+ * from the cached line of sight of UTP3LineOfSightSubsystem instead of a trace per evaluation.
+ * With bUseAssignedTarget, or while UTP3SquadCoordinatorSubsystem is enabled, the target is the one written by the
+ * coordinator and only its visibility is written, so the two never fight over the key.
+ */
+UCLASS()
+class TP3SHOOT_API UBTService_TP3LineOfSight : public UBTService
+{
+	GENERATED_BODY()
+
+public:
+	UBTService_TP3LineOfSight();
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual void TickNode(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	// Receives the nearest enemy, cleared when there is none
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector TargetActorKey;
+
+	// Receives true while the target is visible
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector CanSeeTargetKey;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "0.0"))
+	float MaxRange;
+
+	// Reads TargetActorKey instead of searching the nearest enemy, even with the squad coordinator off
+	UPROPERTY(EditAnywhere, Category = Node)
+	bool bUseAssignedTarget;
+};
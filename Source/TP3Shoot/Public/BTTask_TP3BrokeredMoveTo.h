@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AITypes.h"
+#include "BehaviorTree/Tasks/BTTask_BlackboardBase.h"
+#include "NavigationData.h"
+#include "BTTask_TP3BrokeredMoveTo.generated.h"
+
+struct FBTTP3BrokeredMoveToMemory
+{
+	int32 PathRequestId = INDEX_NONE;
+	FAIRequestID MoveRequestId;
+	bool bMoving = false;
+};
+
+/**
+ * Move To whose path comes from UTP3PathBrokerSubsystem instead of a synchronous path search,
+ * so a wave of bots getting new goals in the same frame is spread over the next frames.
+ */
+UCLASS()
+class TP3SHOOT_API UBTTask_TP3BrokeredMoveTo : public UBTTask_BlackboardBase
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_TP3BrokeredMoveTo();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+	virtual void CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "0.0"))
+	float AcceptableRadius;
+
+	void OnPathReady(FNavPathSharedPtr Path, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp);
+
+	// Goal read from BlackboardKey, a location or the location of an actor
+	bool GetGoal(const UBehaviorTreeComponent& OwnerComp, FVector& OutGoal) const;
+};
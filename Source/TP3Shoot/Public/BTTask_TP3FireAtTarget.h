@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BTTask_TP3TargetBase.h"
+#include "BTTask_TP3FireAtTarget.generated.h"
+
+struct FBTTP3FireAtTargetMemory
+{
+	TWeakObjectPtr<AActor> Target;
+	int32 ShotsLeft = 0;
+	float TimeToNextShot = 0.f;
+};
+
+/**
+ * Native replacement of BTTask_CanShoot and BTTask_CanShootAllie.
+ * Fails when no enemy is within MaxRange, otherwise turns to it and fires a burst of random length
+ * with random delays between the shots, then succeeds.
+ * With bRequireLineOfSight it also fails while the cached line of sight to the target is not clear.
+ */
+UCLASS()
+class TP3SHOOT_API UBTTask_TP3FireAtTarget : public UBTTask_TP3TargetBase
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_TP3FireAtTarget();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+	virtual void CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	virtual void TickTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, float DeltaSeconds) override;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "1"))
+	int32 MinShots;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "1"))
+	int32 MaxShots;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "0.0"))
+	float MinShotInterval;
+
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "0.0"))
+	float MaxShotInterval;
+
+	// Read from UTP3LineOfSightSubsystem, no trace of its own
+	UPROPERTY(EditAnywhere, Category = Node)
+	bool bRequireLineOfSight;
+};
@@ -0,0 +1,23 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BTTask_TP3TargetBase.h"
+#include "BTTask_TP3RotateToTarget.generated.h"
+
+/**
+ * Native replacement of BTTask_Rotate and BTTask_RotateAllie.
+ * Turns the pawn to the nearest enemy within MaxRange and focuses it, fails if there is none.
+ */
+UCLASS()
+class TP3SHOOT_API UBTTask_TP3RotateToTarget : public UBTTask_TP3TargetBase
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_TP3RotateToTarget();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual FString GetStaticDescription() const override;
+};
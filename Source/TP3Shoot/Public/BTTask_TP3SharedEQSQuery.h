@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/Tasks/BTTask_BlackboardBase.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "BTTask_TP3SharedEQSQuery.generated.h"
+
+class UEnvQuery;
+
+struct FBTTP3SharedEQSQueryMemory
+{
+	int32 RequestId = INDEX_NONE;
+};
+
+/**
+ * Runs QueryTemplate through UTP3EQSSchedulerSubsystem, so teammates close to each other share one query,
+ * and writes a location or actor of the result to BlackboardKey.
+ * Drop-in for the Run EQS Query tasks of EQS_GoToEnnemies and EQS_Exploration.
+ */
+UCLASS()
+class TP3SHOOT_API UBTTask_TP3SharedEQSQuery : public UBTTask_BlackboardBase
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_TP3SharedEQSQuery();
+
+	virtual EBTNodeResult::Type ExecuteTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual EBTNodeResult::Type AbortTask(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory) override;
+	virtual uint16 GetInstanceMemorySize() const override;
+	virtual void InitializeMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryInit::Type InitType) const override;
+	virtual void CleanupMemory(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTMemoryClear::Type CleanupType) const override;
+	virtual FString GetStaticDescription() const override;
+
+protected:
+	UPROPERTY(EditAnywhere, Category = Node)
+	TObjectPtr<UEnvQuery> QueryTemplate;
+
+	// With several items, each querier picks one at random among the best quarter so teammates spread out
+	UPROPERTY(EditAnywhere, Category = Node)
+	TEnumAsByte<EEnvQueryRunMode::Type> RunMode;
+
+	void OnQueryFinished(TSharedPtr<FEnvQueryResult> Result, TWeakObjectPtr<UBehaviorTreeComponent> WeakOwnerComp);
+
+	// Returns false when the result has no item
+	bool WriteResult(UBehaviorTreeComponent& OwnerComp, const FEnvQueryResult& Result) const;
+};
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BTTaskNode.h"
+#include "BTTask_TP3TargetBase.generated.h"
+
+class AAI_Player;
+
+/**
+ * Shared target selection of the native combat tasks: the actor in TargetActorKey if set,
+ * otherwise the nearest enemy of the controlled AAI_Player from the combatant grid.
+ */
+UCLASS(Abstract)
+class TP3SHOOT_API UBTTask_TP3TargetBase : public UBTTaskNode
+{
+	GENERATED_BODY()
+
+public:
+	UBTTask_TP3TargetBase();
+
+	virtual void InitializeFromAsset(UBehaviorTree& Asset) override;
+
+	// Clears the focus set by FaceTarget, whether the task succeeded, failed or was aborted
+	virtual void OnTaskFinished(UBehaviorTreeComponent& OwnerComp, uint8* NodeMemory, EBTNodeResult::Type TaskResult) override;
+
+protected:
+	// Optional actor to aim at, the nearest enemy is used when the key is not set or empty
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector TargetActorKey;
+
+	// Receives the location of the target
+	UPROPERTY(EditAnywhere, Category = Blackboard)
+	FBlackboardKeySelector TargetLocationKey;
+
+	// Targets further than this are ignored
+	UPROPERTY(EditAnywhere, Category = Node, meta = (ClampMin = "0.0"))
+	float MaxRange;
+
+	// Controlled AAI_Player and its target within MaxRange, null if there is none
+	AActor* FindTarget(UBehaviorTreeComponent& OwnerComp, AAI_Player*& OutPawn) const;
+
+	// Turns the pawn and its control rotation towards the target, focuses it until the task ends, and writes TargetLocationKey
+	void FaceTarget(UBehaviorTreeComponent& OwnerComp, AAI_Player& Pawn, const AActor& Target) const;
+};
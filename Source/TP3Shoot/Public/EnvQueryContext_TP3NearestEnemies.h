@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryContext.h"
+#include "EnvQueryContext_TP3NearestEnemies.generated.h"
+
+/** The few enemies closest to the querier, from the combatant grid */
+UCLASS(meta = (DisplayName = "TP3 Nearest Enemies"))
+class TP3SHOOT_API UEnvQueryContext_TP3NearestEnemies : public UEnvQueryContext
+{
+	GENERATED_BODY()
+
+public:
+	virtual void ProvideContext(FEnvQueryInstance& QueryInstance, FEnvQueryContextData& ContextData) const override;
+
+protected:
+	UPROPERTY(EditDefaultsOnly, Category = Context)
+	int32 MaxEnemies = 3;
+
+	UPROPERTY(EditDefaultsOnly, Category = Context)
+	float SearchRadius = 5000.f;
+};
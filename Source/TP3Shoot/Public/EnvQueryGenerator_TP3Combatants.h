@@ -0,0 +1,43 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DataProviders/AIDataProvider.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "EnvQueryGenerator_TP3Combatants.generated.h"
+
+/**
+ * Generates the enemies (or allies) of the querier from the combatant grid,
+ * instead of iterating every actor of the level and filtering by team.
+ */
+UCLASS(meta = (DisplayName = "TP3 Combatants"))
+class TP3SHOOT_API UEnvQueryGenerator_TP3Combatants : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+public:
+	UEnvQueryGenerator_TP3Combatants();
+
+	virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+
+protected:
+	// Max distance from the search center
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	FAIDataProviderFloatValue SearchRadius;
+
+	// Keep only the N nearest combatants, 0 keeps all of them
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	FAIDataProviderIntValue MaxResults;
+
+	// Generate the enemies of the querier, or its allies
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	bool bEnemies;
+
+	// Context to search around
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	TSubclassOf<UEnvQueryContext> SearchCenter;
+};
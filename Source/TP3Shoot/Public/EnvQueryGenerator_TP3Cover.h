@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DataProviders/AIDataProvider.h"
+#include "EnvironmentQuery/EnvQueryGenerator.h"
+#include "EnvQueryGenerator_TP3Cover.generated.h"
+
+/**
+ * Generates the baked cover points of UTP3CoverSubsystem around a context,
+ * replacing the runtime point grid and trace tests of EQS_Cover.
+ */
+UCLASS(meta = (DisplayName = "TP3 Baked Cover"))
+class TP3SHOOT_API UEnvQueryGenerator_TP3Cover : public UEnvQueryGenerator
+{
+	GENERATED_BODY()
+
+public:
+	UEnvQueryGenerator_TP3Cover();
+
+	virtual void GenerateItems(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+
+protected:
+	// Max distance from the search center
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	FAIDataProviderFloatValue SearchRadius;
+
+	// Context to search around
+	UPROPERTY(EditDefaultsOnly, Category = Generator)
+	TSubclassOf<UEnvQueryContext> SearchCenter;
+};
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTest.h"
+#include "EnvQueryTest_TP3CoverExposure.generated.h"
+
+/**
+ * Exposure of baked cover points to the threat context, from 0 (covered) to 1 (in the open),
+ * read from the per-direction exposure of UTP3CoverData instead of tracing.
+ * The worst threat counts. Items that are not baked cover points are fully exposed.
+ */
+UCLASS(meta = (DisplayName = "TP3 Cover Exposure"))
+class TP3SHOOT_API UEnvQueryTest_TP3CoverExposure : public UEnvQueryTest
+{
+	GENERATED_BODY()
+
+public:
+	UEnvQueryTest_TP3CoverExposure();
+
+	virtual void RunTest(FEnvQueryInstance& QueryInstance) const override;
+
+	virtual FText GetDescriptionTitle() const override;
+	virtual FText GetDescriptionDetails() const override;
+
+protected:
+	// Where the shots would come from
+	UPROPERTY(EditDefaultsOnly, Category = Exposure)
+	TSubclassOf<UEnvQueryContext> Threat;
+};
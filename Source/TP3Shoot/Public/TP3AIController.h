@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "TP3AIController.generated.h"
+
+class UBehaviorTree;
+
+/**
+ * Native base of EnnemyController and AllieController.
+ * Takes the team of the possessed combatant as its generic team id, so the affiliation filters of the
+ * perception senses drop the stimuli of allies before any test, and runs BehaviorTree if one is set.
+ * Its brain is a UTP3BehaviorTreeComponent, which RunBehaviorTree reuses, so the benchmark can time the trees.
+ */
+UCLASS()
+class TP3SHOOT_API ATP3AIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	ATP3AIController();
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+
+	// Optional, the blueprint controllers can keep running their tree themselves
+	UPROPERTY(EditDefaultsOnly, Category = AI)
+	TObjectPtr<UBehaviorTree> BehaviorTree;
+};
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "UObject/PrimaryAssetId.h"
+#include "TP3AssetPreloadSubsystem.generated.h"
+
+struct FStreamableHandle;
+
+/** One primary asset of the preload list and the bundles of soft references to load with it */
+USTRUCT()
+struct FTP3PreloadEntry
+{
+	GENERATED_BODY()
+
+	// AI_Player:BPAI_Player, TP3ShootCharacter:BP_ThirdPersonCharacter...
+	UPROPERTY(Config)
+	FPrimaryAssetId AssetId;
+
+	// Weapon, Effects...
+	UPROPERTY(Config)
+	TArray<FName> Bundles;
+
+	// Higher first, also the priority of the streaming requests
+	UPROPERTY(Config)
+	int32 Priority = 0;
+};
+
+/**
+ * Loads the primary assets of PreloadList in the background through the Asset Manager, highest priority first,
+ * then the bundles of soft references tagged on their class defaults (meta = (AssetBundles = "Weapon")).
+ * Logs the time from process start to the first gameplay frame and to the end of the preload, with the peak memory,
+ * and appends them to Saved/Benchmark/TP3Startup.csv. -TP3ExitAfterStartup quits once both are known.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3AssetPreloadSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UGameInstanceSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	// End of UGameInstanceSubsystem interface
+
+	// Called by the game mode when the match starts, only the first call is measured
+	void NotifyGameplayStarted();
+
+	bool IsPreloadComplete() const { return NumPending == 0; }
+
+	// Broadcast once every entry of PreloadList and its bundles are loaded
+	FSimpleMulticastDelegate OnPreloadComplete;
+
+	// Id of a blueprint class default object: native class name as type, blueprint name as name
+	static FPrimaryAssetId GetBlueprintPrimaryAssetId(const UObject* Object, FName AssetType);
+
+protected:
+	UPROPERTY(Config)
+	TArray<FTP3PreloadEntry> PreloadList;
+
+private:
+	void OnPrimaryAssetLoaded(int32 EntryIndex);
+
+	void OnEntryDone();
+
+	void ReportStartup();
+
+	// Kept alive so the preloaded assets stay in memory for the whole session
+	TArray<TSharedPtr<FStreamableHandle>> Handles;
+
+	int32 NumPending = 0;
+
+	double PreloadDoneSeconds = -1.0;
+	double GameplaySeconds = -1.0;
+	bool bReported = false;
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TP3BakeCoverCommandlet.generated.h"
+
+class UTP3CoverData;
+
+/**
+ * Bakes the cover points of maps into UTP3CoverData assets next to the other AI data.
+ * UnrealEditor-Cmd TP3Shoot.uproject -run=TP3BakeCover [-Maps=/Game/DMap+/Game/ThirdPerson/Maps/ThirdPersonMap] [-Spacing=150]
+ */
+UCLASS()
+class TP3SHOOT_API UTP3BakeCoverCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTP3BakeCoverCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	// Samples the navmesh of World and fills Data->Points with the samples next to a wall, using the bake settings of Data
+	static void BakeWorld(UWorld& World, UTP3CoverData& Data);
+};
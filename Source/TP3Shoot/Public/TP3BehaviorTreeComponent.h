@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BehaviorTreeComponent.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3BehaviorTreeComponent.generated.h"
+
+/**
+ * Behavior tree component of ATP3AIController, times its ticks while bTimeTicks is set
+ * so the benchmark can report the game thread cost of the trees.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3BehaviorTreeComponent : public UBehaviorTreeComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Set by the benchmark, off in normal play
+	static bool bTimeTicks;
+
+	// Sum over every behavior tree component
+	static FTP3TickTimes TickTimes;
+};
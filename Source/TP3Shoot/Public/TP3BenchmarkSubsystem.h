@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3BenchmarkSubsystem.generated.h"
+
+class AAI_Player;
+
+/**
+ * Headless bot battle benchmark, only created with -TP3Benchmark=<bots> on the command line:
+ * UnrealEditor-Cmd TP3Shoot.uproject /Game/DMap -game -nullrhi -benchmark -fps=30 -deterministic -TP3Benchmark=100
+ * Replaces the bots of the map with N bots split between the two teams, runs BenchmarkSeconds of simulated time
+ * after a warm up, appends one row to Saved/Benchmark/TP3Benchmark_<columns hash>.csv and quits.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3BenchmarkSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UTP3BenchmarkSubsystem();
+
+	// UTickableWorldSubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+protected:
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> AllyBotClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> EnemyBotClass;
+
+	// Simulated seconds before the measures start, -BenchmarkWarmup=
+	UPROPERTY(Config)
+	float WarmupSeconds = 5.f;
+
+	// Simulated seconds measured, -BenchmarkSeconds=
+	UPROPERTY(Config)
+	float BenchmarkSeconds = 60.f;
+
+	// Seed of the random streams, -BenchmarkSeed=
+	UPROPERTY(Config)
+	int32 RandomSeed = 1234;
+
+private:
+	struct FBenchmarkBot
+	{
+		TWeakObjectPtr<AAI_Player> Bot;
+	};
+
+	void SpawnBots();
+
+	void WriteResults() const;
+
+	void OnPreGarbageCollect();
+
+	void OnPostGarbageCollect();
+
+	TArray<FBenchmarkBot> Bots;
+
+	int32 NumBots = 0;
+
+	FString Label;
+
+	bool bSpawned = false;
+	bool bFinished = false;
+
+	double SimulatedTime = 0.0;
+	double LastFrameWallTime = 0.0;
+	double GCStartTime = 0.0;
+
+	// Measures, reset at the end of the warm up
+	TArray<float> FrameMs;
+	// Cost of the movement ticks of the bots by movement mode, timed by UTP3BotMovementComponent
+	FTP3TickTimes WalkingTimes;
+	FTP3TickTimes NavWalkingTimes;
+	FTP3TickTimes OtherMovementTimes;
+	int64 NumBrainTicks = 0;
+	// Cost of the behavior tree ticks of the bots with a ATP3AIController
+	FTP3TickTimes BrainTimes;
+	int64 TracesAtStart = 0;
+	int64 TracesAtEnd = 0;
+	int32 NumGCs = 0;
+	double GCMsTotal = 0.0;
+	double GCMsMax = 0.0;
+
+	FDelegateHandle PreGCHandle;
+	FDelegateHandle PostGCHandle;
+};
@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "TP3BotMovementComponent.generated.h"
+
+/**
+ * Character movement of AAI_Player, times its ticks by movement mode while bTimeTicks is set
+ * so the benchmark can compare MOVE_Walking and MOVE_NavWalking without taking over the tick.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3BotMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+public:
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Set by the benchmark, off in normal play
+	static bool bTimeTicks;
+
+	// Sums over every bot, by the movement mode at the start of the tick
+	static FTP3TickTimes WalkingTimes;
+	static FTP3TickTimes NavWalkingTimes;
+	static FTP3TickTimes OtherTimes;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TP3CombatantGridSubsystem.generated.h"
+
+/**
+ * Uniform 2D grid of the combatants of the world, with one partition per team.
+ * Combatants are added by UTP3CombatantRegistry and are moved between cells only when they cross a cell border,
+ * so enemy searches only visit the cells around the querier instead of every pawn of the level.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3CombatantGridSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	void Register(AActor* Combatant, int32 Team);
+
+	void Unregister(AActor* Combatant);
+
+	// Returns INDEX_NONE if the actor is not registered
+	int32 GetTeam(const AActor* Combatant) const;
+
+	// Every combatant of another team than Team within Radius of Origin, unsorted
+	void FindEnemiesInRadius(const FVector& Origin, float Radius, int32 Team, TArray<AActor*>& OutEnemies) const;
+
+	// Every combatant of Team within Radius of Origin, unsorted
+	void FindAlliesInRadius(const FVector& Origin, float Radius, int32 Team, TArray<AActor*>& OutAllies) const;
+
+	// Closest enemy of Team within MaxRadius of Origin, without allocating
+	AActor* FindNearestEnemy(const FVector& Origin, int32 Team, float MaxRadius) const;
+
+	// Up to Count enemies of Team closest to Origin and within MaxRadius, sorted by distance
+	void FindNearestEnemies(const FVector& Origin, int32 Team, int32 Count, float MaxRadius, TArray<AActor*>& OutEnemies) const;
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+	struct FEntry
+	{
+		TWeakObjectPtr<AActor> Actor;
+		FVector Location = FVector::ZeroVector;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		int32 Team = INDEX_NONE;
+	};
+
+	struct FTeamPartition
+	{
+		int32 Team = INDEX_NONE;
+		TMap<FIntPoint, TArray<int32, TInlineAllocator<8>>> Cells;
+		int32 NumEntries = 0;
+	};
+
+	struct FCandidate
+	{
+		int32 EntryIndex;
+		double DistSq;
+	};
+
+	FIntPoint GetCell(const FVector& Location) const;
+
+	FTeamPartition& FindOrAddPartition(int32 Team);
+
+	void AddToCell(int32 EntryIndex);
+
+	void RemoveFromCell(int32 EntryIndex);
+
+	void GatherInRadius(const FVector& Origin, float Radius, int32 Team, bool bEnemies, TArray<AActor*>& OutActors) const;
+
+	float CellSize = 2000.f;
+
+	TArray<FEntry> Entries;
+
+	TArray<int32> FreeEntries;
+
+	TMap<TObjectKey<AActor>, int32> EntryByActor;
+
+	// A handful of teams, searched linearly
+	TArray<FTeamPartition> Partitions;
+};
@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TP3CombatantRegistry.generated.h"
+
+class UTP3MatchRecorderSubsystem;
+
+/** Called on the damaged combatant after its life changed. bKilled is true when the hit took its last life point. */
+DECLARE_DELEGATE_TwoParams(FTP3OnCombatantLifeChanged, int32 /*CombatantId*/, bool /*bKilled*/);
+
+/** Broadcast for every combatant that took its last life point, after the combatant itself was notified */
+DECLARE_MULTICAST_DELEGATE_OneParam(FTP3OnCombatantKilled, int32 /*CombatantId*/);
+
+/** One "alive enemies of Team within Range of Origin" request for the bulk passes */
+struct FTP3RangeQuery
+{
+	FVector Origin = FVector::ZeroVector;
+	float Range = 0.f;
+	uint8 Team = 0;
+};
+
+/**
+ * Structure-of-arrays storage of the combat state of every AAI_Player and ATP3ShootCharacter:
+ * team, life, alive flag and position, indexed by a compact combatant id.
+ * Friend-or-foe and damage go through it instead of casting the hit actor to each character class.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3CombatantRegistry : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Designer facing teams are floats (1.0, 2.0), the registry stores them as bytes
+	static uint8 ToTeamId(float Team) { return (uint8)FMath::Clamp(FMath::RoundToInt(Team), 0, 254); }
+
+	// Returns the new combatant id, also registers the actor in the combatant grid
+	int32 Register(AActor* Combatant, float Team, float MaxLife, FTP3OnCombatantLifeChanged&& OnLifeChanged);
+
+	void Unregister(int32 CombatantId);
+
+	// Returns INDEX_NONE if the actor is not a registered combatant
+	int32 FindCombatant(const AActor* Actor) const;
+
+	bool IsValidCombatant(int32 CombatantId) const { return Actors.IsValidIndex(CombatantId) && TeamIds[CombatantId] != InvalidTeam; }
+
+	bool AreEnemies(int32 A, int32 B) const { return TeamIds[A] != TeamIds[B]; }
+
+	uint8 GetTeam(int32 CombatantId) const { return TeamIds[CombatantId]; }
+	float GetLife(int32 CombatantId) const { return Lives[CombatantId]; }
+	float GetMaxLife(int32 CombatantId) const { return MaxLives[CombatantId]; }
+	float GetLifeRatio(int32 CombatantId) const { return MaxLives[CombatantId] > 0.f ? Lives[CombatantId] / MaxLives[CombatantId] : 0.f; }
+	bool IsAlive(int32 CombatantId) const { return AliveFlags[CombatantId] != 0; }
+	FVector GetLocation(int32 CombatantId) const { return FVector(PosX[CombatantId], PosY[CombatantId], PosZ[CombatantId]); }
+	AActor* GetActor(int32 CombatantId) const { return Actors[CombatantId].Get(); }
+
+	// Removes Amount life points and notifies the combatant. Returns true if it died from this hit.
+	bool ApplyDamage(int32 CombatantId, float Amount);
+
+	// Damages Target if it is a combatant of another team than Attacker. Returns true if the damage was applied.
+	bool TryDamageEnemy(int32 AttackerId, const AActor* Target, float Amount);
+
+	// Back to full life and alive, notifies the combatant
+	void Revive(int32 CombatantId);
+
+	// Sets the life of an alive combatant without counting a hit, to carry the state of another representation
+	void SetLife(int32 CombatantId, float NewLife);
+
+	// Clients only: mirrors the life replicated by the server, which alone applies damage and respawns
+	void ApplyReplicatedLife(int32 CombatantId, float NewLife);
+
+	// Alive enemies of Team within Range of Origin
+	void GatherEnemiesInRange(uint8 Team, const FVector& Origin, float Range, TArray<int32>& OutIds) const;
+
+	// Runs many GatherEnemiesInRange on the task graph, one result array per query
+	void GatherEnemiesInRangeParallel(TConstArrayView<FTP3RangeQuery> Queries, TArray<TArray<int32>>& OutIds) const;
+
+	int32 GetNumSlots() const { return Actors.Num(); }
+
+	// Spawns, despawns, damage and respawns go to the recorder while it is set
+	void SetRecorder(UTP3MatchRecorderSubsystem* InRecorder) { Recorder = InRecorder; }
+
+	// Server only, like the damage
+	FTP3OnCombatantKilled OnCombatantKilled;
+
+private:
+	static constexpr uint8 InvalidTeam = 0xFF;
+
+	// Hot data, one entry per slot. Free slots have InvalidTeam and are never alive.
+	TArray<uint8> TeamIds;
+	TArray<uint8> AliveFlags;
+	TArray<float> Lives;
+	TArray<float> MaxLives;
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+
+	// Cold data
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	TArray<FTP3OnCombatantLifeChanged> LifeChangedDelegates;
+
+	TArray<int32> FreeIds;
+
+	TMap<TObjectKey<AActor>, int32> IdByActor;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTP3MatchRecorderSubsystem> Recorder;
+};
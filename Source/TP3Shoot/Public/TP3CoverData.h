@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "TP3CoverData.generated.h"
+
+/** One baked cover point, exposures are 0 when a wall is right there and 255 when the direction is open */
+USTRUCT()
+struct FTP3CoverPoint
+{
+	GENERATED_BODY()
+
+	static constexpr int32 NumDirections = 8;
+
+	UPROPERTY()
+	FVector3f Location = FVector3f::ZeroVector;
+
+	// Index of the direction of the closest wall
+	UPROPERTY()
+	uint8 Facing = 0;
+
+	// Free distance in each direction, in 1/255 of the bake ExposureDistance
+	UPROPERTY()
+	uint8 Exposure[NumDirections] = {};
+
+	// Horizontal unit vector of the direction Index, direction 0 is +X and they turn counter clockwise
+	static FVector GetDirection(int32 Index);
+
+	// Exposure from 0 to 1 towards a threat in ToThreat, interpolated between the two closest directions
+	float GetExposure(const FVector& ToThreat) const;
+};
+
+/**
+ * Cover points of one map, baked offline from the navmesh and the level geometry by UTP3BakeCoverCommandlet.
+ * Loaded by UTP3CoverSubsystem so the EQS cover queries never trace at runtime.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3CoverData : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, Category = Cover)
+	TArray<FTP3CoverPoint> Points;
+
+	// Distance of the navmesh samples
+	UPROPERTY(EditAnywhere, Category = Bake)
+	float SampleSpacing = 150.f;
+
+	// A wall closer than this in one direction makes the sample a cover point
+	UPROPERTY(EditAnywhere, Category = Bake)
+	float ProbeDistance = 120.f;
+
+	// Height above the navmesh of the cover and exposure traces, about a crouched character
+	UPROPERTY(EditAnywhere, Category = Bake)
+	float TraceHeight = 70.f;
+
+	// Free distance counted as fully exposed
+	UPROPERTY(EditAnywhere, Category = Bake)
+	float ExposureDistance = 3000.f;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3CoverData.h"
+#include "TP3CoverSubsystem.generated.h"
+
+/**
+ * Loads the baked UTP3CoverData of the current map and buckets its points in a 2D grid,
+ * so cover queries are a few cell lookups with no traces.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3CoverSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UWorldSubsystem interface
+
+	// Package of the cover data of a map, <CoverDataDirectory>/<MapName>_Cover
+	static FString GetCoverDataPackageName(const FString& CoverDataDirectory, const FString& MapPackageName);
+
+	bool HasCoverData() const { return CoverData != nullptr; }
+
+	// Indices of the cover points within Radius of Origin, unsorted
+	void GatherCoverPoints(const FVector& Origin, float Radius, TArray<int32>& OutIndices) const;
+
+	// Index of the cover point at Location (within Tolerance), INDEX_NONE if there is none
+	int32 FindCoverPointAt(const FVector& Location, float Tolerance = 1.f) const;
+
+	const FTP3CoverPoint& GetCoverPoint(int32 Index) const { return CoverData->Points[Index]; }
+
+	FVector GetCoverLocation(int32 Index) const { return FVector(CoverData->Points[Index].Location); }
+
+	// Exposure from 0 (covered) to 1 (open) of the cover point Index to a threat at ThreatLocation
+	float GetExposure(int32 Index, const FVector& ThreatLocation) const;
+
+	UPROPERTY(Config)
+	FString CoverDataDirectory = TEXT("/Game/AI/Cover");
+
+protected:
+	UPROPERTY(Config)
+	float CellSize = 1000.f;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UTP3CoverData> CoverData;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+};
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EnvironmentQuery/EnvQueryTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TP3EQSSchedulerSubsystem.generated.h"
+
+class UEnvQuery;
+
+/** Called with the shared result of a scheduled query, null when it was aborted */
+DECLARE_DELEGATE_OneParam(FTP3OnSharedQueryFinished, TSharedPtr<FEnvQueryResult> /*Result*/);
+
+/**
+ * Runs the EQS queries of the bots once per query template, team and grid cell of the querier.
+ * A result younger than ResultTimeToLive is served to every teammate asking from the same cell, and requests for a
+ * query already waiting or running join it. Waiting queries are started at most MaxQueriesPerFrame per frame,
+ * most significant querier first (see UTP3SignificanceSubsystem).
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3EQSSchedulerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	/**
+	 * Returns the cached result if there is a fresh one, OnFinished is then never called.
+	 * Otherwise returns null and OnFinished is called later, OutRequestId cancels it.
+	 */
+	TSharedPtr<FEnvQueryResult> RequestQuery(UEnvQuery* Template, EEnvQueryRunMode::Type RunMode, AActor& Querier, FTP3OnSharedQueryFinished&& OnFinished, int32& OutRequestId);
+
+	void CancelRequest(int32 RequestId);
+
+protected:
+	UPROPERTY(Config)
+	int32 MaxQueriesPerFrame = 4;
+
+	UPROPERTY(Config)
+	float ResultTimeToLive = 1.f;
+
+	// Queriers within the same cell share their results
+	UPROPERTY(Config)
+	float CellSize = 1000.f;
+
+private:
+	struct FSharedQueryKey
+	{
+		TObjectKey<UEnvQuery> Template;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		uint8 Team = 0;
+		uint8 RunMode = 0;
+
+		bool operator==(const FSharedQueryKey& Other) const
+		{
+			return Template == Other.Template && Cell == Other.Cell && Team == Other.Team && RunMode == Other.RunMode;
+		}
+
+		friend uint32 GetTypeHash(const FSharedQueryKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Template), GetTypeHash(Key.Cell)), (uint32(Key.Team) << 8) | Key.RunMode);
+		}
+	};
+
+	struct FWaiter
+	{
+		int32 RequestId;
+		TWeakObjectPtr<AActor> Querier;
+		FTP3OnSharedQueryFinished OnFinished;
+	};
+
+	struct FSharedQuery
+	{
+		TWeakObjectPtr<UEnvQuery> Template;
+		EEnvQueryRunMode::Type RunMode = EEnvQueryRunMode::SingleResult;
+		TSharedPtr<FEnvQueryResult> Result;
+		double ResultTime = -1.0;
+		double RequestTime = 0.0;
+		// INDEX_NONE while waiting for a slot
+		int32 QueryId = INDEX_NONE;
+		// Best significance bucket of the waiters
+		int32 Priority = MAX_int32;
+		bool bScheduled = false;
+		TArray<FWaiter, TInlineAllocator<4>> Waiters;
+	};
+
+	void StartQueries();
+
+	void OnQueryFinished(TSharedPtr<FEnvQueryResult> Result);
+
+	void PurgeResults(double Now);
+
+	TMap<FSharedQueryKey, FSharedQuery> Queries;
+
+	// Keys waiting for a slot
+	TArray<FSharedQueryKey> Scheduled;
+
+	TMap<int32, FSharedQueryKey> KeyByQueryId;
+
+	TMap<int32, FSharedQueryKey> KeyByRequestId;
+
+	int32 NextRequestId = 1;
+
+	double NextPurgeTime = 0.0;
+};
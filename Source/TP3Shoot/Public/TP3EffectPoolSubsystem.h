@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3EffectPoolSubsystem.generated.h"
+
+class UParticleSystem;
+class UParticleSystemComponent;
+
+/** Ring of emitter components for one particle template */
+USTRUCT()
+struct FTP3EffectPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UParticleSystemComponent>> Components;
+
+	// Next component of the ring to hand out
+	int32 Next = 0;
+};
+
+/**
+ * Pre-warmed emitter components for the muzzle and impact effects of FireParticle.
+ * Spawns recycle the pooled components in a ring instead of creating and auto-destroying a component per shot,
+ * and effects off-screen or beyond the distance budget of the local player are not played at all.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3EffectPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	// End of UWorldSubsystem interface
+
+	// Creates the components of Template's pool up front (tp3.EffectPool.Size of them)
+	void Prewarm(UParticleSystem* Template);
+
+	// Plays Template at Transform with a pooled component, unless the effect is culled
+	void SpawnEffect(UParticleSystem* Template, const FTransform& Transform);
+
+private:
+	UParticleSystemComponent* CreatePooledComponent(UParticleSystem* Template);
+
+	bool ShouldCull(const FVector& Location);
+
+	UPROPERTY(Transient)
+	TMap<TObjectPtr<UParticleSystem>, FTP3EffectPool> Pools;
+
+	// Local player view, refreshed once per frame for culling
+	FVector ViewLocation = FVector::ZeroVector;
+	FVector ViewDirection = FVector::ForwardVector;
+	float ViewCosHalfFOV = -1.f;
+	bool bHasView = false;
+	uint64 ViewFrame = 0;
+};
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/CapsuleComponent.h"
+#include "TP3HitZoneComponent.generated.h"
+
+class USkeletalMeshComponent;
+
+UENUM()
+enum class ETP3HitZone : uint8
+{
+	Torso,
+	Head,
+	// Arms and legs
+	Limb,
+};
+
+/**
+ * Upright capsule following a bone of the character mesh, the only primitive of a combatant on the Weapon trace channel.
+ * Shots no longer test the movement capsule or the physics asset, and their damage is scaled by the zone they hit.
+ * The Weapon and HitZone channels and the TP3HitZone profile are in [/Script/Engine.CollisionProfile] of DefaultEngine.ini.
+ */
+UCLASS(config = Game, ClassGroup = Collision, meta = (BlueprintSpawnableComponent))
+class TP3SHOOT_API UTP3HitZoneComponent : public UCapsuleComponent
+{
+	GENERATED_BODY()
+
+public:
+	UTP3HitZoneComponent();
+
+	// Head, torso and legs on the mannequin bones of Mesh, to call from the constructor of Owner
+	static void CreateHitZones(AActor& Owner, USkeletalMeshComponent* Mesh);
+
+	// 1 when Hit is not on a hit zone, the level or a legacy trace
+	static float GetDamageMultiplier(const FHitResult& Hit);
+
+	static float GetDamageMultiplier(ETP3HitZone Zone);
+
+	// tp3.Weapon.LegacyTraces: shots trace LegacyChannel with complex collision again, to compare the cost per trace
+	static bool UseLegacyTraces();
+
+	static ECollisionChannel GetWeaponChannel(ECollisionChannel LegacyChannel);
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Collision)
+	ETP3HitZone Zone = ETP3HitZone::Torso;
+
+protected:
+	UPROPERTY(Config)
+	float HeadMultiplier = 2.f;
+
+	UPROPERTY(Config)
+	float TorsoMultiplier = 1.f;
+
+	UPROPERTY(Config)
+	float LimbMultiplier = 0.6f;
+};
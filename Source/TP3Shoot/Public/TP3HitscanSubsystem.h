@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TP3HitscanSubsystem.generated.h"
+
+struct FTP3HitscanShot;
+
+/** Called when a queued shot has been traced. Hit is null when nothing was hit. */
+DECLARE_DELEGATE_TwoParams(FTP3OnHitscanResolved, const FTP3HitscanShot& /*Shot*/, const FHitResult* /*Hit*/);
+
+/** A fire request waiting to be traced by UTP3HitscanSubsystem */
+struct FTP3HitscanShot
+{
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+	ECollisionChannel Channel = ECC_Visibility;
+
+	// Only WorldStatic and WorldDynamic objects block the shot, Channel is not used
+	bool bLevelOnly = false;
+
+	// Shooter owning the query params, the shot is dropped if it is destroyed before the trace is sent
+	TWeakObjectPtr<AActor> Shooter;
+
+	// Params cached by the shooter, only read while the batch is submitted
+	const FCollisionQueryParams* QueryParams = nullptr;
+
+	// Server time the combatants are rewound to by the shooter for lag compensation, negative for none
+	double RewindTime = -1.0;
+
+	FTP3OnHitscanResolved OnResolved;
+};
+
+/**
+ * Collects every hitscan shot fired during a frame and sends them as one batch of async line traces.
+ * Results are read back and dispatched to the shooters on the next frame.
+ * The saving is measured by benchmark rows with tp3.Hitscan.Async on and off (HITSCAN_ASYNC=0 Scripts/RunBenchmark.sh).
+ */
+UCLASS()
+class TP3SHOOT_API UTP3HitscanSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Queue a shot for this frame's batch (or trace it immediately when tp3.Hitscan.Async is 0)
+	void QueueShot(FTP3HitscanShot&& Shot);
+
+	// Shot traces sent since the world started, async and immediate
+	int64 GetNumTraces() const { return NumTraces; }
+
+	// Moving average of the game thread cost of one synchronous shot trace, only sampled with tp3.Hitscan.Async 0
+	double GetAvgSyncTraceMs() const { return AvgSyncTraceMs; }
+
+private:
+	struct FInFlightShot
+	{
+		FTP3HitscanShot Shot;
+		FTraceHandle Handle;
+	};
+
+	void ResolveInFlightShots();
+
+	void SubmitPendingShots();
+
+	void TraceShotNow(FTP3HitscanShot& Shot);
+
+	bool TraceSync(const FTP3HitscanShot& Shot, FHitResult& OutHit) const;
+
+	// Moving average of the game thread cost of one synchronous trace, in ms
+	void RecordSyncTraceCost(double Ms);
+
+	// Shots queued this frame
+	TArray<FTP3HitscanShot> PendingShots;
+
+	// Shots sent last frame, waiting for their result
+	TArray<FInFlightShot> InFlightShots;
+
+	double AvgSyncTraceMs = 0.0;
+
+	int64 NumTraces = 0;
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3LagCompensationSubsystem.generated.h"
+
+class APawn;
+
+/** Combatant hit by a rewound trace */
+struct FTP3RewoundHit
+{
+	int32 CombatantId = INDEX_NONE;
+	FVector Impact = FVector::ZeroVector;
+	bool bHead = false;
+};
+
+/**
+ * Server only: records the capsule and head of every combatant of the registry each frame in a fixed ring of
+ * HistorySize frames, indexed by frame then combatant id, so nothing is allocated once the ring is sized.
+ * Shots of remote clients are traced against the hitboxes interpolated at the time the shooter saw them.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3LagCompensationSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Server time seen by Shooter when it fired at ClientTime (its estimate of the server time), within MaxRewindSeconds
+	double GetRewindTime(const APawn& Shooter, double ClientTime) const;
+
+	// Closest enemy of ShooterId crossed by the segment with every combatant rewound to Time
+	bool TraceRewound(const FVector& Start, const FVector& End, int32 ShooterId, double Time, FTP3RewoundHit& OutHit) const;
+
+protected:
+	// Frames kept, at least MaxRewindSeconds at the server tick rate
+	UPROPERTY(Config)
+	int32 HistorySize = 64;
+
+	UPROPERTY(Config)
+	float MaxRewindSeconds = 0.5f;
+
+	// Added to the half ping, interpolation delay of the simulated proxies on the clients
+	UPROPERTY(Config)
+	float ExtraRewindSeconds = 0.05f;
+
+	UPROPERTY(Config)
+	FName HeadBoneName = TEXT("head");
+
+	UPROPERTY(Config)
+	float HeadRadius = 18.f;
+
+private:
+	// 24 bytes per combatant per frame
+	struct FHitboxSnapshot
+	{
+		FVector3f Center;
+		FVector3f Head;
+	};
+
+	// Sizes the ring for Capacity combatants, the history recorded so far is dropped
+	void Reserve(int32 Capacity);
+
+	// Capsule size and head bone of the combatant now in Id, history of the previous one is dropped
+	void RefreshSlot(int32 Id, const AActor* Actor);
+
+	int32 Capacity = 0;
+
+	// HistorySize * Capacity, frame major
+	TArray<FHitboxSnapshot> Snapshots;
+	TArray<uint8> AliveFlags;
+
+	TArray<double> FrameTimes;
+	int32 NewestFrame = INDEX_NONE;
+	int32 NumFrames = 0;
+
+	// Per combatant id
+	TArray<TWeakObjectPtr<const AActor>> SlotActors;
+	TArray<float> Radii;
+	TArray<float> HalfHeights;
+	TArray<int32> HeadBones;
+};
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TP3LineOfSightSubsystem.generated.h"
+
+enum class ETP3Visibility : uint8
+{
+	// Never checked yet, a check is queued
+	Unknown,
+	Visible,
+	Hidden,
+};
+
+/**
+ * Line of sight between pairs of combatants of the registry, cached per unordered pair.
+ * A result is refreshed when it is older than TimeToLive or when one of the two moved more than InvalidateDistance
+ * since it was traced. Refreshes are queued and sent as async traces, at most MaxTracesPerFrame per frame,
+ * and the last known result is returned until the new one arrives.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3LineOfSightSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Cached visibility between two combatants, queues a refresh when it is stale
+	ETP3Visibility GetVisibility(int32 ObserverId, int32 TargetId);
+
+protected:
+	UPROPERTY(Config)
+	int32 MaxTracesPerFrame = 32;
+
+	// Seconds a result stays valid while neither combatant moves
+	UPROPERTY(Config)
+	float TimeToLive = 0.5f;
+
+	UPROPERTY(Config)
+	float InvalidateDistance = 50.f;
+
+	// Traces go from eye to eye, this high above the combatant locations
+	UPROPERTY(Config)
+	float EyeHeight = 60.f;
+
+private:
+	struct FPairEntry
+	{
+		FVector3f LocationA = FVector3f::ZeroVector;
+		FVector3f LocationB = FVector3f::ZeroVector;
+		double TraceTime = -1.0;
+		double RequestTime = 0.0;
+		ETP3Visibility Result = ETP3Visibility::Unknown;
+		bool bQueued = false;
+	};
+
+	struct FInFlightTrace
+	{
+		FTraceHandle Handle;
+		uint64 Key;
+	};
+
+	// Same key for (A, B) and (B, A)
+	static uint64 MakeKey(int32 A, int32 B) { return A < B ? (uint64(uint32(A)) << 32) | uint32(B) : (uint64(uint32(B)) << 32) | uint32(A); }
+
+	void ResolveTraces();
+
+	void SubmitTraces();
+
+	// Drops the pairs nobody asked for since a while, combatant ids are reused
+	void PurgeUnusedPairs(double Now);
+
+	TMap<uint64, FPairEntry> Pairs;
+
+	// Pairs waiting for a trace, oldest first
+	TArray<uint64> Queue;
+
+	TArray<FInFlightTrace> InFlightTraces;
+
+	double NextPurgeTime = 0.0;
+
+	UPROPERTY(Transient)
+	TObjectPtr<class UTP3CombatantRegistry> Registry;
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "TP3MassCombatProcessor.generated.h"
+
+/**
+ * Team versus team combat of the distant combatants: each one picks the nearest enemy in sight from a grid
+ * rebuilt every frame, walks to it and fires with a hit chance falling with the distance.
+ * Dead combatants come back on a spawn point of their team after a delay.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3MassCombatProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UTP3MassCombatProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+
+private:
+	// Alive combatants gathered at the start of the frame, in query order
+	TArray<FVector> Locations;
+	TArray<uint8> Teams;
+	TArray<float> Damages;
+
+	TMap<FIntPoint, TArray<int32>> Cells;
+};
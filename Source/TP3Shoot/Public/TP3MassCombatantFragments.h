@@ -0,0 +1,49 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityTypes.h"
+#include "TP3MassCombatantFragments.generated.h"
+
+/** Combat state of a distant combatant, carried over when it is promoted to an AAI_Player and back */
+USTRUCT()
+struct TP3SHOOT_API FTP3MassCombatantFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	uint8 Team = 0;
+
+	float Life = 100.f;
+
+	float MaxLife = 100.f;
+
+	// Seconds before the next shot
+	float FireCooldown = 0.f;
+
+	// Seconds before a dead combatant comes back on a spawn point of its team
+	float RespawnDelay = 0.f;
+};
+
+/** Position and navmesh path of a distant combatant */
+USTRUCT()
+struct TP3SHOOT_API FTP3MassNavigationFragment : public FMassFragment
+{
+	GENERATED_BODY()
+
+	FVector Location = FVector::ZeroVector;
+
+	// Where the combat processor wants to go, the path is rebuilt when it moves away from the path end
+	FVector Goal = FVector::ZeroVector;
+
+	TArray<FVector, TInlineAllocator<8>> PathPoints;
+
+	int32 PathIndex = 0;
+};
+
+/** Every entity simulated by the TP3 Mass processors */
+USTRUCT()
+struct TP3SHOOT_API FTP3MassCombatantTag : public FMassTag
+{
+	GENERATED_BODY()
+};
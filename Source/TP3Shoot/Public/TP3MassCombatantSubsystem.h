@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassEntityQuery.h"
+#include "MassEntityTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3MassCombatantSubsystem.generated.h"
+
+class AAI_Player;
+
+/**
+ * Distant combatants as Mass entities simulated by UTP3MassNavigationProcessor and UTP3MassCombatProcessor.
+ * Entities within PromoteRadius of a player pawn become AAI_Player bots, and bots further than DemoteRadius
+ * from every player pawn go back to entities, with their team and life carried over both ways.
+ * Spawn them with -TP3MassCombatants=<per team> or the tp3.Mass.SpawnCombatants console command,
+ * nothing is promoted or demoted until then.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3MassCombatantSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UTP3MassCombatantSubsystem();
+
+	// UTickableWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Count entities per team around the spawn points of each team
+	void SpawnCombatants(int32 CountPerTeam);
+
+protected:
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> AllyBotClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> EnemyBotClass;
+
+	// Entities closer than this to the player become bots
+	UPROPERTY(Config)
+	float PromoteRadius = 4000.f;
+
+	// Bots further than this become entities, larger than PromoteRadius so they do not switch back and forth
+	UPROPERTY(Config)
+	float DemoteRadius = 5000.f;
+
+	// Promotions and demotions per frame, each one spawns or destroys an actor
+	UPROPERTY(Config)
+	int32 MaxTransfersPerFrame = 4;
+
+private:
+	struct FPromotion
+	{
+		FMassEntityHandle Entity;
+		uint8 Team = 0;
+		float Life = 0.f;
+		FVector Location = FVector::ZeroVector;
+	};
+
+	FMassEntityHandle CreateEntity(uint8 Team, float Life, float MaxLife, const FVector& Location);
+
+	AAI_Player* SpawnBot(uint8 Team, float Life, const FVector& Location);
+
+	UClass* GetBotClass(uint8 Team) const;
+
+	// Closer than Radius to one of the player pawns
+	bool IsNearViewer(const FVector& Location, double Radius) const;
+
+	void PromoteNearEntities();
+
+	void DemoteFarBots();
+
+	FMassArchetypeHandle Archetype;
+
+	FMassEntityQuery PromotionQuery;
+
+	TArray<FPromotion> Promotions;
+
+	// Player pawn locations of this frame
+	TArray<FVector> ViewerLocations;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UClass> AllyClass;
+
+	UPROPERTY(Transient)
+	TObjectPtr<UClass> EnemyClass;
+
+	uint8 AllyTeam = 1;
+	uint8 EnemyTeam = 0;
+
+	// Set by SpawnCombatants, normal matches keep their bots as they are
+	bool bEnabled = false;
+};
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MassProcessor.h"
+#include "TP3MassNavigationProcessor.generated.h"
+
+/**
+ * Moves the distant combatants along navmesh paths to the goal set by UTP3MassCombatProcessor.
+ * Path finds are spread over the frames with a fixed budget.
+ */
+UCLASS()
+class TP3SHOOT_API UTP3MassNavigationProcessor : public UMassProcessor
+{
+	GENERATED_BODY()
+
+public:
+	UTP3MassNavigationProcessor();
+
+protected:
+	virtual void ConfigureQueries() override;
+	virtual void Execute(FMassEntityManager& EntityManager, FMassExecutionContext& Context) override;
+
+	FMassEntityQuery EntityQuery;
+};
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3MatchRecording.h"
+#include "TP3MatchRecorderSubsystem.generated.h"
+
+class FRunnableThread;
+class FTP3RecordingWriter;
+
+/**
+ * Records the combat events of the registry and the characters, and the combatant transforms every SampleInterval,
+ * in the format of TP3MatchRecording.h. Full chunks are handed to a writer thread which compresses and writes them,
+ * the game thread only appends bytes.
+ * Started with -TP3Record[=File] or tp3.Record.Start [File], replayed by UTP3MatchReplaySubsystem.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3MatchRecorderSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Empty Filename records in Saved/Recordings, named after the map and the time
+	void StartRecording(const FString& Filename);
+
+	void StopRecording();
+
+	bool IsRecording() const { return Writer != nullptr; }
+
+	void RecordSpawn(int32 Id, const AActor& Actor, uint8 Team, float MaxLife);
+	void RecordDespawn(int32 Id);
+	void RecordFireStart(int32 ShooterId, const FVector& Start, const FVector& End);
+	void RecordFireEnd(int32 ShooterId, int32 HitId, const FVector& Impact);
+	void RecordDamage(int32 TargetId, float Amount, bool bKilled);
+	void RecordRespawn(int32 Id, const FVector& Location);
+
+protected:
+	// Seconds between two transform samples
+	UPROPERTY(Config)
+	float SampleInterval = 0.1f;
+
+	// Uncompressed bytes buffered before a chunk goes to the writer thread
+	UPROPERTY(Config)
+	int32 ChunkSize = 64 * 1024;
+
+private:
+	void SampleTransforms();
+
+	void FlushChunk();
+
+	TP3MatchRecording::FWriter Chunk;
+
+	FTP3RecordingWriter* Writer = nullptr;
+	FRunnableThread* WriterThread = nullptr;
+
+	// Previous sample of each combatant id, deltas are written against it
+	TArray<FIntVector> LastLocations;
+	TArray<int32> LastYaws;
+
+	float TimeSinceSample = 0.f;
+};
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Binary format of the match recordings written by UTP3MatchRecorderSubsystem and read by UTP3MatchReplaySubsystem.
+ * File: header (magic, version, map name), then chunks of [uint32 raw size][uint32 compressed size][Oodle data].
+ * Decompressed chunks are a stream of records, one tag byte then its fields. Ids are combatant registry ids of
+ * the recording, integers are zigzag varints and locations are in whole centimeters.
+ */
+namespace TP3MatchRecording
+{
+	static constexpr uint32 Magic = 0x52335054; // "TP3R"
+	static constexpr uint32 Version = 1;
+
+	enum class ETag : uint8
+	{
+		// DeltaSeconds, closes the records of a frame
+		FrameEnd = 1,
+		// Id, Team, MaxLife, class path
+		Spawn,
+		// Id
+		Despawn,
+		// ShooterId, Start, End - Start
+		FireStart,
+		// ShooterId, HitId + 1 (0 for none), Impact
+		FireEnd,
+		// TargetId, Amount, bKilled
+		Damage,
+		// Id, Location
+		Respawn,
+		// Count, then per combatant Id, location and yaw deltas from its previous sample
+		Transforms,
+	};
+
+	// Yaw quantized on 16 bits
+	inline int32 QuantizeYaw(float Yaw) { return FRotator::CompressAxisToShort(Yaw); }
+	inline float DequantizeYaw(int32 Yaw) { return FRotator::DecompressAxisFromShort((uint16)Yaw); }
+
+	inline FIntVector QuantizeLocation(const FVector& Location) { return FIntVector(FMath::RoundToInt(Location.X), FMath::RoundToInt(Location.Y), FMath::RoundToInt(Location.Z)); }
+
+	/** Appends records to a chunk */
+	struct FWriter
+	{
+		TArray<uint8> Bytes;
+
+		void WriteByte(uint8 Value) { Bytes.Add(Value); }
+
+		void WriteVarUInt(uint32 Value)
+		{
+			while (Value >= 0x80)
+			{
+				Bytes.Add(uint8(Value | 0x80));
+				Value >>= 7;
+			}
+			Bytes.Add(uint8(Value));
+		}
+
+		void WriteVarInt(int32 Value) { WriteVarUInt((uint32(Value) << 1) ^ uint32(Value >> 31)); }
+
+		void WriteFloat(float Value) { Bytes.Append(reinterpret_cast<const uint8*>(&Value), sizeof(float)); }
+
+		void WriteIntVector(const FIntVector& Value)
+		{
+			WriteVarInt(Value.X);
+			WriteVarInt(Value.Y);
+			WriteVarInt(Value.Z);
+		}
+
+		void WriteString(const FString& Value)
+		{
+			const FTCHARToUTF8 Utf8(*Value);
+			WriteVarUInt(Utf8.Length());
+			Bytes.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+		}
+
+		void WriteTag(ETag Tag) { WriteByte(uint8(Tag)); }
+	};
+
+	/** Reads records back, IsValid turns false on a truncated stream */
+	struct FReader
+	{
+		TConstArrayView<uint8> Bytes;
+		int32 Offset = 0;
+		bool bError = false;
+
+		bool IsValid() const { return !bError; }
+		bool AtEnd() const { return Offset >= Bytes.Num(); }
+
+		uint8 ReadByte()
+		{
+			if (Offset >= Bytes.Num())
+			{
+				bError = true;
+				return 0;
+			}
+			return Bytes[Offset++];
+		}
+
+		uint32 ReadVarUInt()
+		{
+			uint32 Value = 0;
+			for (int32 Shift = 0; Shift < 35 && !bError; Shift += 7)
+			{
+				const uint8 Byte = ReadByte();
+				Value |= uint32(Byte & 0x7F) << Shift;
+				if (!(Byte & 0x80))
+				{
+					break;
+				}
+			}
+			return Value;
+		}
+
+		int32 ReadVarInt()
+		{
+			const uint32 Value = ReadVarUInt();
+			return int32(Value >> 1) ^ -int32(Value & 1);
+		}
+
+		float ReadFloat()
+		{
+			float Value = 0.f;
+			if (Offset + (int32)sizeof(float) > Bytes.Num())
+			{
+				bError = true;
+				return Value;
+			}
+			FMemory::Memcpy(&Value, Bytes.GetData() + Offset, sizeof(float));
+			Offset += sizeof(float);
+			return Value;
+		}
+
+		FIntVector ReadIntVector()
+		{
+			const int32 X = ReadVarInt();
+			const int32 Y = ReadVarInt();
+			const int32 Z = ReadVarInt();
+			return FIntVector(X, Y, Z);
+		}
+
+		FString ReadString()
+		{
+			const int32 Length = ReadVarUInt();
+			if (Length < 0 || Offset + Length > Bytes.Num())
+			{
+				bError = true;
+				return FString();
+			}
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Bytes.GetData() + Offset), Length);
+			Offset += Length;
+			return FString(Converted.Length(), Converted.Get());
+		}
+	};
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3MatchReplaySubsystem.generated.h"
+
+/**
+ * Plays back a recording of UTP3MatchRecorderSubsystem: combatants are spawned without controllers, moved to their
+ * recorded transforms, and their shots and damage go through the hitscan subsystem and the registry as in the match.
+ * One recorded frame is played per frame, so a headless run is faster than real time:
+ *   UnrealEditor-Cmd TP3Shoot.uproject /Game/DMap -game -nullrhi -nosound -benchmark -TP3Replay=Saved/Recordings/X.tp3rec
+ */
+UCLASS()
+class TP3SHOOT_API UTP3MatchReplaySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+private:
+	struct FReplayCombatant
+	{
+		TWeakObjectPtr<AActor> Actor;
+		int32 CombatantId = INDEX_NONE;
+		FIntVector Location = FIntVector::ZeroValue;
+		int32 Yaw = 0;
+		FVector LastFireStart = FVector::ZeroVector;
+	};
+
+	bool Load(const FString& Filename);
+
+	void Finish();
+
+	// Plays the records up to the next FrameEnd, returns false at the end of the stream
+	bool PlayFrame();
+
+	void Spawn(int32 Id, uint8 Team, float MaxLife, const FString& ClassPath);
+
+	FReplayCombatant* FindCombatant(int32 Id);
+
+	// Decompressed records of the whole recording
+	TArray<uint8> Stream;
+	int32 Offset = 0;
+
+	TArray<FReplayCombatant> Combatants;
+
+	FCollisionQueryParams ShotQueryParams;
+
+	bool bPlaying = false;
+	int32 NumFrames = 0;
+	double RecordedSeconds = 0.0;
+	double StartWallTime = 0.0;
+};
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NavigationData.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3PathBrokerSubsystem.generated.h"
+
+/** Called with the path of a brokered request, null when no path was found */
+DECLARE_DELEGATE_OneParam(FTP3OnPathReady, FNavPathSharedPtr /*Path*/);
+
+/**
+ * Queues the path requests of the bots and runs them as async navigation queries, which the navigation system
+ * solves on a worker thread, at most MaxQueriesPerFrame new queries per frame.
+ * Requests starting in the same CorridorCellSize cell and heading to the same cell share one query:
+ * the others get the corridor of the first one, moved sideways by their own start offset (up to CorridorWidth)
+ * and projected back on the navmesh, with their own start and goal. A request whose first or last leg is cut by
+ * a navmesh raycast is queued again as its own query.
+ * Reports the queue depth and the p50/p90/p99 latency from request to path in stat tp3shoot.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3PathBrokerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Returns the request id, a request that cannot be solved gets a null path
+	int32 RequestPath(AActor& Agent, const FVector& Goal, FTP3OnPathReady&& OnReady);
+
+	void CancelRequest(int32 RequestId);
+
+protected:
+	UPROPERTY(Config)
+	int32 MaxQueriesPerFrame = 8;
+
+	UPROPERTY(Config)
+	float CorridorCellSize = 500.f;
+
+	// Max sideways offset of a shared corridor
+	UPROPERTY(Config)
+	float CorridorWidth = 150.f;
+
+private:
+	struct FRequest
+	{
+		int32 RequestId;
+		TWeakObjectPtr<AActor> Agent;
+		FVector Start;
+		FVector Goal;
+		double RequestTime;
+		FTP3OnPathReady OnReady;
+	};
+
+	struct FGroup
+	{
+		FIntVector4 Key;
+		// The first request is the one queried
+		TArray<FRequest, TInlineAllocator<4>> Requests;
+		uint32 QueryId = 0;
+	};
+
+	void LaunchQueries();
+
+	void OnPathFound(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	// Hands the path to every request of the group, null for none
+	void DispatchGroup(int32 GroupId, FNavPathSharedPtr LeaderPath);
+
+	// Queries Request on its own, without sharing
+	void QueueAlone(FRequest&& Request);
+
+	// Leader corridor with the start and goal of Request, null when its start or goal is not reachable from the corridor
+	FNavPathSharedPtr MakeSharedPath(const FNavigationPath& LeaderPath, const FRequest& Leader, const FRequest& Request) const;
+
+	void RecordLatency(double RequestTime);
+
+	void UpdateLatencyStats();
+
+	TMap<int32, FGroup> Groups;
+
+	// Groups still accepting requests, until their path arrives
+	TMap<FIntVector4, int32> GroupByKey;
+
+	// Groups waiting for a query, oldest first
+	TArray<int32> Queue;
+
+	TMap<uint32, int32> GroupByQueryId;
+
+	TMap<int32, int32> GroupByRequestId;
+
+	int32 NextId = 1;
+
+	// Last latencies in ms, a ring of LatencyWindow entries
+	static constexpr int32 LatencyWindow = 256;
+	TArray<float> LatenciesMs;
+	int32 NextLatency = 0;
+
+	double NextStatsTime = 0.0;
+};
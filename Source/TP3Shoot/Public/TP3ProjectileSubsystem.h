@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CollisionQueryParams.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldCollision.h"
+#include "TP3ProjectileSubsystem.generated.h"
+
+/**
+ * Bullets with travel time, gravity and quadratic drag, without an actor per bullet.
+ * Live bullets are kept in structure-of-arrays buffers integrated 4 at a time with the vector intrinsics, and the
+ * segment each one covered during the frame is sent as one batch of async line traces resolved on the next frame.
+ * Hits go through UTP3CombatantRegistry::TryDamageEnemy like the hitscan shots.
+ * AAI_Player::Fire launches bullets instead of hitscan shots when tp3.Projectile.Bullets is 1.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3ProjectileSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// tp3.Projectile.Bullets
+	static bool ShouldFireBullets();
+
+	// Bullet of the combatant ShooterId leaving Start along Direction at MuzzleSpeed. Returns false when the buffers are full.
+	bool Launch(int32 ShooterId, const FVector& Start, const FVector& Direction, float Damage);
+
+	// Count bullets fired in random horizontal directions by random combatants, without damage
+	void LaunchStress(int32 Count);
+
+	int32 GetNumProjectiles() const { return NumProjectiles; }
+
+protected:
+	// Size of the buffers, allocated once
+	UPROPERTY(Config)
+	int32 MaxProjectiles = 16384;
+
+	// cm/s
+	UPROPERTY(Config)
+	float MuzzleSpeed = 30000.f;
+
+	// Deceleration of DragCoefficient * speed^2, per cm
+	UPROPERTY(Config)
+	float DragCoefficient = 0.00001f;
+
+	// Bullets that hit nothing are removed after this many seconds
+	UPROPERTY(Config)
+	float MaxLifetime = 3.f;
+
+private:
+	struct FInFlightTrace
+	{
+		FTraceHandle Handle;
+		int32 Index;
+	};
+
+	void ResolveTraces();
+
+	// Removes the dead bullets, the last live ones are moved in their slots
+	void Compact();
+
+	void Integrate(float DeltaTime);
+
+	void SubmitTraces();
+
+	void Impact(int32 Index, const FHitResult& Hit);
+
+	void MoveSlot(int32 From, int32 To);
+
+	// Params ignoring the shooter, cached per combatant id
+	const FCollisionQueryParams& GetShooterQueryParams(int32 ShooterId);
+
+	int32 NumProjectiles = 0;
+
+	// Hot data, MaxProjectiles rounded up to 4 floats each, read and written 4 lanes at a time
+	TArray<float> PosX;
+	TArray<float> PosY;
+	TArray<float> PosZ;
+	TArray<float> PrevX;
+	TArray<float> PrevY;
+	TArray<float> PrevZ;
+	TArray<float> VelX;
+	TArray<float> VelY;
+	TArray<float> VelZ;
+	TArray<float> Ages;
+
+	// Cold data, only read on impact
+	TArray<int32> ShooterIds;
+	TArray<TWeakObjectPtr<AActor>> Shooters;
+	TArray<float> Damages;
+	TArray<FVector3f> LaunchLocations;
+	TArray<uint8> DeadFlags;
+
+	TArray<FCollisionQueryParams> ShooterQueryParams;
+	TArray<TWeakObjectPtr<AActor>> ShooterQueryParamsOwners;
+
+	// Segments traced last frame, waiting for their result
+	TArray<FInFlightTrace> InFlightTraces;
+
+	UPROPERTY(Transient)
+	TObjectPtr<class UTP3CombatantRegistry> Registry;
+};
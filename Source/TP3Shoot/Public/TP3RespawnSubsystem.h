@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3RespawnSubsystem.generated.h"
+
+class ACharacter;
+
+/**
+ * Respawns dead combatants on spawn points projected on the navmesh when the map starts.
+ * Points are ranked per team from the distance to the closest enemy on a fixed interval,
+ * so picking a point at respawn time is a cursor step in a cached list with no traces.
+ * Dead characters stay hidden and inactive for RespawnDelay seconds before coming back.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3RespawnSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// Deactivates the dead character and brings it back on a spawn point of its team after RespawnDelay
+	void QueueRespawn(ACharacter* Character, int32 CombatantId);
+
+	// Teleports the character to Location, reactivates it and revives it in the registry
+	void RespawnAt(ACharacter* Character, int32 CombatantId, const FVector& Location);
+
+	// While suspended dead characters are only deactivated, something else brings them back with RespawnAt
+	void SetSuspended(bool bInSuspended) { bSuspended = bInSuspended; }
+
+	// Best ranked spawn point for Team, in O(1)
+	FVector PickSpawnPoint(uint8 Team);
+
+	const TArray<FVector>& GetSpawnPoints() const { return SpawnPoints; }
+
+protected:
+	// Seconds a dead character stays deactivated
+	UPROPERTY(Config)
+	float RespawnDelay = 3.f;
+
+	// Points sampled around each player start
+	UPROPERTY(Config)
+	int32 SamplesPerSeed = 16;
+
+	UPROPERTY(Config)
+	float SeedRadius = 1500.f;
+
+	// Spacing of the grid sampled over the navigable bounds, 0 only uses the player starts
+	UPROPERTY(Config)
+	float GridSpacing = 1500.f;
+
+	UPROPERTY(Config)
+	int32 MaxSpawnPoints = 256;
+
+	// Seconds between two rankings of the spawn points
+	UPROPERTY(Config)
+	float ScoreInterval = 0.5f;
+
+	// Enemies closer than this make a point unsafe
+	UPROPERTY(Config)
+	float MinEnemyDistance = 1500.f;
+
+	// Enemies further than this do not make a point safer
+	UPROPERTY(Config)
+	float MaxScoredDistance = 8000.f;
+
+	// Best points kept per team, the picks go round-robin through them
+	UPROPERTY(Config)
+	int32 TopPointsPerTeam = 8;
+
+private:
+	struct FPendingRespawn
+	{
+		TWeakObjectPtr<ACharacter> Character;
+		int32 CombatantId = INDEX_NONE;
+		double RespawnTime = 0.0;
+	};
+
+	struct FTeamRanking
+	{
+		TArray<int32> BestPoints;
+		int32 Cursor = 0;
+	};
+
+	void BuildSpawnPoints(UWorld& World);
+
+	void RankSpawnPoints();
+
+	void SetCharacterActive(ACharacter* Character, bool bActive);
+
+	TArray<FVector> SpawnPoints;
+
+	// Indexed by team id
+	TArray<FTeamRanking> Rankings;
+
+	// Same delay for everybody, so the queue stays sorted by respawn time
+	TArray<FPendingRespawn> PendingRespawns;
+
+	double NextRankTime = 0.0;
+
+	bool bSuspended = false;
+};
@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3ServerStatsSubsystem.generated.h"
+
+/**
+ * Dedicated server only: game thread time spent per frame outside of the tick rate idle wait,
+ * divided by the connected players, in stat tp3shoot, the TP3Net CSV category and the log every ReportInterval.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3ServerStatsSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+protected:
+	// Seconds between two log lines, 0 disables the log
+	UPROPERTY(Config)
+	float ReportInterval = 10.f;
+
+private:
+	double BusyMsSum = 0.0;
+	int32 NumFrames = 0;
+	float TimeSinceReport = 0.f;
+};
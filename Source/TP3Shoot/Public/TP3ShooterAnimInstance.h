@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimInstanceProxy.h"
+#include "TP3ShooterAnimInstance.generated.h"
+
+/**
+ * Copies the state of the AAI_Player or ATP3ShootCharacter owner on the game thread (PreUpdate),
+ * then derives the blendspace inputs on the animation worker thread (Update).
+ */
+USTRUCT(BlueprintType)
+struct TP3SHOOT_API FTP3ShooterAnimInstanceProxy : public FAnimInstanceProxy
+{
+	GENERATED_BODY()
+
+	FTP3ShooterAnimInstanceProxy() = default;
+
+	FTP3ShooterAnimInstanceProxy(UAnimInstance* Instance)
+		: FAnimInstanceProxy(Instance)
+	{
+	}
+
+	// Ground speed, input of RunBlendSpace and AimWalkBlend
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	float Speed = 0.f;
+
+	// Angle in degrees between the velocity and the facing, from -180 to 180
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	float Direction = 0.f;
+
+	// Aim offset inputs, relative to the facing
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	float AimPitch = 0.f;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	float AimYaw = 0.f;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	bool bIsAiming = false;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	bool bIsFiring = false;
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter)
+	bool bIsInAir = false;
+
+protected:
+	// FAnimInstanceProxy interface
+	virtual void PreUpdate(UAnimInstance* InAnimInstance, float DeltaSeconds) override;
+	virtual void Update(float DeltaSeconds) override;
+	// End of FAnimInstanceProxy interface
+
+private:
+	// Game thread snapshot of the owner
+	FVector Velocity = FVector::ZeroVector;
+	FRotator ActorRotation = FRotator::ZeroRotator;
+	FRotator AimRotation = FRotator::ZeroRotator;
+};
+
+/**
+ * Native parent of ABP_Shooter. The anim graph reads the proxy members through property access,
+ * so with multi-threaded update on, nothing but the owner snapshot runs on the game thread.
+ */
+UCLASS(Transient, Blueprintable)
+class TP3SHOOT_API UTP3ShooterAnimInstance : public UAnimInstance
+{
+	GENERATED_BODY()
+
+protected:
+	// UAnimInstance interface
+	virtual FAnimInstanceProxy* CreateAnimInstanceProxy() override { return &Proxy; }
+	virtual void DestroyAnimInstanceProxy(FAnimInstanceProxy* InProxy) override {}
+	// End of UAnimInstance interface
+
+	UPROPERTY(Transient, BlueprintReadOnly, Category = Shooter, meta = (AllowPrivateAccess = "true"))
+	FTP3ShooterAnimInstanceProxy Proxy;
+};
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TP3SignificanceSubsystem.generated.h"
+
+class AAI_Player;
+
+/** Tick rates of the bots of one significance bucket, 0 ticks every frame */
+USTRUCT()
+struct FTP3SignificanceBucket
+{
+	GENERATED_BODY()
+
+	// Bots closer than this to a local view fall in this bucket
+	UPROPERTY(Config)
+	float MaxDistance = 0.f;
+
+	UPROPERTY(Config)
+	float ActorTickInterval = 0.f;
+
+	UPROPERTY(Config)
+	float MovementTickInterval = 0.f;
+
+	UPROPERTY(Config)
+	float BrainTickInterval = 0.f;
+
+	UPROPERTY(Config)
+	float WidgetTickInterval = 0.f;
+
+	// Animation update rate optimization frames skipped between two updates
+	UPROPERTY(Config)
+	int32 AnimFramesToSkip = 0;
+
+	// Bots walking on the ground follow the navmesh in MOVE_NavWalking, without the floor sweeps of MOVE_Walking
+	UPROPERTY(Config)
+	bool bNavWalking = false;
+};
+
+/**
+ * Buckets the AAI_Player bots with the significance manager by distance and visibility to the local views,
+ * and lowers the tick rate of their actor, movement, behavior tree, animation and health bar in the far buckets.
+ * Damaged bots go back to the first bucket at once and stay there for PromotionDuration.
+ * Bots of the nav walking buckets move on the navmesh only, and are back to full walking in the near buckets
+ * or while falling, launched or knocked back.
+ * The saving is measured by benchmark rows with tp3.Significance.Enabled on and off (SIGNIFICANCE=0 Scripts/RunBenchmark.sh).
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3SignificanceSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UTP3SignificanceSubsystem();
+
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	void RegisterBot(AAI_Player* Bot);
+
+	void UnregisterBot(AAI_Player* Bot);
+
+	// Full rate now, called on combat events like taking damage
+	void PromoteToFullRate(AAI_Player* Bot);
+
+	// Bucket applied to Bot, 0 (the most significant) for anything that is not a registered bot
+	int32 GetBucket(const AActor* Bot) const;
+
+protected:
+	// Sorted by MaxDistance, the last bucket takes everybody further
+	UPROPERTY(Config)
+	TArray<FTP3SignificanceBucket> Buckets;
+
+	// Seconds a promoted bot stays in the first bucket
+	UPROPERTY(Config)
+	float PromotionDuration = 3.f;
+
+private:
+	int32 ComputeBucket(const AAI_Player& Bot, const FTransform& View) const;
+
+	void ApplyBucket(AAI_Player& Bot, int32 Bucket) const;
+
+	// Switches between MOVE_Walking and MOVE_NavWalking, other movement modes are left alone
+	void ApplyMovementMode(AAI_Player& Bot, const FTP3SignificanceBucket& Settings) const;
+
+	// Bucket applied to each registered bot
+	TMap<TObjectKey<AAI_Player>, int32> BotBuckets;
+
+	// World time until which each promoted bot stays at full rate
+	TMap<TObjectKey<AAI_Player>, double> PromotedUntil;
+
+	TArray<FTransform> Views;
+};
@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TP3Shoot/TP3ShootGameMode.h"
+#include "TP3SoakGameMode.generated.h"
+
+class AAI_Player;
+
+/**
+ * Headless bot versus bot match for AI soak and balance runs, selected with the game option of the map URL:
+ * UnrealEditor-Cmd TP3Shoot.uproject "/Game/DMap?game=/Script/TP3Shoot.TP3SoakGameMode" -game -nullrhi -SoakSeed=1
+ * Players only spectate. The world steps at a fixed 1 / FixedFrameRate without waiting for the wall clock,
+ * and the match ends when a team reaches KillLimit or after MaxMatchSeconds of simulated time.
+ * The summary is written as JSON to -SoakOutput= (Saved/Soak/<label>_<seed>.json by default), then the process quits.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API ATP3SoakGameMode : public ATP3ShootGameMode
+{
+	GENERATED_BODY()
+
+public:
+	ATP3SoakGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void StartPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+protected:
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> AllyBotClass;
+
+	UPROPERTY(Config)
+	TSoftClassPtr<AAI_Player> EnemyBotClass;
+
+	// Bots of each team replacing the ones of the map, 0 keeps the map bots, -SoakBots=
+	UPROPERTY(Config)
+	int32 BotsPerTeam = 0;
+
+	// Kills of one team that end the match, -SoakKillLimit=
+	UPROPERTY(Config)
+	int32 KillLimit = 50;
+
+	// Simulated seconds after which the match is a draw or goes to the team with most kills, -SoakSeconds=
+	UPROPERTY(Config)
+	float MaxMatchSeconds = 600.f;
+
+	// Simulated frames per second, -SoakFps=
+	UPROPERTY(Config)
+	float FixedFrameRate = 30.f;
+
+	// Seed of the random streams, -SoakSeed=
+	UPROPERTY(Config)
+	int32 RandomSeed = 1234;
+
+private:
+	struct FTeamStats
+	{
+		int32 Kills = 0;
+		int32 Deaths = 0;
+	};
+
+	void SpawnBots();
+
+	void OnCombatantKilled(int32 CombatantId);
+
+	// Team with a kill count at the limit, or the most kills once the time is up, 0 for a draw
+	uint8 FindWinner(bool bTimeUp) const;
+
+	void FinishMatch(uint8 Winner, const TCHAR* Reason);
+
+	void WriteResults(uint8 Winner, const TCHAR* Reason) const;
+
+	FString OutputFilename;
+
+	FString Label;
+
+	TMap<uint8, FTeamStats> Teams;
+
+	double SimulatedSeconds = 0.0;
+	double StartWallTime = 0.0;
+	int64 NumFrames = 0;
+	bool bFinished = false;
+
+	FDelegateHandle KilledHandle;
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BehaviorTree/BlackboardComponent.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "TP3SquadCoordinatorSubsystem.generated.h"
+
+/**
+ * Assigns a target to every bot of every team each Interval, instead of each bot picking its own.
+ * Alive combatants are gathered once from the registry, the nearest enemies of each bot are scored in a ParallelFor,
+ * then a greedy pass hands out the closest pairs first with at most MaxAttackersPerTarget bots per enemy,
+ * a bonus for the current target so bots do not switch every pass. The result is written to TargetKeyName.
+ * Server only, tp3.Squad.Coordinator 0 turns it off.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3SquadCoordinatorSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	// End of UTickableWorldSubsystem interface
+
+	// tp3.Squad.Coordinator, the bots then read their target instead of picking one
+	static bool IsEnabled();
+
+protected:
+	UPROPERTY(Config)
+	float Interval = 0.5f;
+
+	// Object key of BB_IA receiving the assigned enemy
+	UPROPERTY(Config)
+	FName TargetKeyName = TEXT("TargetActor");
+
+	UPROPERTY(Config)
+	float MaxRange = 4000.f;
+
+	// Enemies scored per bot, nearest first
+	UPROPERTY(Config)
+	int32 CandidatesPerBot = 4;
+
+	UPROPERTY(Config)
+	int32 MaxAttackersPerTarget = 2;
+
+	// Distance to the current target is scaled by this when scoring
+	UPROPERTY(Config)
+	float CurrentTargetBonus = 0.75f;
+
+private:
+	struct FBot
+	{
+		int32 CombatantId;
+		UBlackboardComponent* Blackboard;
+		FBlackboard::FKey KeyId;
+		int32 CurrentTarget;
+	};
+
+	struct FCandidate
+	{
+		float Score;
+		int32 BotIndex;
+		int32 TargetId;
+	};
+
+	void Solve();
+
+	// Gathers the bots having a blackboard with TargetKeyName
+	void GatherBots();
+
+	TArray<FBot> Bots;
+
+	// Candidates of each bot, CandidatesPerBot entries per bot
+	TArray<FCandidate> Candidates;
+
+	TArray<int32> Assignments;
+
+	TArray<int32> AttackersPerTarget;
+
+	// Key id of TargetKeyName per blackboard asset
+	TMap<TObjectKey<UBlackboardData>, FBlackboard::FKey> KeyIds;
+
+	double NextSolveTime = 0.0;
+};
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "TP3TracerSubsystem.generated.h"
+
+class UInstancedStaticMeshComponent;
+class UMaterialInterface;
+class UStaticMesh;
+
+/**
+ * Shot tracers kept in a fixed-size ring buffer and drawn by one instanced static mesh component per team.
+ * Each component has its own dynamic instance of TracerMaterial with the team color set on TracerColorParameter,
+ * the "Color" parameter of the default /Engine/BasicShapes/BasicShapeMaterial (set in DefaultGame.ini).
+ * Built with TP3_DEBUG_TRACERS=1, tracers are drawn with DrawDebugLine instead.
+ */
+UCLASS(config = Game)
+class TP3SHOOT_API UTP3TracerSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	// UTickableWorldSubsystem interface
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	// End of UTickableWorldSubsystem interface
+
+	void AddTracer(const FVector& Start, const FVector& End, uint8 Team);
+
+	static FColor GetTeamColor(uint8 Team) { return Team == 1 ? FColor::Blue : FColor::Red; }
+
+	static int32 GetTeamIndex(uint8 Team) { return Team == 1 ? 1 : 0; }
+
+protected:
+	// Unit mesh stretched along its Z axis from start to end, 100 units long
+	UPROPERTY(Config)
+	FSoftObjectPath TracerMesh = FSoftObjectPath(TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+
+	// Material with a vector parameter for the team color
+	UPROPERTY(Config)
+	FSoftObjectPath TracerMaterial = FSoftObjectPath(TEXT("/Engine/BasicShapes/BasicShapeMaterial.BasicShapeMaterial"));
+
+	UPROPERTY(Config)
+	FName TracerColorParameter = TEXT("Color");
+
+	// Size of the ring buffer, the oldest tracer is replaced when it is full
+	UPROPERTY(Config)
+	int32 MaxTracers = 512;
+
+	UPROPERTY(Config)
+	float TracerLifetime = 3.f;
+
+	// Diameter of the tracer in cm
+	UPROPERTY(Config)
+	float TracerThickness = 3.f;
+
+private:
+	struct FTracer
+	{
+		double ExpireTime = 0.0;
+		int32 TeamIndex = 0;
+		bool bLive = false;
+	};
+
+	UInstancedStaticMeshComponent* CreateTracerComponent(UWorld& InWorld, UStaticMesh* Mesh, UMaterialInterface* Material, uint8 Team);
+
+	void HideInstance(const FTracer& Tracer, int32 Slot);
+
+	// Indexed by GetTeamIndex, each holds an instance for every slot of the ring, hidden unless the slot is of its team
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> TracerComponents;
+
+	TArray<FTracer> Tracers;
+
+	// Slot the next tracer goes to
+	int32 NextSlot = 0;
+
+	int32 NumLive = 0;
+
+	bool bRenderStateDirty = false;
+};
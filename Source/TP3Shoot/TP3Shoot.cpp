@@ -3,5 +3,21 @@
 #include "TP3Shoot.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_STAT(STAT_TP3Combat_Fire);
+DEFINE_STAT(STAT_TP3Combat_FireResolved);
+DEFINE_STAT(STAT_TP3Combat_FireParticle);
+DEFINE_STAT(STAT_TP3Combat_DecreaseHealth);
+DEFINE_STAT(STAT_TP3Combat_LifeChanged);
+DEFINE_STAT(STAT_TP3Combat_UpdateHealthBar);
+DEFINE_STAT(STAT_TP3Combat_BoostSpeed);
+
+DEFINE_STAT(STAT_TP3Combat_Shots);
+DEFINE_STAT(STAT_TP3Combat_Hits);
+DEFINE_STAT(STAT_TP3Combat_Kills);
+DEFINE_STAT(STAT_TP3Combat_Respawns);
+DEFINE_STAT(STAT_TP3Combat_WidgetUpdates);
+
+CSV_DEFINE_CATEGORY_MODULE(TP3SHOOT_API, TP3Combat, true);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, TP3Shoot, "TP3Shoot" );
  
\ No newline at end of file
@@ -3,3 +3,61 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "Stats/Stats.h"
+
+// Stats for the gameplay systems of the module (stat tp3shoot)
+DECLARE_STATS_GROUP(TEXT("TP3Shoot"), STATGROUP_TP3Shoot, STATCAT_Advanced);
+
+// Combat entry points of the characters and combat events per frame (stat tp3combat)
+DECLARE_STATS_GROUP(TEXT("TP3Combat"), STATGROUP_TP3Combat, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire"), STAT_TP3Combat_Fire, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire resolved"), STAT_TP3Combat_FireResolved, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Fire particle"), STAT_TP3Combat_FireParticle, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decrease health"), STAT_TP3Combat_DecreaseHealth, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Life changed"), STAT_TP3Combat_LifeChanged, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update health bar"), STAT_TP3Combat_UpdateHealthBar, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Boost speed"), STAT_TP3Combat_BoostSpeed, STATGROUP_TP3Combat, TP3SHOOT_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots"), STAT_TP3Combat_Shots, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Hits"), STAT_TP3Combat_Hits, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Kills"), STAT_TP3Combat_Kills, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Respawns"), STAT_TP3Combat_Respawns, STATGROUP_TP3Combat, TP3SHOOT_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Widget updates"), STAT_TP3Combat_WidgetUpdates, STATGROUP_TP3Combat, TP3SHOOT_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(TP3SHOOT_API, TP3Combat);
+
+// Cycle stat of stat tp3combat and a CPU scope of the same name for Unreal Insights
+#define TP3_COMBAT_SCOPE(Stat) \
+	SCOPE_CYCLE_COUNTER(Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Stat)
+
+// One combat event in stat tp3combat and in the TP3Combat category of the CSV profiler (-csvCapture)
+#define TP3_COUNT_COMBAT_EVENT(Name) \
+	INC_DWORD_STAT(STAT_TP3Combat_##Name); \
+	CSV_CUSTOM_STAT(TP3Combat, Name, 1, ECsvCustomStatOp::Accumulate)
+
+// Game thread time spent in the ticks of one kind of component, summed by the component while the benchmark runs
+struct FTP3TickTimes
+{
+	double Ms = 0.0;
+	int64 NumTicks = 0;
+
+	void Add(double StartSeconds)
+	{
+		Ms += (FPlatformTime::Seconds() - StartSeconds) * 1000.0;
+		++NumTicks;
+	}
+};
+
+// 1 draws the shot tracers with DrawDebugLine instead of the instanced tracer renderer (never in Shipping)
+#ifndef TP3_DEBUG_TRACERS
+#define TP3_DEBUG_TRACERS 0
+#endif
+
+#define TP3_WITH_DEBUG_TRACERS (TP3_DEBUG_TRACERS && !UE_BUILD_SHIPPING)
+
+// Trace channel of the shots, blocked by the hit zones and the level, see [/Script/Engine.CollisionProfile] in DefaultEngine.ini
+#define TP3_TRACE_WEAPON ECC_GameTraceChannel1
@@ -10,8 +10,29 @@
 #include "GameFramework/SpringArmComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
 #include "AI_Player.h"
-
+#include "TP3HitscanSubsystem.h"
+#include "TP3CombatantRegistry.h"
+#include "TP3EffectPoolSubsystem.h"
+#include "TP3TracerSubsystem.h"
+#include "TP3RespawnSubsystem.h"
+#include "TP3LagCompensationSubsystem.h"
+#include "TP3MatchRecorderSubsystem.h"
+#include "TP3AssetPreloadSubsystem.h"
+#include "TP3HitZoneComponent.h"
+#include "Engine/AssetManager.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/GameStateBase.h"
+#include "TP3Shoot/TP3Shoot.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+static const FName MuzzleSocketName(TEXT("MuzzleFlash"));
+
+// A client may fire from its camera, a bit behind the capsule, but not from across the map
+static constexpr float MaxFireStartDistance = 600.f;
 
 //////////////////////////////////////////////////////////////////////////
 // ATP3ShootCharacter
@@ -57,6 +78,10 @@ ATP3ShootCharacter::ATP3ShootCharacter()
 	SK_Gun->SetupAttachment(GetMesh());
 	// Set parent socket
 	SK_Gun->AttachToComponent(GetMesh(), FAttachmentTransformRules::KeepRelativeTransform, TEXT("GripPoint"));
+	GunMesh = TSoftObjectPtr<USkeletalMesh>(FSoftObjectPath(TEXT("/Game/FPS_Weapon_Bundle/Weapons/Meshes/AR4/SK_AR4.SK_AR4")));
+
+	// Shots hit these instead of the capsule and the physics asset
+	UTP3HitZoneComponent::CreateHitZones(*this, GetMesh());
 
 	Team = 1.0f;
 	FColor color = FColor::Blue;
@@ -66,6 +91,105 @@ ATP3ShootCharacter::ATP3ShootCharacter()
 	// are set in the derived blueprint asset named ThirdPersonCharacter (to avoid direct content references in C++)
 }
 
+void ATP3ShootCharacter::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Own hit zones sit on the muzzle line
+	FireQueryParams = FCollisionQueryParams(FName(TEXT("PlayerFireTrace")), false, this);
+
+	CombatantRegistry = GetWorld()->GetSubsystem<UTP3CombatantRegistry>();
+	if (CombatantRegistry)
+	{
+		CombatantId = CombatantRegistry->Register(this, Team, Life, FTP3OnCombatantLifeChanged::CreateUObject(this, &ATP3ShootCharacter::OnLifeChanged));
+	}
+
+	Tracers = GetWorld()->GetSubsystem<UTP3TracerSubsystem>();
+
+	LagCompensation = GetWorld()->GetSubsystem<UTP3LagCompensationSubsystem>();
+
+	Recorder = GetWorld()->GetSubsystem<UTP3MatchRecorderSubsystem>();
+
+	// Prewarms the effect pool once the effects are loaded
+	EffectPool = GetWorld()->GetSubsystem<UTP3EffectPoolSubsystem>();
+	LoadGameplayAssets();
+}
+
+void ATP3ShootCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// Push model: the server only compares them after a MARK_PROPERTY_DIRTY
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ATP3ShootCharacter, Team, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ATP3ShootCharacter, Life, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ATP3ShootCharacter, IsFiring, Params);
+
+	// The owner already has its own aim state
+	Params.Condition = COND_SkipOwner;
+	DOREPLIFETIME_WITH_PARAMS_FAST(ATP3ShootCharacter, IsAiming, Params);
+}
+
+FGenericTeamId ATP3ShootCharacter::GetGenericTeamId() const
+{
+	return FGenericTeamId(UTP3CombatantRegistry::ToTeamId(Team));
+}
+
+FPrimaryAssetId ATP3ShootCharacter::GetPrimaryAssetId() const
+{
+	return UTP3AssetPreloadSubsystem::GetBlueprintPrimaryAssetId(this, ATP3ShootCharacter::StaticClass()->GetFName());
+}
+
+void ATP3ShootCharacter::LoadGameplayAssets()
+{
+	TArray<FSoftObjectPath> Paths;
+	for (const FSoftObjectPath& Path : { ParticleStart.ToSoftObjectPath(), ParticleImpact.ToSoftObjectPath(), GunMesh.ToSoftObjectPath() })
+	{
+		if (Path.IsValid() && !Path.ResolveObject())
+		{
+			Paths.Add(Path);
+		}
+	}
+
+	// Already brought in by the asset preload, no need to wait a frame
+	if (Paths.Num() == 0)
+	{
+		OnGameplayAssetsLoaded();
+		return;
+	}
+
+	GameplayAssetsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(Paths), FStreamableDelegate::CreateUObject(this, &ATP3ShootCharacter::OnGameplayAssetsLoaded));
+}
+
+void ATP3ShootCharacter::OnGameplayAssetsLoaded()
+{
+	if (EffectPool)
+	{
+		EffectPool->Prewarm(ParticleStart.Get());
+		EffectPool->Prewarm(ParticleImpact.Get());
+	}
+
+	if (USkeletalMesh* Mesh = GunMesh.Get())
+	{
+		if (SK_Gun->GetSkeletalMeshAsset() != Mesh)
+		{
+			SK_Gun->SetSkeletalMeshAsset(Mesh);
+		}
+	}
+}
+
+void ATP3ShootCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (CombatantRegistry)
+	{
+		CombatantRegistry->Unregister(CombatantId);
+		CombatantId = INDEX_NONE;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 //////////////////////////////////////////////////////////////////////////
 // Input
 
@@ -116,17 +240,40 @@ void ATP3ShootCharacter::TouchStopped(ETouchIndex::Type FingerIndex, FVector Loc
 void ATP3ShootCharacter::Aim()
 {
 	IsAiming = true;
+	if (!HasAuthority())
+	{
+		ServerSetAiming(true);
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(ATP3ShootCharacter, IsAiming, this);
 }
 
 void ATP3ShootCharacter::StopAiming()
 {
 	IsAiming = false;
+	if (!HasAuthority())
+	{
+		ServerSetAiming(false);
+	}
+	MARK_PROPERTY_DIRTY_FROM_NAME(ATP3ShootCharacter, IsAiming, this);
+}
+
+void ATP3ShootCharacter::ServerSetAiming_Implementation(bool bNewAiming)
+{
+	IsAiming = bNewAiming;
+	MARK_PROPERTY_DIRTY_FROM_NAME(ATP3ShootCharacter, IsAiming, this);
 }
 
 void ATP3ShootCharacter::Fire()
 {
-	FVector Start, LineTraceEnd, ForwardVector;
-	FHitResult HitResult;
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_Fire);
+
+	FVector Start, ForwardVector;
+
+	// No shooting while waiting to respawn
+	if (CombatantRegistry && (!CombatantRegistry->IsValidCombatant(CombatantId) || !CombatantRegistry->IsAlive(CombatantId)))
+	{
+		return;
+	}
 
 	// Choisissez le point de dpart et de fin en fonction de l'tat d'aim (comme dans votre code actuel)
 	if (IsAiming)
@@ -136,62 +283,178 @@ void ATP3ShootCharacter::Fire()
 	}
 	else
 	{
-		Start = SK_Gun->GetSocketLocation("MuzzleFlash");
+		Start = SK_Gun->GetSocketLocation(MuzzleSocketName);
 		ForwardVector = FollowCamera->GetForwardVector();
 	}
-	LineTraceEnd = Start + (ForwardVector * 10000);
 
-	// Effectuez un Line Trace pour dtecter un hit
-	bool bHit = GetWorld()->LineTraceSingleByChannel(HitResult, Start, LineTraceEnd, ECC_Pawn);
+	// Only the server traces and applies the damage
+	if (!HasAuthority())
+	{
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+		ServerFire(Start, ForwardVector, GameState ? GameState->GetServerWorldTimeSeconds() : 0.0);
+		return;
+	}
+
+	FireFrom(Start, ForwardVector);
+}
+
+bool ATP3ShootCharacter::ServerFire_Validate(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, double ClientTime)
+{
+	// Only malformed input, failing here disconnects the client
+	return Direction.IsNormalized();
+}
+
+void ATP3ShootCharacter::ServerFire_Implementation(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, double ClientTime)
+{
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_Fire);
+
+	if (CombatantRegistry && (!CombatantRegistry->IsValidCombatant(CombatantId) || !CombatantRegistry->IsAlive(CombatantId)))
+	{
+		return;
+	}
+
+	// Lag or a correction can put the client far from the server position, the shot is dropped but the client stays
+	if (FVector::DistSquared(Start, GetActorLocation()) > FMath::Square(MaxFireStartDistance))
+	{
+		return;
+	}
+
+	// The client aimed at where it saw the targets, not where they are now on the server
+	FireFrom(Start, Direction, LagCompensation ? LagCompensation->GetRewindTime(*this, ClientTime) : -1.0);
+}
 
+void ATP3ShootCharacter::FireFrom(const FVector& Start, const FVector& Direction, double RewindTime)
+{
+	const FVector LineTraceEnd = Start + (Direction * 10000);
 
-	if (bHit)
+	if (Recorder)
 	{
-		// debug screen showing which object was hit
+		Recorder->RecordFireStart(CombatantId, Start, LineTraceEnd);
+	}
 
-		// Vrifiez si l'objet touch est un AI_Player
-		if (HitResult.GetActor()->IsA(AAI_Player::StaticClass()))
+	// The trace is batched with the other shots of the frame and resolved in OnFireResolved
+	FTP3HitscanShot Shot;
+	Shot.Start = Start;
+	Shot.End = LineTraceEnd;
+	Shot.Channel = UTP3HitZoneComponent::GetWeaponChannel(ECC_Pawn);
+	// Rewound shots only trace the level now, the combatants are tested where the shooter saw them
+	Shot.bLevelOnly = RewindTime >= 0.0;
+	Shot.Shooter = this;
+	Shot.QueryParams = &FireQueryParams;
+	Shot.RewindTime = RewindTime;
+	Shot.OnResolved.BindUObject(this, &ATP3ShootCharacter::OnFireResolved);
+
+	if (UTP3HitscanSubsystem* Hitscan = GetWorld()->GetSubsystem<UTP3HitscanSubsystem>())
+	{
+		Hitscan->QueueShot(MoveTemp(Shot));
+	}
+}
+
+void ATP3ShootCharacter::OnFireResolved(const FTP3HitscanShot& Shot, const FHitResult* Hit)
+{
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_FireResolved);
+
+	const FVector& Start = Shot.Start;
+
+	// Remote shooter: Hit is the level only trace, the rewound combatants are tested up to it
+	if (Shot.bLevelOnly)
+	{
+		if (!LagCompensation || !CombatantRegistry)
 		{
-			// Cast pour accder  la sant de l'AI_Player
-			AAI_Player* AIPlayer = Cast<AAI_Player>(HitResult.GetActor());
-			if (AIPlayer)
-			{
-				// debug screen AI team
-				// debug screen player team
-				// Vrifie si l'AI_Player est de la mme quipe que le joueur
-				if (AIPlayer->Team == Team)
-				{
-					// debug screen message
-					return;
-				}
-				// Rduisez la vie de l'AI_Player
-				AIPlayer->DecreaseHealth(5.0f);
-				// debug screen displaying ai health
-			}
+			return;
 		}
 
-		// Dessinez la ligne de dbogage pour la ligne de tir
-		if (Team == 2.0f)
+		const bool bBlockedByLevel = Hit != nullptr;
+		const FVector LevelEnd = bBlockedByLevel ? FVector(Hit->ImpactPoint) : Shot.End;
+		FTP3RewoundHit Rewound;
+		const bool bRewoundHit = LagCompensation->TraceRewound(Start, LevelEnd, CombatantId, Shot.RewindTime, Rewound);
+		if (Recorder)
 		{
-			DrawDebugLine(GetWorld(), Start, HitResult.ImpactPoint, FColor::Red, false, 3.0f, 5, 3.0f);
+			Recorder->RecordFireEnd(CombatantId, bRewoundHit ? Rewound.CombatantId : INDEX_NONE, bRewoundHit ? Rewound.Impact : LevelEnd);
 		}
-		else
+
+		if (bRewoundHit)
+		{
+			CombatantRegistry->ApplyDamage(Rewound.CombatantId, 5.0f * UTP3HitZoneComponent::GetDamageMultiplier(Rewound.bHead ? ETP3HitZone::Head : ETP3HitZone::Torso));
+			MulticastShotTracer(Start, Rewound.Impact);
+		}
+		else if (bBlockedByLevel)
 		{
-			DrawDebugLine(GetWorld(), Start, HitResult.ImpactPoint, FColor::Blue, false, 3.0f, 5, 3.0f);
+			MulticastShotTracer(Start, Hit->ImpactPoint);
 		}
+		return;
+	}
+
+	if (Recorder)
+	{
+		Recorder->RecordFireEnd(CombatantId, Hit && CombatantRegistry ? CombatantRegistry->FindCombatant(Hit->GetActor()) : INDEX_NONE, Hit ? Hit->ImpactPoint : Shot.End);
+	}
+
+	if (Hit)
+	{
+		const FHitResult& HitResult = *Hit;
+
+		// debug screen showing which object was hit
+
+		// Vrifiez si l'objet touch est un combattant
+		const int32 HitId = CombatantRegistry ? CombatantRegistry->FindCombatant(HitResult.GetActor()) : INDEX_NONE;
+		if (HitId != INDEX_NONE)
+		{
+			// Vrifie si le combattant est de la mme quipe que le joueur
+			if (!CombatantRegistry->AreEnemies(CombatantId, HitId))
+			{
+				return;
+			}
+			// Rduisez la vie du combattant
+			CombatantRegistry->ApplyDamage(HitId, 5.0f * UTP3HitZoneComponent::GetDamageMultiplier(HitResult));
+		}
+
+		// Dessinez le traceur de la ligne de tir, sur le serveur et les clients
+		MulticastShotTracer(Start, HitResult.ImpactPoint);
+	}
+}
+
+void ATP3ShootCharacter::MulticastShotTracer_Implementation(FVector_NetQuantize Start, FVector_NetQuantize Impact)
+{
+	if (Tracers)
+	{
+		Tracers->AddTracer(Start, Impact, UTP3CombatantRegistry::ToTeamId(Team));
 	}
 }
 
 void ATP3ShootCharacter::DecreaseHealth(float Amount)
 {
-	Life -= Amount;
-	if (Life <= 0)
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_DecreaseHealth);
+
+	if (CombatantRegistry && HasAuthority())
+	{
+		CombatantRegistry->ApplyDamage(CombatantId, Amount);
+	}
+}
+
+void ATP3ShootCharacter::OnLifeChanged(int32 Id, bool bKilled)
+{
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_LifeChanged);
+
+	if (bKilled)
+	{
+		// deactivate it until it respawns on a safe spawn point
+		if (UTP3RespawnSubsystem* Respawn = GetWorld()->GetSubsystem<UTP3RespawnSubsystem>())
+		{
+			Respawn->QueueRespawn(this, Id);
+		}
+	}
+
+	Life = CombatantRegistry->GetLife(Id);
+	MARK_PROPERTY_DIRTY_FROM_NAME(ATP3ShootCharacter, Life, this);
+}
+
+void ATP3ShootCharacter::OnRep_Life()
+{
+	// Before BeginPlay the replicated life is picked up by the registration
+	if (CombatantRegistry)
 	{
-		// Logique de mort de l'AI_Player
-		// teleport it to 1300 1200 90
-		SetActorLocation(FVector(1300, 1200, 90));
-		// reset life
-		Life = 20.0f;
+		CombatantRegistry->ApplyReplicatedLife(CombatantId, Life);
 	}
 }
 
@@ -199,6 +462,8 @@ void ATP3ShootCharacter::DecreaseHealth(float Amount)
 
 void ATP3ShootCharacter::BoostSpeed()
 {
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_BoostSpeed);
+
 	// Set Max walking speed to 800
 	GetCharacterMovement()->MaxWalkSpeed = 800.f;
 
@@ -222,7 +487,12 @@ void ATP3ShootCharacter::RemoveSpeedBoost()
 
 void ATP3ShootCharacter::FireParticle(FVector Start, FVector Impact)
 {
-	if (!ParticleStart || !ParticleImpact) return;
+	TP3_COMBAT_SCOPE(STAT_TP3Combat_FireParticle);
+
+	// Nothing until the Effects bundle is loaded
+	UParticleSystem* StartTemplate = ParticleStart.Get();
+	UParticleSystem* ImpactTemplate = ParticleImpact.Get();
+	if (!StartTemplate || !ImpactTemplate) return;
 
 	FTransform ParticleT;
 
@@ -230,12 +500,14 @@ void ATP3ShootCharacter::FireParticle(FVector Start, FVector Impact)
 
 	ParticleT.SetScale3D(FVector(0.25, 0.25, 0.25));
 
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ParticleStart, ParticleT, true);
+	if (!EffectPool) return;
+
+	EffectPool->SpawnEffect(StartTemplate, ParticleT);
 
 	// Spawn particle at impact point
 	ParticleT.SetLocation(Impact);
 
-	UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ParticleImpact, ParticleT, true);
+	EffectPool->SpawnEffect(ImpactTemplate, ParticleT);
 
 }
 
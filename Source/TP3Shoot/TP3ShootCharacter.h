@@ -4,10 +4,14 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "CollisionQueryParams.h"
+#include "GenericTeamAgentInterface.h"
 #include "TP3ShootCharacter.generated.h"
 
+struct FTP3HitscanShot;
+
 UCLASS(config = Game)
-class ATP3ShootCharacter : public ACharacter
+class ATP3ShootCharacter : public ACharacter, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
@@ -28,10 +32,11 @@ public:
 	float TurnRateGamepad;
 
 	// blueprint write and read
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Stats")
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Replicated, Category = "Stats")
 	float Team;
 
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Stats")
+	// Starting life, then mirrors the combatant registry for Blueprints
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, ReplicatedUsing = OnRep_Life, Category = "Stats")
 	float Life;
 
 
@@ -41,17 +46,36 @@ protected:
 	UPROPERTY(VisibleDefaultsOnly, Category = Mesh)
 	class USkeletalMeshComponent* SK_Gun;
 
-	// Particle Start
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UParticleSystem* ParticleStart;
+	// Particle Start, loaded with the Effects bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Effects"))
+	TSoftObjectPtr<class UParticleSystem> ParticleStart;
+
+	// Particle Impact, loaded with the Effects bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Effects"))
+	TSoftObjectPtr<class UParticleSystem> ParticleImpact;
+
+	// Mesh of SK_Gun, set once the Weapon bundle is loaded
+	UPROPERTY(EditAnywhere, Category = Mesh, meta = (AssetBundles = "Weapon"))
+	TSoftObjectPtr<class USkeletalMesh> GunMesh;
+
+	// Pool playing ParticleStart and ParticleImpact
+	UPROPERTY(Transient)
+	class UTP3EffectPoolSubsystem* EffectPool;
+
+	// Renders the shot tracers
+	UPROPERTY(Transient)
+	class UTP3TracerSubsystem* Tracers;
+
+	// Fire animation, loaded with the Weapon bundle
+	UPROPERTY(EditAnywhere, Category = Gameplay, meta = (AssetBundles = "Weapon"))
+	TSoftObjectPtr<class UAnimMontage> FireAnimation;
 
-	// Particle Impact
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UParticleSystem* ParticleImpact;
+	// Weapon and effect assets requested at BeginPlay, already in memory when the preload list has them
+	TSharedPtr<struct FStreamableHandle> GameplayAssetsHandle;
 
-	// Fire animation
-	UPROPERTY(EditAnywhere, Category = Gameplay)
-	class UAnimMontage* FireAnimation;
+	void LoadGameplayAssets();
+
+	void OnGameplayAssetsLoaded();
 
 	// Timer for Boost Speed
 	FTimerHandle BoostSpeedTimer;
@@ -85,21 +109,72 @@ protected:
 
 	void StopAiming();
 
-	// Firing function
+	// Firing function, forwarded to the server by the owning client
 	void Fire();
 
+	// Queues the shot in the hitscan subsystem, on the server only. RewindTime >= 0 enables lag compensation.
+	void FireFrom(const FVector& Start, const FVector& Direction, double RewindTime = -1.0);
+
+	// ClientTime is the server time estimated by the client when it fired
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire(FVector_NetQuantize Start, FVector_NetQuantizeNormal Direction, double ClientTime);
+
+	UFUNCTION(Server, Reliable)
+	void ServerSetAiming(bool bNewAiming);
+
+	// Tracer of a shot resolved on the server, cosmetic only
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastShotTracer(FVector_NetQuantize Start, FVector_NetQuantize Impact);
+
 	void BoostSpeed();
 
 	void RemoveSpeedBoost();
 
 	void FireParticle(FVector Start, FVector Impact);
 
+	// Called by the hitscan subsystem once the shot queued by Fire has been traced
+	void OnFireResolved(const FTP3HitscanShot& Shot, const FHitResult* Hit);
+
+	// Query params shared by every shot, built at BeginPlay
+	FCollisionQueryParams FireQueryParams;
+
+	// Id of this character in the combatant registry, valid between BeginPlay and EndPlay
+	int32 CombatantId = INDEX_NONE;
+
+	UPROPERTY(Transient)
+	class UTP3CombatantRegistry* CombatantRegistry;
+
+	// Records the shots while a match recording runs
+	UPROPERTY(Transient)
+	class UTP3MatchRecorderSubsystem* Recorder;
+
+	// Rewinds the targets of the shots of remote clients
+	UPROPERTY(Transient)
+	class UTP3LagCompensationSubsystem* LagCompensation;
+
+	// Called by the combatant registry when this character took damage
+	void OnLifeChanged(int32 Id, bool bKilled);
+
+	// Clients mirror the life of the server in their registry
+	UFUNCTION()
+	void OnRep_Life();
+
 protected:
 	// APawn interface
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	// End of APawn interface
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Blueprints of this class are primary assets so the asset manager can preload them with their bundles
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
+	// IGenericTeamAgentInterface, Team as a generic team id for the perception affiliation filters
+	virtual FGenericTeamId GetGenericTeamId() const override;
+
 	/** Returns CameraBoom subobject **/
 	FORCEINLINE class USpringArmComponent* GetCameraBoom() const { return CameraBoom; }
 	/** Returns FollowCamera subobject **/
@@ -109,14 +184,16 @@ public:
 
 public:
 
-	// Is Aiming
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Aiming")
+	// Is Aiming, set locally by the owning client and replicated to the others
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Replicated, Category = "Aiming")
 	bool IsAiming;
 
 	// Is Firing
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Firing")
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Replicated, Category = "Firing")
 	bool IsFiring;
 
+	int32 GetCombatantId() const { return CombatantId; }
+
 	void DecreaseHealth(float Amount);
 
 
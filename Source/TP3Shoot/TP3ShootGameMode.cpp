@@ -2,14 +2,110 @@
 
 #include "TP3ShootGameMode.h"
 #include "TP3ShootCharacter.h"
-#include "UObject/ConstructorHelpers.h"
+#include "TP3AssetPreloadSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/StreamableManager.h"
+#include "GameFramework/DefaultPawn.h"
+#include "GameFramework/PlayerController.h"
 
 ATP3ShootGameMode::ATP3ShootGameMode()
 {
 	// set default pawn class to our Blueprinted character
-	static ConstructorHelpers::FClassFinder<APawn> PlayerPawnBPClass(TEXT("/Game/ThirdPerson/Blueprints/BP_ThirdPersonCharacter"));
-	if (PlayerPawnBPClass.Class != NULL)
+	PlayerPawnClass = TSoftClassPtr<APawn>(FSoftObjectPath(TEXT("/Game/ThirdPerson/Blueprints/BP_ThirdPersonCharacter.BP_ThirdPersonCharacter_C")));
+}
+
+void ATP3ShootGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	// Blueprint game modes that picked their own pawn keep it
+	if (DefaultPawnClass == ADefaultPawn::StaticClass() && !PlayerPawnClass.IsNull())
+	{
+		if (UClass* PawnClass = PlayerPawnClass.Get())
+		{
+			DefaultPawnClass = PawnClass;
+		}
+		else
+		{
+			// No blocking load during the map load, the players are spawned once the class is in
+			bWaitingForPawnClass = true;
+			UTP3AssetPreloadSubsystem* Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<UTP3AssetPreloadSubsystem>() : nullptr;
+			if (Preload && !Preload->IsPreloadComplete())
+			{
+				PreloadHandle = Preload->OnPreloadComplete.AddUObject(this, &ATP3ShootGameMode::OnPreloadComplete);
+			}
+			else
+			{
+				OnPreloadComplete();
+			}
+		}
+	}
+
+	Super::InitGame(MapName, Options, ErrorMessage);
+}
+
+void ATP3ShootGameMode::OnPreloadComplete()
+{
+	if (UTP3AssetPreloadSubsystem* Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<UTP3AssetPreloadSubsystem>() : nullptr)
+	{
+		Preload->OnPreloadComplete.Remove(PreloadHandle);
+	}
+
+	if (PlayerPawnClass.Get() || !UAssetManager::IsInitialized())
+	{
+		OnPlayerPawnClassLoaded();
+		return;
+	}
+
+	// Not in the preload list
+	PawnClassHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(PlayerPawnClass.ToSoftObjectPath(),
+		FStreamableDelegate::CreateUObject(this, &ATP3ShootGameMode::OnPlayerPawnClassLoaded), FStreamableManager::AsyncLoadHighPriority);
+	if (!PawnClassHandle.IsValid())
+	{
+		OnPlayerPawnClassLoaded();
+	}
+}
+
+void ATP3ShootGameMode::OnPlayerPawnClassLoaded()
+{
+	bWaitingForPawnClass = false;
+
+	if (UClass* PawnClass = PlayerPawnClass.Get())
+	{
+		DefaultPawnClass = PawnClass;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Player pawn class %s could not be loaded, players get %s"), *PlayerPawnClass.ToString(), *GetNameSafe(DefaultPawnClass));
+	}
+
+	// Through the base class, which leaves the spectators without a pawn
+	for (const TWeakObjectPtr<APlayerController>& PlayerController : PendingPlayers)
+	{
+		if (PlayerController.IsValid())
+		{
+			Super::HandleStartingNewPlayer_Implementation(PlayerController.Get());
+		}
+	}
+	PendingPlayers.Reset();
+}
+
+void ATP3ShootGameMode::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
+{
+	if (bWaitingForPawnClass)
+	{
+		PendingPlayers.Add(NewPlayer);
+		return;
+	}
+
+	Super::HandleStartingNewPlayer_Implementation(NewPlayer);
+}
+
+void ATP3ShootGameMode::StartPlay()
+{
+	Super::StartPlay();
+
+	if (UTP3AssetPreloadSubsystem* Preload = GetGameInstance() ? GetGameInstance()->GetSubsystem<UTP3AssetPreloadSubsystem>() : nullptr)
 	{
-		DefaultPawnClass = PlayerPawnBPClass.Class;
+		Preload->NotifyGameplayStarted();
 	}
 }
@@ -6,13 +6,42 @@
 #include "GameFramework/GameModeBase.h"
 #include "TP3ShootGameMode.generated.h"
 
-UCLASS(minimalapi)
+struct FStreamableHandle;
+
+UCLASS(minimalapi, config = Game)
 class ATP3ShootGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
 
 public:
 	ATP3ShootGameMode();
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void StartPlay() override;
+
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+
+protected:
+	// Soft so the pawn blueprint is not loaded with the game mode class. Used as is when already in memory,
+	// otherwise the players wait for the asset preload, which has it first, and spawn once it is done
+	UPROPERTY(Config, EditDefaultsOnly, Category = Classes)
+	TSoftClassPtr<APawn> PlayerPawnClass;
+
+private:
+	void OnPreloadComplete();
+
+	void OnPlayerPawnClassLoaded();
+
+	// Players that joined while PlayerPawnClass was loading
+	TArray<TWeakObjectPtr<APlayerController>> PendingPlayers;
+
+	// Loads PlayerPawnClass when the preload list does not have it
+	TSharedPtr<FStreamableHandle> PawnClassHandle;
+
+	FDelegateHandle PreloadHandle;
+
+	bool bWaitingForPawnClass = false;
 };
 
 
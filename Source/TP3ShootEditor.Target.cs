@@ -10,6 +10,7 @@ public class TP3ShootEditorTarget : TargetRules
 		Type = TargetType.Editor;
 		DefaultBuildSettings = BuildSettingsVersion.V5;
         IncludeOrderVersion = EngineIncludeOrderVersion.Latest;
+        bWithPushModel = true;
         ExtraModuleNames.Add("TP3Shoot");
 	}
 }
@@ -0,0 +1,17 @@
+// Copyright Epic Games, Inc. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class TP3ShootServerTarget : TargetRules
+{
+	public TP3ShootServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+		DefaultBuildSettings = BuildSettingsVersion.V2;
+
+		bOverrideBuildEnvironment = true;
+		bWithPushModel = true;
+		ExtraModuleNames.Add("TP3Shoot");
+	}
+}